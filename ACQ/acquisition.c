@@ -0,0 +1,278 @@
+/*
+ * acquisition.c
+ *
+ * Timer and I2C interrupt driven BME280 state machine, see acquisition.h
+ */
+
+#include "acquisition.h"
+#include "BSP\bsp.h"
+#include "I2C\i2c.h"
+#include "BME280\BME280_I2C.h"
+#include "READING\reading.h"
+#include "QUEUE\spsc_queue.h"
+
+//Bits of the GPTM control (CTL) and interrupt (IMR/ICR) registers
+#define ACQ_TIMER_TAEN      (1U<<0)
+#define ACQ_TIMER_TBEN      (1U<<8)
+#define ACQ_TIMER_TATO      (1U<<0)
+#define ACQ_TIMER_TBTO      (1U<<8)
+
+//Divides the system clock down to 1 MHz so the timers count in microseconds
+#define ACQ_PRESCALE        (SYS_CLOCK_HZ / 1000000U - 1U)
+
+#define ACQ_IDLE            0
+#define ACQ_TRIGGERING      1
+#define ACQ_CONVERTING      2
+#define ACQ_READING         3
+
+ACQ_Stats acqIrqStats;
+
+static volatile uint8_t acqState;
+static uint8_t          acqRunning;
+static uint32_t         acqPeriod;
+static uint8_t          acqFirstSample;
+static uint64_t         acqTickUs;
+static uint64_t         acqLastTickUs;
+static uint64_t         acqConversionUs;
+static uint64_t         acqReadUs;
+static void             (*acqReadyCallback)(void);
+
+static uint8_t          acqTrigger[2];
+static const uint8_t    acqDataRegister = BME280_REGISTER_TEMPDATA;
+static uint8_t          acqBurst[BME280_BURST_LENGTH];
+static I2C_Transaction  acqTransaction;
+
+static TELEM_Sample     acqSampleBuffer[ACQ_QUEUE_SIZE];
+static SPSC_Queue       acqSamples;
+
+static void ACQ_i2cDone(I2C_Transaction *transaction);
+
+/**************************************************************************************
+ * Acquisition Initialize Function
+ * Sets up WTIMER1 as two 32-bit timers counting microseconds: A periodic for the
+ * sample ticks and B one-shot for the conversion time. Nothing runs until ACQ_start.
+ ***************************************************************************************
+*/
+void ACQ_init(void (*readyCallback)(void)){
+    acqReadyCallback = readyCallback;
+    SPSC_init(&acqSamples, acqSampleBuffer, sizeof(TELEM_Sample), ACQ_QUEUE_SIZE);
+
+    SYSCTL->RCGCWTIMER |= (1U<<1);
+    while((SYSCTL->PRWTIMER & (1U<<1)) == 0);
+    WTIMER1->CTL = 0U;
+    WTIMER1->CFG = 0x4U;            //A and B as separate 32-bit timers
+    WTIMER1->TAMR = 0x2U;           //periodic, count down
+    WTIMER1->TBMR = 0x1U;           //one-shot, count down
+    WTIMER1->TAPR = ACQ_PRESCALE;
+    WTIMER1->TBPR = ACQ_PRESCALE;
+    WTIMER1->ICR = ACQ_TIMER_TATO | ACQ_TIMER_TBTO;
+    WTIMER1->IMR = ACQ_TIMER_TATO | ACQ_TIMER_TBTO;
+    NVIC_EnableIRQ(WTIMER1A_IRQn);
+    NVIC_EnableIRQ(WTIMER1B_IRQn);
+}
+
+/**************************************************************************************
+ * Acquisition Start/Stop Functions
+ * ACQ_start (re)starts the sample ticks with the given period, the first tick comes
+ * one period later. ACQ_stop stops the ticks, including one already pending, a
+ * sequence already running finishes (see ACQ_busy).
+ ***************************************************************************************
+*/
+void ACQ_start(uint32_t periodUs){
+    WTIMER1->CTL &= ~ACQ_TIMER_TAEN;
+    acqPeriod = periodUs;
+    acqLastTickUs = 0;
+    acqFirstSample = 1;
+    acqRunning = 1;
+    WTIMER1->TAILR = periodUs - 1U;
+    WTIMER1->TAV = periodUs - 1U;
+    WTIMER1->CTL |= ACQ_TIMER_TAEN;
+}
+
+void ACQ_stop(void){
+    WTIMER1->CTL &= ~ACQ_TIMER_TAEN;
+    WTIMER1->ICR = ACQ_TIMER_TATO;
+    NVIC_ClearPendingIRQ(WTIMER1A_IRQn);
+    acqRunning = 0;
+}
+
+uint8_t ACQ_running(void){
+    return acqRunning;
+}
+
+uint32_t ACQ_periodUs(void){
+    return acqPeriod;
+}
+
+//A sequence is between its tick and its sample, it will still publish a reading
+uint8_t ACQ_busy(void){
+    return acqState != ACQ_IDLE;
+}
+
+/**************************************************************************************
+ * Get Sample Function
+ * Main loop side of the sample queue. Returns 0 when there is no sample waiting.
+ ***************************************************************************************
+*/
+uint8_t ACQ_getSample(TELEM_Sample *sample){
+    return SPSC_pop(&acqSamples, sample);
+}
+
+//Drops the samples still queued, for a switch to another acquisition mode
+void ACQ_flush(void){
+    while(SPSC_peek(&acqSamples) != 0){
+        SPSC_release(&acqSamples);
+    }
+}
+
+/**************************************************************************************
+ * Start Transaction Function
+ * The trigger and the burst read use the same transaction, only one is on the bus
+ * at a time. A transport that does not go through the I2C queue (SPI) is fast
+ * enough to be run right here, its result goes through the same callback.
+ ***************************************************************************************
+*/
+static void ACQ_submit(const uint8_t *txData, uint16_t txLength, uint8_t *rxData, uint16_t rxLength){
+    if(!bme280Transport->queued){
+        acqTransaction.status = (rxLength != 0) ? bme280Transport->read(txData[0], rxData, rxLength)
+                                                : bme280Transport->write(txData, txLength);
+        ACQ_i2cDone(&acqTransaction);
+        return;
+    }
+    acqTransaction.address = bme280Address;
+    acqTransaction.txData = txData;
+    acqTransaction.txLength = txLength;
+    acqTransaction.rxData = rxData;
+    acqTransaction.rxLength = rxLength;
+    acqTransaction.callback = ACQ_i2cDone;
+    acqTransaction.arg = 0;
+    I2C_submit(bme280Bus, &acqTransaction);
+}
+
+/**************************************************************************************
+ * Sample Tick Interrupt
+ * Starts a new sequence with the trigger write and keeps the tick jitter
+ ***************************************************************************************
+*/
+void WideTimer1A_IRQHandler(void){
+    uint32_t intervalUs;
+
+    WTIMER1->ICR = ACQ_TIMER_TATO;
+    acqTickUs = BSP_timestampUs();
+    acqIrqStats.ticks++;
+
+    if(acqLastTickUs != 0){
+        intervalUs = (uint32_t)(acqTickUs - acqLastTickUs);
+        acqIrqStats.jitterUs = (intervalUs > acqPeriod) ? intervalUs - acqPeriod : acqPeriod - intervalUs;
+        if(acqIrqStats.jitterUs > acqIrqStats.maxJitterUs){
+            acqIrqStats.maxJitterUs = acqIrqStats.jitterUs;
+        }
+    }
+    acqLastTickUs = acqTickUs;
+
+    if(acqState != ACQ_IDLE){
+        //A stuck bus raises no interrupts, give up the transaction if it is overdue
+        acqIrqStats.overruns++;
+        if(bme280Transport->queued){
+            I2C_checkTimeout(bme280Bus);
+        }
+        return;
+    }
+    acqState = ACQ_TRIGGERING;
+    acqTrigger[0] = BME280_REGISTER_CONTROL;
+    acqTrigger[1] = BME280_forcedControl();
+    ACQ_submit(acqTrigger, 2, 0, 0);
+}
+
+/**************************************************************************************
+ * Conversion Done Interrupt
+ * The one-shot timer ran out, the result can be read
+ ***************************************************************************************
+*/
+void WideTimer1B_IRQHandler(void){
+    WTIMER1->ICR = ACQ_TIMER_TBTO;
+    if(acqState == ACQ_CONVERTING){
+        acqState = ACQ_READING;
+        acqReadUs = BSP_timestampUs();
+        ACQ_submit(&acqDataRegister, 1, acqBurst, BME280_BURST_LENGTH);
+    }
+}
+
+/**************************************************************************************
+ * Publish Function
+ * Compensates the burst, publishes it as the latest reading and queues it for the
+ * main loop
+ ***************************************************************************************
+*/
+static void ACQ_publish(void){
+    BME280_Result result;
+    READING_Data reading;
+    TELEM_Sample *sample;
+    uint64_t readUs = BSP_timestampUs();
+
+    BME280_compensate(acqBurst, &result);
+
+    reading.temperature = result.temperature;
+    reading.temperatureF = (result.temperature * 9) / 5 + 3200;
+    reading.humidity = result.humidity;
+    reading.adcT = result.adcT;
+    reading.adcH = result.adcH;
+    reading.tFine = result.tFine;
+    reading.conversionUs = acqConversionUs;
+    reading.readUs = readUs;
+    READING_publish(&reading);
+    acqIrqStats.samples++;
+
+    sample = SPSC_reserve(&acqSamples);
+    if(sample == 0){
+        acqIrqStats.dropped++;
+        return;
+    }
+    sample->adcT = result.adcT;
+    sample->adcH = result.adcH;
+    sample->temperature = result.temperature;
+    sample->humidity = result.humidity;
+    sample->status = result.humidityClamped ? TELEM_STATUS_HUMID_CLAMPED : 0;
+    if(acqFirstSample){
+        sample->status |= TELEM_STATUS_FIRST_SAMPLE;
+        acqFirstSample = 0;
+    }
+    sample->conversionUs = acqConversionUs;
+    sample->readUs = readUs;
+    SPSC_commit(&acqSamples);
+
+    acqIrqStats.sequenceUs = (uint32_t)(BSP_timestampUs() - acqTickUs);
+    if(acqIrqStats.sequenceUs > acqIrqStats.maxSequenceUs){
+        acqIrqStats.maxSequenceUs = acqIrqStats.sequenceUs;
+    }
+    if(acqReadyCallback != 0){
+        acqReadyCallback();
+    }
+}
+
+/**************************************************************************************
+ * I2C Done Callback
+ * Called from the I2C interrupt when the trigger or the burst read finished, or
+ * straight from ACQ_submit for SPI
+ ***************************************************************************************
+*/
+static void ACQ_i2cDone(I2C_Transaction *transaction){
+    if(transaction->status != I2C_STATUS_DONE){
+        acqIrqStats.busErrors++;
+        acqState = ACQ_IDLE;
+        return;
+    }
+
+    if(acqState == ACQ_TRIGGERING){
+        //The conversion starts once ctrl_meas has been written
+        acqConversionUs = BSP_timestampUs();
+        acqState = ACQ_CONVERTING;
+        WTIMER1->TBILR = BME280_conversionTimeUs() - 1U;
+        WTIMER1->CTL |= ACQ_TIMER_TBEN;
+    } else if(acqState == ACQ_READING){
+        //Submit to done, on a shared I2C bus this includes waiting for it
+        BME280_recordSampleUs((uint32_t)(BSP_timestampUs() - acqReadUs));
+        ACQ_publish();
+        acqState = ACQ_IDLE;
+    }
+}
@@ -0,0 +1,57 @@
+/*
+ * acquisition.h
+ *
+ * Interrupt driven BME280 acquisition. WTIMER1A ticks at the sample period and
+ * starts a sequence that is moved on by interrupts only:
+ *
+ *  tick (WTIMER1A)      -> queue the forced mode trigger write
+ *  trigger done (I2C)   -> start WTIMER1B for the conversion time
+ *  converted (WTIMER1B) -> queue the 5 byte burst read
+ *  read done (I2C)      -> compensate, publish the reading, queue the sample
+ *
+ * With the sensor on SPI the trigger and the read are done right in the timer
+ * interrupts instead, they take about 10 us each.
+ * Samples therefore come at the timer rate no matter what the main loop does.
+ * Finished samples go through a single-producer/single-consumer queue, the ready
+ * callback (interrupt context) tells the main loop to take them with
+ * ACQ_getSample. A tick that comes while the previous sequence is still running is
+ * counted as an overrun and skipped.
+ *
+ * ACQ_stop only stops the ticks. Until ACQ_busy returns 0 the last sequence may
+ * still publish a reading from interrupt context, so another writer of the latest
+ * reading has to wait for that and then ACQ_flush what it queued.
+ */
+
+#ifndef ACQUISITION_H_
+#define ACQUISITION_H_
+
+#include <stdint.h>
+#include "TELEMETRY\telemetry_protocol.h"
+
+#define ACQ_QUEUE_SIZE          4       //power of two
+
+typedef struct
+{
+    uint32_t ticks;
+    uint32_t samples;
+    uint32_t overruns;          //ticks skipped because a sequence was still running
+    uint32_t busErrors;         //sequences ended by an I2C error
+    uint32_t dropped;           //samples lost because the queue was full
+    uint32_t jitterUs;          //deviation of the last tick from the period
+    uint32_t maxJitterUs;
+    uint32_t sequenceUs;        //tick until the sample was queued, last sample
+    uint32_t maxSequenceUs;
+} ACQ_Stats;
+
+extern ACQ_Stats acqIrqStats;
+
+void     ACQ_init(void (*readyCallback)(void));
+void     ACQ_start(uint32_t periodUs);
+void     ACQ_stop(void);
+uint8_t  ACQ_running(void);
+uint8_t  ACQ_busy(void);
+void     ACQ_flush(void);
+uint32_t ACQ_periodUs(void);
+uint8_t  ACQ_getSample(TELEM_Sample *sample);
+
+#endif /* ACQUISITION_H_ */
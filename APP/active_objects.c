@@ -0,0 +1,417 @@
+/*
+ * active_objects.c
+ *
+ * Handlers of the application's active objects, see active_objects.h
+ */
+
+#include "active_objects.h"
+#include "BME280\BME280_I2C.h"
+#include "READING\reading.h"
+#include "ACQ\acquisition.h"
+#include "UART\uart.h"
+#include "LOG\sample_log.h"
+#include "TELEMETRY\telemetry.h"
+#include "COMMAND\command.h"
+#include "OUTPUT\output.h"
+#include "TIMER\timer_wheel.h"
+#include "UI\ui.h"
+#include "BUTTON\buttons.h"
+
+APP_AcqStats acqStats;
+
+ActiveObject sensorAO;
+ActiveObject telemetryAO;
+ActiveObject commandAO;
+ActiveObject displayAO;
+
+static AO_Slot sensorQueue[4];
+static AO_Slot telemetryQueue[8];
+static AO_Slot commandQueue[4];
+static AO_Slot displayQueue[8];
+
+static TW_Timer sampleTimer;
+static TW_Timer conversionTimer;
+static TW_Timer telemetryRetryTimer;
+static volatile uint8_t commandRxPending;
+
+static void conversion_Timer_Callback(void *arg);
+
+static uint8_t  conversionPending;
+static uint32_t conversionStart;        //systemTicks when the conversion was triggered
+static uint32_t conversionTicks;        //whole ticks the conversion needs
+static uint64_t conversionStartUs;      //the same in microseconds, for the sample timestamp
+
+/**************************************************************************************
+ * Report Log Block Function
+ * Called each time a block of the sample log fills up. In ASCII mode the compression
+ * statistics are printed, in binary mode the finished block itself is sent so the PC
+ * gets the compressed history.
+ ***************************************************************************************
+*/
+static void report_Log_Block(void){
+    const uint8_t *block;
+    uint16_t length;
+    char line[96];
+
+    if(telemetryMode == TELEM_MODE_ASCII){
+        LOG_formatStats(line, sizeof(line));
+        printStringToUart(line, UART0);
+    } else {
+        block = LOG_getBlock(LOG_numBlocks() - 2, &length);
+        TELEM_sendLogBlock(UART0, BSP_MILLIS(), block, length);
+    }
+}
+
+/**************************************************************************************
+ * Start Conversion Function
+ * Triggers a forced mode conversion of the BME280 and remembers when it will be done.
+ * One tick is added since the trigger can happen anywhere within the current tick.
+ * onTick is set when the conversion was started by the sample timer, then the time
+ * since the last such start is compared with the sample period to get the jitter.
+ ***************************************************************************************
+*/
+static void start_Conversion(uint8_t onTick){
+    static uint64_t lastTickStartUs;
+    uint32_t periodUs = runtimeConfig.samplePeriodMs * 1000;
+    uint32_t intervalUs;
+
+    acqStats.conversionUs = BME280_conversionTimeUs();
+    if(BME280_triggerConversion() != I2C_STATUS_DONE){
+        acqStats.busErrors++;
+    }
+    conversionStartUs = BSP_timestampUs();
+    if(!onTick){
+        lastTickStartUs = 0;
+    } else {
+        if(lastTickStartUs != 0){
+            intervalUs = (uint32_t)(conversionStartUs - lastTickStartUs);
+            acqStats.jitterUs = (intervalUs > periodUs) ? intervalUs - periodUs : periodUs - intervalUs;
+            if(acqStats.jitterUs > acqStats.maxJitterUs){
+                acqStats.maxJitterUs = acqStats.jitterUs;
+            }
+        }
+        lastTickStartUs = conversionStartUs;
+    }
+    conversionStart = systemTicks;
+    conversionTicks = BSP_MS_TO_TICKS((acqStats.conversionUs + 999) / 1000) + 1;
+    conversionPending = 1;
+}
+
+/**************************************************************************************
+ * Read Sample Function
+ * Burst reads the result of the last conversion, publishes it as the latest reading
+ * in one go and fills in the telemetry sample from it. Returns 0 if the sensor could
+ * not be read, nothing is published then.
+ ***************************************************************************************
+*/
+static uint8_t read_Sample(TELEM_Sample *sample){
+    static uint8_t firstSample = 1;
+    static READING_Data reading;
+    uint32_t start = BSP_CYCLES();
+
+    conversionPending = 0;
+    if(BME280_readSample() != I2C_STATUS_DONE){
+        acqStats.busErrors++;
+        return 0;
+    }
+    reading.readUs = BSP_timestampUs();
+    reading.conversionUs = conversionStartUs;
+
+    reading.temperature = temperature;
+    reading.temperatureF = (temperature * 9) / 5 + 3200;
+    reading.humidity = (uint16_t)(humidity * 100);
+    reading.adcT = (uint32_t)adc_T;
+    reading.adcH = (uint16_t)adc_H;
+    reading.tFine = t_fine;
+    READING_publish(&reading);
+
+    sample->adcT = reading.adcT;
+    sample->adcH = reading.adcH;
+    sample->temperature = reading.temperature;
+    sample->humidity = reading.humidity;
+    sample->conversionUs = reading.conversionUs;
+    sample->readUs = reading.readUs;
+    sample->status = 0;
+    if(humidity >= 100.0 || humidity <= 0.0){
+        sample->status |= TELEM_STATUS_HUMID_CLAMPED;
+    }
+    if(firstSample){
+        sample->status |= TELEM_STATUS_FIRST_SAMPLE;
+        firstSample = 0;
+    }
+
+    acqStats.readUs = (BSP_CYCLES() - start) / (SYS_CLOCK_HZ / 1000000U);
+    if(acqStats.readUs > acqStats.maxReadUs){
+        acqStats.maxReadUs = acqStats.readUs;
+    }
+    return 1;
+}
+
+/**************************************************************************************
+ * Publish Sample Function
+ * Hands the reading to the output stage, which formats it once and lets each display
+ * take it at its own pace:
+ * 1)OLED display through SSD_printText_6x8
+ * 2)Bluetooth via UART3
+ * 3)PC via UART0 (When the launchpad is connected via USB to the PC)
+ ***************************************************************************************
+*/
+static void publish_Sample(const TELEM_Sample *sample){
+    uint32_t start = BSP_CYCLES();
+
+    OUT_publish(BSP_MILLIS(), sample);
+
+    //Keep a compressed copy of the reading in the on-device history
+    if(LOG_append(BSP_MILLIS(), sample->temperature, sample->humidity)){
+        report_Log_Block();
+    }
+
+    acqStats.publishUs = (BSP_CYCLES() - start) / (SYS_CLOCK_HZ / 1000000U);
+    if(acqStats.publishUs > acqStats.maxPublishUs){
+        acqStats.maxPublishUs = acqStats.publishUs;
+    }
+}
+
+/**************************************************************************************
+ * Acquire Functions
+ * acquire_Serial waits out the conversion it just triggered. acquire_Pipelined reads
+ * the conversion triggered last time and starts the next one before publishing. If
+ * that conversion is not done yet (first sample, a very short period or a slow
+ * profile) the read is put off with a one-shot timer instead of waiting.
+ * Both return 1 if a sample was published, a sample that could not be read is
+ * dropped.
+ ***************************************************************************************
+*/
+static uint8_t acquire_Serial(void){
+    TELEM_Sample sample;
+
+    TW_stop(&conversionTimer);
+    start_Conversion(1);
+    BSP_delayUs(acqStats.conversionUs);
+    if(!read_Sample(&sample)){
+        return 0;
+    }
+    publish_Sample(&sample);
+    return 1;
+}
+
+static uint8_t acquire_Pipelined(void){
+    TELEM_Sample sample;
+    uint32_t elapsed;
+    uint8_t read;
+
+    if(conversionTimer.active){
+        return 0;
+    }
+    if(!conversionPending){
+        start_Conversion(0);
+        TW_start(&conversionTimer, conversionTicks, 0, conversion_Timer_Callback, 0);
+        return 0;
+    }
+    elapsed = systemTicks - conversionStart;
+    if(elapsed < conversionTicks){
+        acqStats.deferred++;
+        TW_start(&conversionTimer, conversionTicks - elapsed, 0, conversion_Timer_Callback, 0);
+        return 0;
+    }
+
+    read = read_Sample(&sample);
+    start_Conversion(1);
+    if(read){
+        publish_Sample(&sample);
+    }
+    return read;
+}
+
+/**************************************************************************************
+ * Max Rate Function
+ * Highest sustainable sample rate of an acquisition mode in mHz, from the measured
+ * stage times. Serial runs the stages one after the other, pipelined is limited by
+ * the slowest stage: the conversion, the read plus publish, or the output fan-out.
+ ***************************************************************************************
+*/
+uint32_t APP_maxRateMilliHz(uint8_t mode){
+    uint32_t cpuUs = acqStats.maxReadUs + acqStats.maxPublishUs;
+    uint32_t fanOutUs = outStats.maxFanOutUs;
+    uint32_t periodUs;
+
+    if(mode == CMD_ACQ_SERIAL){
+        periodUs = acqStats.conversionUs + cpuUs + fanOutUs;
+    } else {
+        periodUs = acqStats.conversionUs;
+        if(cpuUs > periodUs){
+            periodUs = cpuUs;
+        }
+        if(fanOutUs > periodUs){
+            periodUs = fanOutUs;
+        }
+    }
+    return (periodUs != 0) ? 1000000000UL / periodUs : 0;
+}
+
+/**************************************************************************************
+ * Timer and Interrupt Callbacks
+ * These only post events, the work happens in the handlers below
+ ***************************************************************************************
+*/
+static void sample_Timer_Callback(void *arg){
+    uint32_t period = BSP_MS_TO_TICKS(runtimeConfig.samplePeriodMs);
+
+    AO_post(&sensorAO, APP_SIG_SAMPLE, 0);
+    //Pick up a sample period changed through the command interface
+    if(sampleTimer.period != period){
+        TW_start(&sampleTimer, period, period, sample_Timer_Callback, 0);
+    }
+}
+
+static void conversion_Timer_Callback(void *arg){
+    AO_post(&sensorAO, APP_SIG_SAMPLE, 0);
+}
+
+//Called from the I2C1 interrupt when the acquisition queued a sample
+static void acquisition_Ready_Callback(void){
+    AO_post(&sensorAO, APP_SIG_READING, 0);
+}
+
+static void telemetry_Retry_Callback(void *arg){
+    AO_post(&telemetryAO, APP_SIG_DRAIN, 0);
+}
+
+//Called from the debounce timer interrupt
+static void button_Press_Callback(uint8_t button){
+    AO_post(&displayAO, APP_SIG_BUTTON, button);
+}
+
+static void ui_Refresh_Callback(void){
+    AO_post(&displayAO, APP_SIG_REFRESH, 0);
+}
+
+static void command_Rx_Callback(void){
+    if(!commandRxPending){
+        commandRxPending = 1;
+        AO_post(&commandAO, APP_SIG_RX, 0);
+    }
+}
+
+/**************************************************************************************
+ * Active Object Handlers
+ ***************************************************************************************
+*/
+/*
+ * In interrupt mode the sample tick only makes sure the timer driven acquisition
+ * runs with the current period, the samples arrive as APP_SIG_READING. In the other
+ * modes the tick does the acquisition itself, once the last interrupt driven
+ * sequence is over: it publishes the latest reading from its interrupt, and the
+ * reading has room for a single writer. What it queued is dropped.
+ */
+static void sensor_Handler(ActiveObject *me, const AO_Event *e){
+    uint32_t periodUs = runtimeConfig.samplePeriodMs * 1000;
+    TELEM_Sample sample;
+    uint8_t published = 0;
+
+    if(e->sig == APP_SIG_SAMPLE){
+        if(runtimeConfig.acquisitionMode == CMD_ACQ_INTERRUPT){
+            TW_stop(&conversionTimer);
+            if(!ACQ_running() || ACQ_periodUs() != periodUs){
+                ACQ_start(periodUs);
+            }
+            return;
+        }
+        if(ACQ_running()){
+            ACQ_stop();
+        }
+        if(ACQ_busy()){
+            //A stuck bus raises no interrupts, the stopped ticks no longer check it
+            if(bme280Transport->queued){
+                I2C_checkTimeout(bme280Bus);
+            }
+            return;
+        }
+        ACQ_flush();
+        if(runtimeConfig.acquisitionMode == CMD_ACQ_SERIAL){
+            published = acquire_Serial();
+        } else {
+            published = acquire_Pipelined();
+        }
+    } else if(e->sig == APP_SIG_READING){
+        if(runtimeConfig.acquisitionMode != CMD_ACQ_INTERRUPT){
+            ACQ_flush();
+            return;
+        }
+        while(ACQ_getSample(&sample)){
+            publish_Sample(&sample);
+            published = 1;
+        }
+    }
+    if(published){
+        AO_post(&telemetryAO, APP_SIG_DRAIN, 0);
+        AO_post(&displayAO, APP_SIG_DRAIN, 0);
+    }
+}
+
+/*
+ * The UART sinks only queue what fits in the TX rings. If they could not finish,
+ * come back a tick later once the UARTs had time to send some of it.
+ */
+static void telemetry_Handler(ActiveObject *me, const AO_Event *e){
+    uint8_t more;
+
+    if(e->sig == APP_SIG_DRAIN){
+        more = OUT_drainSink(&pcSink);
+        more |= OUT_drainSink(&phoneSink);
+        if(more && !telemetryRetryTimer.active){
+            TW_start(&telemetryRetryTimer, 1, 0, telemetry_Retry_Callback, 0);
+        }
+    }
+}
+
+static void command_Handler(ActiveObject *me, const AO_Event *e){
+    if(e->sig == APP_SIG_RX){
+        commandRxPending = 0;
+        CMD_poll();
+    }
+}
+
+/*
+ * Draws one value per event and posts to itself for the next, so sampling can get in
+ * between. A page switch draws the whole page in one event.
+ */
+static void display_Handler(ActiveObject *me, const AO_Event *e){
+    if(e->sig == APP_SIG_DRAIN){
+        if(OUT_drainSink(&oledSink)){
+            AO_post(me, APP_SIG_DRAIN, 0);
+        }
+    } else if(e->sig == APP_SIG_BUTTON){
+        UI_button((uint8_t)e->param);
+    } else if(e->sig == APP_SIG_REFRESH){
+        UI_refresh();
+    }
+}
+
+/**************************************************************************************
+ * Application Start Function
+ * Starts the active objects, hooks the UART0 receive interrupt up to the command
+ * object and the buttons up to the display object, shows the first page of the
+ * display and starts the sample timer and, in interrupt mode, the acquisition
+ ***************************************************************************************
+*/
+void APP_start(void){
+    uint32_t period = BSP_MS_TO_TICKS(runtimeConfig.samplePeriodMs);
+
+    AO_start(&displayAO, "display", APP_PRIO_DISPLAY, display_Handler, displayQueue, 8);
+    AO_start(&commandAO, "command", APP_PRIO_COMMAND, command_Handler, commandQueue, 4);
+    AO_start(&telemetryAO, "telemetry", APP_PRIO_TELEMETRY, telemetry_Handler, telemetryQueue, 8);
+    AO_start(&sensorAO, "sensor", APP_PRIO_SENSOR, sensor_Handler, sensorQueue, 4);
+
+    setUartRxCallback(UART0, command_Rx_Callback);
+    UI_init(ui_Refresh_Callback);
+    BTN_init(button_Press_Callback);
+    ACQ_init(acquisition_Ready_Callback);
+    if(runtimeConfig.acquisitionMode == CMD_ACQ_INTERRUPT){
+        ACQ_start(runtimeConfig.samplePeriodMs * 1000);
+    } else {
+        //Get the first conversion going so the first pipelined sample has a result to read
+        start_Conversion(0);
+    }
+    TW_start(&sampleTimer, period, period, sample_Timer_Callback, 0);
+}
@@ -0,0 +1,69 @@
+/*
+ * active_objects.h
+ *
+ * The active objects of the application, highest priority first:
+ *  Sensor      reads the BME280 on every sample timer tick, or takes the samples of
+ *              the interrupt driven acquisition, and publishes the reading
+ *  Telemetry   drains the UART0 (PC) and UART3 (phone) output sinks
+ *  Command     runs commands received on UART0
+ *  Display     drains the OLED sink, one value per event, and switches the pages of
+ *              the display on the buttons (see UI\ui.h)
+ * Slow work is split into one step per event, so a waiting sample is never held
+ * up by more than a single step of a lower priority object.
+ *
+ * Acquisition runs in one of three modes (runtimeConfig.acquisitionMode):
+ *  Serial      trigger a conversion, wait for it, read, publish. The sensor object
+ *              is busy for the whole conversion time on every sample.
+ *  Pipelined   read the conversion triggered on the previous sample, trigger the
+ *              next one straight away and publish while the sensor converts. The
+ *              conversion, the bus read and the output fan-out then overlap, the
+ *              cost is that each reading is one sample period old.
+ *  Interrupt   the default, the timer and I2C interrupts do the whole sequence
+ *              (see ACQ\acquisition.h) and the sensor object only publishes the
+ *              samples they queue. Sampling no longer depends on the main loop.
+ * The time of each stage is kept in acqStats so the highest sample rate of both
+ * modes can be worked out (see APP_maxRateMilliHz).
+ */
+
+#ifndef ACTIVE_OBJECTS_H_
+#define ACTIVE_OBJECTS_H_
+
+#include "SCHED\scheduler.h"
+
+#define APP_PRIO_DISPLAY        1
+#define APP_PRIO_COMMAND        2
+#define APP_PRIO_TELEMETRY      3
+#define APP_PRIO_SENSOR         4
+
+//Event signals
+#define APP_SIG_SAMPLE          1
+#define APP_SIG_DRAIN           2
+#define APP_SIG_RX              3
+#define APP_SIG_READING         4
+#define APP_SIG_BUTTON          5       //param is the button
+#define APP_SIG_REFRESH         6
+
+typedef struct
+{
+    uint32_t conversionUs;      //BME280 worst case conversion time of the profile
+    uint32_t readUs;            //burst read and compensation of the last sample
+    uint32_t maxReadUs;
+    uint32_t publishUs;         //formatting and queuing of the last sample
+    uint32_t maxPublishUs;
+    uint32_t deferred;          //pipelined samples that had to wait for the conversion
+    uint32_t jitterUs;          //deviation of the last conversion start from the period
+    uint32_t maxJitterUs;
+    uint32_t busErrors;         //failed triggers and reads, the sample is skipped
+} APP_AcqStats;
+
+extern APP_AcqStats acqStats;
+
+extern ActiveObject sensorAO;
+extern ActiveObject telemetryAO;
+extern ActiveObject commandAO;
+extern ActiveObject displayAO;
+
+void     APP_start(void);
+uint32_t APP_maxRateMilliHz(uint8_t mode);
+
+#endif /* ACTIVE_OBJECTS_H_ */
@@ -5,52 +5,225 @@
  *      Author: Robert
  */
 
+#include <string.h>
 #include "BME280_I2C.h"
 
+uint8_t bme280Profile;
+I2C0_Type *bme280Bus = I2C1;
+uint8_t bme280Address = BME280_ADDRESS;
+uint8_t bme280ChipId;
+
+static uint8_t BME280_i2cRead(uint8_t reg, uint8_t *data, uint8_t length);
+static uint8_t BME280_i2cWrite(const uint8_t *data, uint8_t length);
+
+BME280_Transport bme280I2CTransport = {.name = "I2C", .read = BME280_i2cRead, .write = BME280_i2cWrite, .queued = 1};
+BME280_Transport *bme280Transport = &bme280I2CTransport;
+
+//osrs_t and osrs_h for each oversampling profile, pressure is always x1
+static const uint8_t bme280ProfileOsrs[BME280_NUM_PROFILES][2] =
+{
+    {BME280_OSRS_X1, BME280_OSRS_X1},
+    {BME280_OSRS_X4, BME280_OSRS_X4},
+    {BME280_OSRS_X16, BME280_OSRS_X16}
+};
+
+/**************************************************************************************
+ * BME280 I2C Transport Functions
+ * Register read and write over I2C, the register address is written first and the
+ * data read after a repeated start
+ ***************************************************************************************
+*/
+static uint8_t BME280_i2cRead(uint8_t reg, uint8_t *data, uint8_t length){
+    return I2C_ReadBytes(bme280Bus, bme280Address, reg, data, length);
+}
+
+static uint8_t BME280_i2cWrite(const uint8_t *data, uint8_t length){
+    return I2C_transfer(bme280Bus, bme280Address, data, length, 0, 0);
+}
 
 /**************************************************************************************
  * BME280 initialization Function
  * This function sets up configurations for the BME280
  * BME280_REGISTER_CONTROLHUMID: 0x01 = oversampling for humidity
  * BME280_REGISTER_CONTROL: 0x27 sets oversampling for temp, pressure, and sensor mode
+ * The sensor is at address on the given I2C bus, which is set up if it is not yet.
+ * See BME280_InitSsi for a sensor on SPI, both go on with BME280_start. Returns the
+ * I2C status, like all functions here that talk to the sensor. If there is no BME280
+ * at the address the sensor set before is kept and the address gets no priority.
+ ***************************************************************************************
+*/
+uint8_t BME280_Init(I2C0_Type *bus, uint8_t address){
+    I2C0_Type *previousBus = bme280Bus;
+    uint8_t previousAddress = bme280Address;
+    BME280_Transport *previousTransport = bme280Transport;
+    uint8_t status;
+
+    bme280Bus = bus;
+    bme280Address = address;
+    bme280Transport = &bme280I2CTransport;
+    I2C_init(bus);
+    status = BME280_start();
+    if(status != I2C_STATUS_DONE){
+        bme280Bus = previousBus;
+        bme280Address = previousAddress;
+        bme280Transport = previousTransport;
+        return status;
+    }
+    //Sensor reads go ahead of display writes queued on the same bus
+    I2C_setPriority(bus, address, I2C_PRIORITY_HIGH);
+    return status;
+}
+
+/**************************************************************************************
+ * BME280 Start Function
+ * The part of the init functions that is the same for every transport. The chip ID
+ * tells a BME280 from a BMP280, which has no humidity and is read with its humidity
+ * coefficients at 0 (humidity then always comes out as 0). I2C_STATUS_ERROR if the
+ * chip is neither.
+ ***************************************************************************************
+*/
+uint8_t BME280_start(void){
+    uint8_t status = bme280Transport->read(BME280_REGISTER_CHIPID, &bme280ChipId, 1);
+
+    if(status != I2C_STATUS_DONE){
+        return status;
+    }
+    if(bme280ChipId != BME280_CHIP_ID && bme280ChipId != BMP280_CHIP_ID){
+        return I2C_STATUS_ERROR;
+    }
+    status = BME280_I2C_readSensorCoefficients();
+
+    if(status != I2C_STATUS_DONE){
+        return status;
+    }
+    return BME280_setOversampling(BME280_PROFILE_LOW);
+}
+
+/**************************************************************************************
+ * BME280 Set Oversampling Function
+ * Writes the oversampling profile to the sensor. Changes to ctrl_hum only become
+ * active after ctrl_meas is written, so both are always written together, ctrl_hum
+ * first. The sensor is left in sleep mode, every conversion is started with
+ * BME280_triggerConversion (forced mode).
+ ***************************************************************************************
+*/
+uint8_t BME280_setOversampling(uint8_t profile){
+    if(profile >= BME280_NUM_PROFILES){
+        return I2C_STATUS_ERROR;
+    }
+    bme280Profile = profile;
+
+    uint8_t initVar[4] = {BME280_REGISTER_CONTROLHUMID, bme280ProfileOsrs[profile][1],
+                          BME280_REGISTER_CONTROL, (bme280ProfileOsrs[profile][0] << 5) | (BME280_OSRS_X1 << 2) | BME280_MODE_SLEEP};
+    return bme280Transport->write(initVar, 4);
+}
+
+/**************************************************************************************
+ * BME280 Trigger Conversion Function
+ * Starts a single forced mode conversion with the current oversampling profile. The
+ * results can be read BME280_conversionTimeUs() later, the sensor then goes back to
+ * sleep by itself.
  ***************************************************************************************
 */
-void BME280_Init(void){
-    BME280_I2C_readSensorCoefficients();
+uint8_t BME280_triggerConversion(void){
+    uint8_t trigger[2] = {BME280_REGISTER_CONTROL, BME280_forcedControl()};
+    return bme280Transport->write(trigger, 2);
+}
+
+//ctrl_meas value that starts a forced conversion with the current profile
+uint8_t BME280_forcedControl(void){
+    return (bme280ProfileOsrs[bme280Profile][0] << 5) | (BME280_OSRS_X1 << 2) | BME280_MODE_FORCED;
+}
 
-    uint8_t initVar[4] = {BME280_REGISTER_CONTROLHUMID, 0x01, BME280_REGISTER_CONTROL, 0x27};
-    I2C_Write(BME280_ADDRESS, initVar, 4);
+/**************************************************************************************
+ * BME280 Conversion Time Function
+ * Maximum measurement time from datasheet section 9.1 for the current profile:
+ * 1.25ms + 2.3ms*T + (2.3ms*P + 0.575ms) + (2.3ms*H + 0.575ms)
+ * where T, P and H are the oversampling factors (pressure is always x1)
+ ***************************************************************************************
+*/
+uint32_t BME280_conversionTimeUs(void){
+    uint32_t osrsT = 1U << (bme280ProfileOsrs[bme280Profile][0] - 1);
+    uint32_t osrsH = 1U << (bme280ProfileOsrs[bme280Profile][1] - 1);
+    return 1250 + 2300 * osrsT + (2300 + 575) + (2300 * osrsH + 575);
 }
 
 /**************************************************************************************
  * BME280 Reading calibration coefficients
  * This functions reads preset calibration coefficients that can be different in
  * each device. These are used to convert temperature and humidity into
- * readable data
+ * readable data. The temperature and humidity blocks are each read in one burst.
+ * On an error the coefficients are left as they were. A BMP280 has no humidity
+ * coefficients, they are set to 0. BME280_readCalibration does the same for any
+ * sensor on I2C into cal, both leave the decoding to BME280_parseCalibration.
  ***************************************************************************************
 */
-void BME280_I2C_readSensorCoefficients(void){
-    cal_data.dig_T1 = read16_Reverse(BME280_ADDRESS, BME280_DIG_T1_REG);
-    cal_data.dig_T2 = readS16_Reverse(BME280_ADDRESS, BME280_DIG_T2_REG);
-    cal_data.dig_T3 = readS16_Reverse(BME280_ADDRESS, BME280_DIG_T3_REG);
-    cal_data.dig_H1 = I2C_Read8(BME280_ADDRESS, BME280_DIG_H1_REG);
-    cal_data.dig_H2 = readS16_Reverse(BME280_ADDRESS, BME280_DIG_H2_REG);
-    cal_data.dig_H3 = I2C_Read8(BME280_ADDRESS,BME280_DIG_H3_REG);
-    cal_data.dig_H4 = (I2C_Read8(BME280_ADDRESS, BME280_DIG_H4_REG) << 4) | (I2C_Read8(BME280_ADDRESS, BME280_DIG_H4_REG+1) & 0xF);
-    cal_data.dig_H5 = (I2C_Read8(BME280_ADDRESS, BME280_DIG_H5_REG+1) << 4) | (I2C_Read8(BME280_ADDRESS, BME280_DIG_H5_REG) >> 4);
-    cal_data.dig_H6 = (int8_t)I2C_Read8(BME280_ADDRESS, BME280_DIG_H6_REG);
+static void BME280_parseCalibration(const uint8_t *t, uint8_t h1, const uint8_t *h, struct BME280_Calibration_Data *cal);
+
+uint8_t BME280_I2C_readSensorCoefficients(void){
+    uint8_t t[6];       //dig_T1 to dig_T3 from 0x88, LSB first
+    uint8_t h[7];       //dig_H2 to dig_H6 from 0xE1
+    uint8_t h1 = 0;
+    uint8_t status;
+
+    memset(h, 0, sizeof(h));
+    status = bme280Transport->read(BME280_DIG_T1_REG, t, sizeof(t));
+    if(bme280ChipId != BMP280_CHIP_ID){
+        if(status == I2C_STATUS_DONE){
+            status = bme280Transport->read(BME280_DIG_H1_REG, &h1, 1);
+        }
+        if(status == I2C_STATUS_DONE){
+            status = bme280Transport->read(BME280_DIG_H2_REG, h, sizeof(h));
+        }
+    }
+    if(status == I2C_STATUS_DONE){
+        BME280_parseCalibration(t, h1, h, &cal_data);
+    }
+    return status;
+}
+
+uint8_t BME280_readCalibration(I2C0_Type *bus, uint16_t device, uint8_t chipId, struct BME280_Calibration_Data *cal){
+    uint8_t t[6];
+    uint8_t h[7];
+    uint8_t h1 = 0;
+    uint8_t status;
+
+    memset(h, 0, sizeof(h));
+    status = I2C_ReadBytes(bus, device, BME280_DIG_T1_REG, t, sizeof(t));
+    if(chipId != BMP280_CHIP_ID){
+        if(status == I2C_STATUS_DONE){
+            status = I2C_Read8(bus, device, BME280_DIG_H1_REG, &h1);
+        }
+        if(status == I2C_STATUS_DONE){
+            status = I2C_ReadBytes(bus, device, BME280_DIG_H2_REG, h, sizeof(h));
+        }
+    }
+    if(status == I2C_STATUS_DONE){
+        BME280_parseCalibration(t, h1, h, cal);
+    }
+    return status;
+}
+
+static void BME280_parseCalibration(const uint8_t *t, uint8_t h1, const uint8_t *h, struct BME280_Calibration_Data *cal){
 
+    cal->dig_T1 = (uint16_t)(t[0] | (t[1] << 8));
+    cal->dig_T2 = (int16_t)(t[2] | (t[3] << 8));
+    cal->dig_T3 = (int16_t)(t[4] | (t[5] << 8));
+    cal->dig_H1 = h1;
+    cal->dig_H2 = (int16_t)(h[0] | (h[1] << 8));
+    cal->dig_H3 = h[BME280_DIG_H3_REG - BME280_DIG_H2_REG];
+    cal->dig_H4 = (h[BME280_DIG_H4_REG - BME280_DIG_H2_REG] << 4) | (h[BME280_DIG_H4_REG - BME280_DIG_H2_REG + 1] & 0xF);
+    cal->dig_H5 = (h[BME280_DIG_H5_REG - BME280_DIG_H2_REG + 1] << 4) | (h[BME280_DIG_H5_REG - BME280_DIG_H2_REG] >> 4);
+    cal->dig_H6 = (int8_t)h[BME280_DIG_H6_REG - BME280_DIG_H2_REG];
 }
 
 /**************************************************************************************
- * BME280 Read Temperature Function
- * This function was given in the BME280 datasheet page 23
+ * BME280 Temperature Compensation Function
+ * This function was given in the BME280 datasheet page 23. Works on adc_T and sets
+ * t_fine, which the humidity compensation needs.
  ***************************************************************************************
 */
-void BME280_I2C_readTemperature(void){
-    adc_T = I2C_Read24(BME280_ADDRESS, BME280_REGISTER_TEMPDATA);
-    adc_T >>= 4;
-
+static void BME280_compensateTemperature(void){
     var1  = ((((adc_T>>3) - ((int64_t)cal_data.dig_T1 <<1))) * ((int64_t)cal_data.dig_T2)) >> 11;
     var2  = ((((((adc_T>>4) - ((int64_t)cal_data.dig_T1)) * ((adc_T>>4) - ((int64_t)cal_data.dig_T1))) >> 12) * ((int64_t)cal_data.dig_T3)) >> 14);
     t_fine = var1 + var2;
@@ -58,16 +231,14 @@ void BME280_I2C_readTemperature(void){
 
     temperature  = (t_fine * 5 + 128) >> 8;
     temperatureF = ((temperature / 100)* 1.8 + 32);
-
 }
 
 /**************************************************************************************
- * BME280 Read Humidity Function
- * This function was given in the BME280 datasheet page 50
+ * BME280 Humidity Compensation Function
+ * This function was given in the BME280 datasheet page 50. Works on adc_H and t_fine.
  ***************************************************************************************
 */
-void BME280_I2C_readHumidity(void){
-    adc_H = I2C_Read16(BME280_ADDRESS, BME280_REGISTER_HUMIDDATA);
+static void BME280_compensateHumidity(void){
     humidity = (((double)t_fine) - 76800.0);
     humidity = (adc_H - (((double)cal_data.dig_H4) * 64.0 + ((double)cal_data.dig_H5) / 16384.0 * humidity))*(((double)cal_data.dig_H2) / 65536.0 * (1.0 + ((double)cal_data.dig_H6) / 67108864.0 * humidity *(1.0 + ((double)cal_data.dig_H3) / 67018864.0 * humidity)));
     humidity = humidity * (1.0 - ((double)cal_data.dig_H1) * humidity / 524288.0);
@@ -78,3 +249,123 @@ void BME280_I2C_readHumidity(void){
     }
 }
 
+/**************************************************************************************
+ * BME280 Read Temperature Function
+ * Reads the 20 bit temperature result and compensates it
+ ***************************************************************************************
+*/
+uint8_t BME280_I2C_readTemperature(void){
+    uint8_t data[3];
+    uint8_t status = bme280Transport->read(BME280_REGISTER_TEMPDATA, data, 3);
+
+    if(status == I2C_STATUS_DONE){
+        adc_T = (((uint32_t)data[0] << 16) | ((uint32_t)data[1] << 8) | data[2]) >> 4;
+        BME280_compensateTemperature();
+    }
+    return status;
+}
+
+/**************************************************************************************
+ * BME280 Read Humidity Function
+ * Reads the 16 bit humidity result and compensates it, uses the t_fine of the last
+ * temperature read
+ ***************************************************************************************
+*/
+uint8_t BME280_I2C_readHumidity(void){
+    uint8_t data[2];
+    uint8_t status = bme280Transport->read(BME280_REGISTER_HUMIDDATA, data, 2);
+
+    if(status == I2C_STATUS_DONE){
+        adc_H = ((uint16_t)data[0] << 8) | data[1];
+        BME280_compensateHumidity();
+    }
+    return status;
+}
+
+/**************************************************************************************
+ * BME280 Compensate Function
+ * Turns the 5 bytes of a burst read from 0xFA into temperature and humidity using the
+ * 32 bit integer formulas of the datasheet (section 4.2.3), so it can run in an
+ * interrupt without touching the FPU or the globals above. Humidity comes out in
+ * Q22.10 %rH and is converted to 0.01 %rH. BME280_compensateWith uses the
+ * coefficients of another sensor.
+ ***************************************************************************************
+*/
+void BME280_compensate(const uint8_t *burst, BME280_Result *result){
+    BME280_compensateWith(&cal_data, burst, result);
+}
+
+void BME280_compensateWith(const struct BME280_Calibration_Data *cal, const uint8_t *burst, BME280_Result *result){
+    int32_t adcT = ((uint32_t)burst[0] << 12) | ((uint32_t)burst[1] << 4) | (burst[2] >> 4);
+    int32_t adcH = ((uint32_t)burst[3] << 8) | burst[4];
+    int32_t t1;
+    int32_t t2;
+    int32_t h;
+
+    t1 = ((((adcT >> 3) - ((int32_t)cal->dig_T1 << 1))) * ((int32_t)cal->dig_T2)) >> 11;
+    t2 = (((((adcT >> 4) - ((int32_t)cal->dig_T1)) * ((adcT >> 4) - ((int32_t)cal->dig_T1))) >> 12) *
+          ((int32_t)cal->dig_T3)) >> 14;
+    result->tFine = t1 + t2;
+    result->temperature = (result->tFine * 5 + 128) >> 8;
+
+    h = result->tFine - ((int32_t)76800);
+    h = (((((adcH << 14) - (((int32_t)cal->dig_H4) << 20) - (((int32_t)cal->dig_H5) * h)) +
+          ((int32_t)16384)) >> 15) * (((((((h * ((int32_t)cal->dig_H6)) >> 10) *
+          (((h * ((int32_t)cal->dig_H3)) >> 11) + ((int32_t)32768))) >> 10) + ((int32_t)2097152)) *
+          ((int32_t)cal->dig_H2) + 8192) >> 14));
+    h = h - (((((h >> 15) * (h >> 15)) >> 7) * ((int32_t)cal->dig_H1)) >> 4);
+    result->humidityClamped = (h <= 0 || h >= 419430400);
+    h = (h < 0) ? 0 : h;
+    h = (h > 419430400) ? 419430400 : h;
+
+    result->adcT = (uint32_t)adcT;
+    result->adcH = (uint16_t)adcH;
+    result->humidity = (uint16_t)((((uint32_t)h >> 12) * 100) >> 10);
+}
+
+/**************************************************************************************
+ * BME280 Read Sample Function
+ * Reads temperature and humidity in a single 5 byte burst instead of two separate
+ * transactions, compensates both and updates the globals above. The globals keep
+ * the last good sample if the read fails. The bus time of the read is kept with the
+ * transport.
+ ***************************************************************************************
+*/
+uint8_t BME280_readSample(void){
+    uint8_t data[BME280_BURST_LENGTH];
+    BME280_Result result;
+    uint32_t start = BSP_CYCLES();
+    uint8_t status = bme280Transport->read(BME280_REGISTER_TEMPDATA, data, BME280_BURST_LENGTH);
+
+    BME280_recordSampleUs((BSP_CYCLES() - start) / (SYS_CLOCK_HZ / 1000000U));
+    if(status != I2C_STATUS_DONE){
+        return status;
+    }
+    BME280_compensate(data, &result);
+    adc_T = result.adcT;
+    adc_H = result.adcH;
+    t_fine = result.tFine;
+    temperature = result.temperature;
+    temperatureF = ((temperature / 100)* 1.8 + 32);
+    humidity = result.humidity / 100.0;
+    return status;
+}
+
+/**************************************************************************************
+ * BME280 Sample Time Functions
+ * BME280_recordSampleUs keeps the bus time of a burst read with the transport it went
+ * over, BME280_measureSampleUs times one blocking burst read over the current
+ * transport (read and compensated like BME280_readSample) and returns it.
+ ***************************************************************************************
+*/
+void BME280_recordSampleUs(uint32_t sampleUs){
+    bme280Transport->sampleUs = sampleUs;
+    if(sampleUs > bme280Transport->maxSampleUs){
+        bme280Transport->maxSampleUs = sampleUs;
+    }
+}
+
+uint32_t BME280_measureSampleUs(void){
+    BME280_readSample();
+    return bme280Transport->sampleUs;
+}
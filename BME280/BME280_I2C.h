@@ -10,14 +10,61 @@
 #include <stdint.h>
 #include "BSP\bsp.h"
 #include "I2C\i2c.h"
+#include "SSI\ssi.h"
 
-void BME280_I2C_readSensorCoefficients(void);
-void BME280_Init(void);
-void BME280_I2C_readTemperature(void);
-void BME280_I2C_readHumidity(void);
+/*
+ * Register access of the sensor. The driver reads and writes its registers only
+ * through bme280Transport, which BME280_Init sets to I2C and BME280_InitSsi to SPI,
+ * everything above that is the same for both. A write is a list of register and
+ * value pairs. Both return the status codes of i2c.h, the SPI ones cannot fail and
+ * always return I2C_STATUS_DONE. queued transports go through the I2C transaction
+ * queue, the interrupt driven acquisition submits those transactions itself and
+ * calls the others directly. sampleUs is the bus time of the last 5 byte burst read
+ * over the transport.
+ */
+typedef struct
+{
+    const char  *name;
+    uint8_t     (*read)(uint8_t reg, uint8_t *data, uint8_t length);
+    uint8_t     (*write)(const uint8_t *data, uint8_t length);
+    uint8_t     queued;
+    uint32_t    sampleUs;
+    uint32_t    maxSampleUs;
+} BME280_Transport;
+
+extern BME280_Transport bme280I2CTransport;
+extern BME280_Transport bme280SsiTransport;
+extern BME280_Transport *bme280Transport;
+
+//SPI mode and clock of the sensor, which takes up to 10 MHz in mode 0 or 3
+#define BME280_SSI_MODE                  SSI_MODE_0
+#define BME280_SSI_HZ                    10000000U
+
+uint8_t BME280_I2C_readSensorCoefficients(void);
+uint8_t BME280_Init(I2C0_Type *bus, uint8_t address);
+uint8_t BME280_InitSsi(SSI0_Type *ssi);
+uint8_t BME280_start(void);
+uint8_t BME280_I2C_readTemperature(void);
+uint8_t BME280_I2C_readHumidity(void);
+uint8_t BME280_setOversampling(uint8_t profile);
+uint8_t BME280_triggerConversion(void);
+uint32_t BME280_conversionTimeUs(void);
+uint8_t BME280_readSample(void);
+uint8_t BME280_forcedControl(void);
+void BME280_recordSampleUs(uint32_t sampleUs);
+uint32_t BME280_measureSampleUs(void);
+
+//I2C controller and address or SSI module, and chip ID of the sensor, set by the init functions
+extern I2C0_Type *bme280Bus;
+extern uint8_t bme280Address;
+extern SSI0_Type *bme280Ssi;
+extern uint8_t bme280ChipId;
 
 //Define name of BME280 address
 #define     BME280_ADDRESS                   0x76
+#define     BME280_ADDRESS_ALT               0x77        //SDO strapped high
+#define     BME280_CHIP_ID                   0x60
+#define     BMP280_CHIP_ID                   0x58
 
 //List of registers needed in code
 #define    BME280_DIG_T1_REG                0x88
@@ -31,11 +78,48 @@ void BME280_I2C_readHumidity(void);
 #define    BME280_DIG_H5_REG                0xE5
 #define    BME280_DIG_H6_REG                0xE7
 
+#define    BME280_REGISTER_CHIPID           0xD0
 #define    BME280_REGISTER_CONTROLHUMID     0xF2
 #define    BME280_REGISTER_CONTROL          0xF4
 #define    BME280_REGISTER_TEMPDATA         0xFA
 #define    BME280_REGISTER_HUMIDDATA        0xFD
 
+//In SPI mode bit 7 of the register address is set to read and cleared to write
+#define    BME280_SPI_READ                  0x80
+
+//Temperature (0xFA-0xFC) and humidity (0xFD-0xFE) can be read in one burst
+#define    BME280_BURST_LENGTH              5
+
+//Oversampling settings (osrs_x fields) and the profiles built from them
+#define    BME280_OSRS_X1                   0x1
+#define    BME280_OSRS_X2                   0x2
+#define    BME280_OSRS_X4                   0x3
+#define    BME280_OSRS_X8                   0x4
+#define    BME280_OSRS_X16                  0x5
+#define    BME280_MODE_SLEEP                0x0
+#define    BME280_MODE_FORCED               0x1
+#define    BME280_MODE_NORMAL               0x3
+
+#define    BME280_PROFILE_LOW               0   //x1 temperature, x1 humidity
+#define    BME280_PROFILE_STANDARD          1   //x4 temperature, x4 humidity
+#define    BME280_PROFILE_HIGH              2   //x16 temperature, x16 humidity
+#define    BME280_NUM_PROFILES              3
+
+extern uint8_t bme280Profile;
+
+//Result of BME280_compensate
+typedef struct
+{
+    uint32_t adcT;
+    uint16_t adcH;
+    int32_t  tFine;
+    int32_t  temperature;       //0.01 degC
+    uint16_t humidity;          //0.01 %rH
+    uint8_t  humidityClamped;   //humidity hit 0 or 100 %rH
+} BME280_Result;
+
+void BME280_compensate(const uint8_t *burst, BME280_Result *result);
+
 volatile float      tempcal;        // stores the temp offset calibration
 int32_t             temperature;    //stors temperature in Celsius
 volatile float      temperatureF;   // stores temperature value in fahrenheit
@@ -68,4 +152,11 @@ struct BME280_Calibration_Data
 };
 
 struct BME280_Calibration_Data cal_data;
+
+/*
+ * Calibration and compensation of any BME280, for sensors other than the one set by
+ * BME280_Init (see ZONES\zones.h). device is a 7-bit address or I2C_MUX_DEVICE.
+ */
+uint8_t BME280_readCalibration(I2C0_Type *bus, uint16_t device, uint8_t chipId, struct BME280_Calibration_Data *cal);
+void BME280_compensateWith(const struct BME280_Calibration_Data *cal, const uint8_t *burst, BME280_Result *result);
 #endif /* BME280_I2C_H_ */
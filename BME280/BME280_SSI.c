@@ -0,0 +1,75 @@
+/*
+ * BME280_SSI.c
+ *
+ * SPI transport of the BME280 driver, see BME280_I2C.h. The sensor picks SPI for good
+ * when it sees CSB low after power-up, so a sensor wired for SPI does not answer on
+ * I2C until it is power cycled.
+ */
+
+#include "BME280_I2C.h"
+
+SSI0_Type *bme280Ssi = SSI0;
+
+static uint8_t BME280_ssiRead(uint8_t reg, uint8_t *data, uint8_t length);
+static uint8_t BME280_ssiWrite(const uint8_t *data, uint8_t length);
+
+BME280_Transport bme280SsiTransport = {.name = "SPI", .read = BME280_ssiRead, .write = BME280_ssiWrite, .queued = 0};
+
+/**************************************************************************************
+ * BME280 SPI Transport Functions
+ * A read sends the register address with bit 7 set and clocks the data out after
+ * it, the address auto-increments like on I2C. A write sends each register with
+ * bit 7 cleared followed by its value, all pairs with the chip selected once. The
+ * acquisition also calls these from its timer interrupt, so interrupts are held off
+ * for the transfer, 7 bytes at 8 MHz take about 10 us.
+ ***************************************************************************************
+*/
+static uint8_t BME280_ssiRead(uint8_t reg, uint8_t *data, uint8_t length){
+    uint32_t primask = __get_PRIMASK();
+    uint8_t address = reg | BME280_SPI_READ;
+
+    __disable_irq();
+    SSI_select(bme280Ssi, 1);
+    SSI_transfer(bme280Ssi, &address, 0, 1);
+    SSI_transfer(bme280Ssi, 0, data, length);
+    SSI_select(bme280Ssi, 0);
+    __set_PRIMASK(primask);
+    return I2C_STATUS_DONE;
+}
+
+static uint8_t BME280_ssiWrite(const uint8_t *data, uint8_t length){
+    uint32_t primask = __get_PRIMASK();
+    uint8_t pair[2];
+    uint8_t i;
+
+    __disable_irq();
+    SSI_select(bme280Ssi, 1);
+    for(i = 0; i + 1 < length; i += 2){
+        pair[0] = data[i] & ~BME280_SPI_READ;
+        pair[1] = data[i + 1];
+        SSI_transfer(bme280Ssi, pair, 0, 2);
+    }
+    SSI_select(bme280Ssi, 0);
+    __set_PRIMASK(primask);
+    return I2C_STATUS_DONE;
+}
+
+/**************************************************************************************
+ * BME280 SPI initialization Function
+ * Same as BME280_Init for a sensor on an SSI module, its FSS pin as chip select, in
+ * mode 0 at BME280_SSI_HZ or the fastest the module can do below it. A missing
+ * sensor reads as a wrong chip ID, I2C_STATUS_ERROR, and the driver is left on I2C.
+ ***************************************************************************************
+*/
+uint8_t BME280_InitSsi(SSI0_Type *ssi){
+    uint8_t status;
+
+    bme280Ssi = ssi;
+    bme280Transport = &bme280SsiTransport;
+    SSI_init(ssi, BME280_SSI_HZ, BME280_SSI_MODE);
+    status = BME280_start();
+    if(status != I2C_STATUS_DONE){
+        bme280Transport = &bme280I2CTransport;
+    }
+    return status;
+}
@@ -1,19 +1,95 @@
 /* Board Support Package */
 #include "bsp.h"
+
+//Number of SysTick interrupts since reset, systemTicksHigh counts the wraps
+volatile uint32_t systemTicks;
+static volatile uint32_t systemTicksHigh;
+
 __attribute__((naked)) void assert_failed (char const *file, int line){
     NVIC_SystemReset(); /* reset the system */
 }
 
 void SysTick_Init(void){
-    SysTick->LOAD = SYS_CLOCK_HZ/2U - 1U;
+    SysTick->LOAD = SYS_CLOCK_HZ/SYS_TICKS_PER_SEC - 1U;
     SysTick->VAL = 0U;
     SysTick->CTRL = (1U<<2) | (1U<<1) | 1U;
 }
 
+/*
+ * Enables the DWT cycle counter so code can be timed in CPU cycles through
+ * BSP_CYCLES(). TRCENA has to be set in DEMCR before the DWT can be used.
+ */
+void BSP_cycleCounterInit(void){
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0U;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+/*
+ * Busy waits for the given number of milliseconds using the cycle counter, for the
+ * few places (module start-up) that need shorter delays than a SysTick period
+ */
+void BSP_delayMs(uint32_t ms){
+    uint32_t start = BSP_CYCLES();
+    uint32_t cycles = ms * (SYS_CLOCK_HZ / 1000U);
+    while((BSP_CYCLES() - start) < cycles);
+}
+
+//Microsecond version of BSP_delayMs, e.g. for waiting out a sensor conversion
+void BSP_delayUs(uint32_t us){
+    uint32_t start = BSP_CYCLES();
+    uint32_t cycles = us * (SYS_CLOCK_HZ / 1000000U);
+    while((BSP_CYCLES() - start) < cycles);
+}
+
+/*
+ * Monotonic 64-bit tick count since reset. The two halves are read again if the
+ * SysTick interrupt wrapped the low half in between, so no locking is needed.
+ */
+uint64_t BSP_uptimeTicks(void){
+    uint32_t high;
+    uint32_t low;
+    do {
+        high = systemTicksHigh;
+        low = systemTicks;
+    } while(high != systemTicksHigh);
+    return ((uint64_t)high << 32) | low;
+}
+
+/*
+ * Sets up WTIMER0 as a concatenated 64-bit periodic up counter with the full 64-bit
+ * reload value, so it runs from 0 at the system clock and never wraps in practice.
+ * The prescaler cannot be used in 64-bit mode, BSP_timestampUs does the division.
+ */
+void BSP_timestampInit(void){
+    SYSCTL->RCGCWTIMER |= (1U<<0);
+    while((SYSCTL->PRWTIMER & (1U<<0)) == 0);
+    WTIMER0->CTL = 0U;
+    WTIMER0->CFG = 0x0U;                //64-bit timer (A and B concatenated)
+    WTIMER0->TAMR = (1U<<4) | 0x2U;     //count up, periodic
+    WTIMER0->TAILR = 0xFFFFFFFFU;
+    WTIMER0->TBILR = 0xFFFFFFFFU;
+    WTIMER0->TAV = 0U;
+    WTIMER0->TBV = 0U;
+    WTIMER0->CTL = (1U<<0);             //TAEN starts the whole 64-bit counter
+}
+
+/*
+ * Microseconds since BSP_timestampInit. The upper half is read again if the lower
+ * half wrapped in between, the same way as BSP_uptimeTicks.
+ */
+uint64_t BSP_timestampUs(void){
+    uint32_t high;
+    uint32_t low;
+    do {
+        high = WTIMER0->TBV;
+        low = WTIMER0->TAV;
+    } while(high != WTIMER0->TBV);
+    return (((uint64_t)high << 32) | low) / BSP_TIMESTAMP_TICKS_PER_US;
+}
+
 void SysTick_Handler(void){
-    if(systemCtr == 6){
-        systemCtr = 0;
-    } else {
-        systemCtr++;
+    if(++systemTicks == 0U){
+        systemTicksHigh++;
     }
 }
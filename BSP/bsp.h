@@ -3,10 +3,31 @@
 #include "TM4C123GH6PM.h"
 
 void SysTick_Init(void);
+void BSP_cycleCounterInit(void);
+void BSP_delayMs(uint32_t ms);
+void BSP_delayUs(uint32_t us);
+uint64_t BSP_uptimeTicks(void);
+void BSP_timestampInit(void);
+uint64_t BSP_timestampUs(void);
 
 #define SYS_CLOCK_HZ 16000000U
 
-uint8_t systemCtr;
+//SysTick rate, one tick per millisecond by default
+#define SYS_TICKS_PER_SEC 1000U
+#define BSP_MS_TO_TICKS(ms) (((uint32_t)(ms) * SYS_TICKS_PER_SEC + 999U) / 1000U)
+#define BSP_TICKS_TO_MS(t)  ((uint32_t)(t) * (1000U / SYS_TICKS_PER_SEC))
+
+//Milliseconds since reset (low 32 bits), used to timestamp readings and frames
+#define BSP_MILLIS()        BSP_TICKS_TO_MS(systemTicks)
+
+//Current value of the DWT cycle counter, used for profiling
+#define BSP_CYCLES() (DWT->CYCCNT)
+
+//WTIMER0 runs as a 64-bit free-running up counter at the system clock
+#define BSP_TIMESTAMP_TICKS_PER_US  (SYS_CLOCK_HZ / 1000000U)
+
+//Low 32 bits of the tick count, wraps after ~49 days at 1 kHz
+extern volatile uint32_t systemTicks;
 
 
 #endif //__BSP_H__
@@ -0,0 +1,115 @@
+/*
+ * buttons.c
+ *
+ * Interrupt driven, timer debounced launchpad switches, see buttons.h
+ */
+
+#include "buttons.h"
+
+//Bits of the GPTM control (CTL) and interrupt (IMR/ICR) registers
+#define BTN_TIMER_TAEN      (1U<<0)
+#define BTN_TIMER_TATO      (1U<<0)
+
+#define BTN_PORT_BIT        5           //GPIOF in RCGCGPIO
+#define BTN_PINS            ((1U<<4) | (1U<<0))
+
+//Unlocks the commit register of PF0, which is locked after reset as an NMI pin
+#define BTN_UNLOCK_KEY      0x4C4F434BU
+
+BTN_Stats btnStats;
+
+static const uint8_t    btnPins[BTN_NUM_BUTTONS] = {1U<<4, 1U<<0};
+static volatile uint8_t btnPending;
+static void             (*btnCallback)(uint8_t button);
+
+/**************************************************************************************
+ * Buttons Initialize Function
+ * Sets up PF4 and PF0 as inputs with pull-ups and falling edge interrupts, and
+ * TIMER0A as a 32-bit one-shot of BTN_DEBOUNCE_MS at the system clock.
+ * pressCallback is called from the TIMER0A interrupt with BTN_SW1 or BTN_SW2.
+ ***************************************************************************************
+*/
+void BTN_init(void (*pressCallback)(uint8_t button)){
+    btnCallback = pressCallback;
+
+    SYSCTL->RCGCGPIO |= (1U << BTN_PORT_BIT);
+    SYSCTL->RCGCTIMER |= (1U<<0);
+    while((SYSCTL->PRGPIO & (1U << BTN_PORT_BIT)) == 0);
+    while((SYSCTL->PRTIMER & (1U<<0)) == 0);
+
+    //CR is declared read-only in the device header but has to be written to unlock PF0
+    GPIOF->LOCK = BTN_UNLOCK_KEY;
+    *(volatile uint32_t *)&GPIOF->CR |= (1U<<0);
+    GPIOF->LOCK = 0;
+
+    GPIOF->DIR &= ~BTN_PINS;
+    GPIOF->AFSEL &= ~BTN_PINS;
+    GPIOF->AMSEL &= ~BTN_PINS;
+    GPIOF->PUR |= BTN_PINS;
+    GPIOF->DEN |= BTN_PINS;
+    GPIOF->IS &= ~BTN_PINS;         //edge
+    GPIOF->IBE &= ~BTN_PINS;
+    GPIOF->IEV &= ~BTN_PINS;        //falling
+    GPIOF->ICR = BTN_PINS;
+    GPIOF->IM |= BTN_PINS;
+
+    TIMER0->CTL = 0U;
+    TIMER0->CFG = 0x0U;             //32-bit
+    TIMER0->TAMR = 0x1U;            //one-shot, count down
+    TIMER0->TAILR = BTN_DEBOUNCE_MS * (SYS_CLOCK_HZ / 1000U) - 1U;
+    TIMER0->ICR = BTN_TIMER_TATO;
+    TIMER0->IMR = BTN_TIMER_TATO;
+
+    NVIC_EnableIRQ(GPIOF_IRQn);
+    NVIC_EnableIRQ(TIMER0A_IRQn);
+}
+
+/**************************************************************************************
+ * Button Edge Interrupt
+ * Masks the pins that saw an edge so their bounces do not interrupt again and
+ * (re)starts the debounce time, a second switch pressed meanwhile gets the whole
+ * time as well.
+ ***************************************************************************************
+*/
+void GPIOPortF_IRQHandler(void){
+    uint32_t pins = GPIOF->MIS & BTN_PINS;
+
+    GPIOF->IM &= ~pins;
+    GPIOF->ICR = pins;
+    btnPending |= pins;
+    btnStats.edges++;
+
+    TIMER0->CTL &= ~BTN_TIMER_TAEN;
+    TIMER0->TAV = TIMER0->TAILR;
+    TIMER0->CTL |= BTN_TIMER_TAEN;
+}
+
+/**************************************************************************************
+ * Debounce Timer Interrupt
+ * Reads the pending pins once they had time to settle, reports those still held
+ * down and unmasks them again. Edges that came in while a pin was masked are
+ * cleared first, they belong to the bounce just dealt with.
+ ***************************************************************************************
+*/
+void Timer0A_IRQHandler(void){
+    uint8_t pins = btnPending;
+    uint8_t i;
+
+    TIMER0->ICR = BTN_TIMER_TATO;
+    btnPending = 0;
+    for(i = 0; i < BTN_NUM_BUTTONS; i++){
+        if((pins & btnPins[i]) == 0){
+            continue;
+        }
+        if(GPIOF->DATA_Bits[btnPins[i]] == 0){
+            btnStats.presses++;
+            if(btnCallback != 0){
+                btnCallback(i);
+            }
+        } else {
+            btnStats.bounces++;
+        }
+    }
+    GPIOF->ICR = pins;
+    GPIOF->IM |= pins;
+}
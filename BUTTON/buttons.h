@@ -0,0 +1,35 @@
+/*
+ * buttons.h
+ *
+ * The two user switches of the launchpad, SW1 on PF4 and SW2 on PF0. Both pull
+ * their pin to ground, so a press is a falling edge. The edge interrupt masks the
+ * pin and starts TIMER0A for the debounce time, when it runs out the pins are read
+ * again: a pin still low is a press and goes to the press callback (interrupt
+ * context), a pin back high was a bounce or a release. Holding a switch gives one
+ * press.
+ */
+
+#ifndef BUTTONS_H_
+#define BUTTONS_H_
+
+#include <stdint.h>
+#include "BSP\bsp.h"
+
+#define BTN_SW1                 0       //PF4
+#define BTN_SW2                 1       //PF0
+#define BTN_NUM_BUTTONS         2
+
+#define BTN_DEBOUNCE_MS         20U
+
+typedef struct
+{
+    uint32_t edges;             //falling edges seen, bounces included
+    uint32_t presses;
+    uint32_t bounces;           //debounce periods that ended with the pin high
+} BTN_Stats;
+
+extern BTN_Stats btnStats;
+
+void BTN_init(void (*pressCallback)(uint8_t button));
+
+#endif /* BUTTONS_H_ */
@@ -0,0 +1,264 @@
+/*
+ * ts_codec.c
+ *
+ * Gorilla style time-series compression. Each block starts with a 4 byte header
+ * (version, channel count, 16 bit sample count) followed by the bit stream. The
+ * first sample is stored at full width and every sample after it as:
+ *  1) Timestamp: delta-of-delta against the previous two timestamps
+ *  2) Each channel: delta against the previous value of the same channel
+ * Both are zigzag mapped to unsigned and written with the prefix code below.
+ *
+ *  '0'                     value == 0
+ *  '10'   + 7 bits         value < 128
+ *  '110'  + 9 bits         value < 512
+ *  '1110' + 12 bits        value < 4096
+ *  '1111' + 32 bits        anything else
+ */
+
+#include "ts_codec.h"
+
+/**************************************************************************************
+ * Zigzag Encode/Decode Functions
+ * Maps signed values to unsigned so small negative and positive deltas both end up
+ * as small numbers: 0 -> 0, -1 -> 1, 1 -> 2, -2 -> 3 ...
+ ***************************************************************************************
+*/
+static uint32_t TSC_zigzag(int32_t value){
+    return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+static int32_t TSC_unzigzag(uint32_t value){
+    return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+/**************************************************************************************
+ * Bit Writer Function
+ * Writes the numBits low bits of value MSB first into the block. Bits are copied a
+ * byte at a time instead of one at a time to keep the cost per field low.
+ ***************************************************************************************
+*/
+static void TSC_writeBits(TSC_Encoder *enc, uint32_t value, uint8_t numBits){
+    while(numBits){
+        uint8_t freeBits = 8 - (enc->bitPos & 7);
+        uint8_t take = (numBits < freeBits) ? numBits : freeBits;
+        uint8_t chunk = (value >> (numBits - take)) & ((1U << take) - 1);
+        uint8_t *byte = &enc->buffer[enc->bitPos >> 3];
+
+        if((enc->bitPos & 7) == 0){
+            *byte = 0;
+        }
+        *byte |= chunk << (freeBits - take);
+        enc->bitPos += take;
+        numBits -= take;
+    }
+}
+
+/**************************************************************************************
+ * Bit Reader Function
+ * Reverse of TSC_writeBits, reads numBits MSB first from the block. Reading past the
+ * end of the block returns 0 and sets overrun, the buffer is never read beyond size.
+ ***************************************************************************************
+*/
+static uint32_t TSC_readBits(TSC_Decoder *dec, uint8_t numBits){
+    uint32_t value = 0;
+
+    if(dec->overrun || dec->bitPos + numBits > (uint32_t)dec->size * 8){
+        dec->overrun = 1;
+        return 0;
+    }
+    while(numBits){
+        uint8_t freeBits = 8 - (dec->bitPos & 7);
+        uint8_t take = (numBits < freeBits) ? numBits : freeBits;
+        uint8_t byte = dec->buffer[dec->bitPos >> 3];
+
+        value = (value << take) | ((byte >> (freeBits - take)) & ((1U << take) - 1));
+        dec->bitPos += take;
+        numBits -= take;
+    }
+    return value;
+}
+
+/**************************************************************************************
+ * Write Field Function
+ * Writes a zigzag mapped value using the prefix code described at the top of the file
+ ***************************************************************************************
+*/
+static void TSC_writeField(TSC_Encoder *enc, uint32_t zz){
+    if(zz == 0){
+        TSC_writeBits(enc, 0x0, 1);
+    } else if(zz < (1UL << 7)){
+        TSC_writeBits(enc, 0x2, 2);
+        TSC_writeBits(enc, zz, 7);
+    } else if(zz < (1UL << 9)){
+        TSC_writeBits(enc, 0x6, 3);
+        TSC_writeBits(enc, zz, 9);
+    } else if(zz < (1UL << 12)){
+        TSC_writeBits(enc, 0xE, 4);
+        TSC_writeBits(enc, zz, 12);
+    } else {
+        TSC_writeBits(enc, 0xF, 4);
+        TSC_writeBits(enc, zz, 32);
+    }
+}
+
+/**************************************************************************************
+ * Read Field Function
+ * Counts the leading ones of the prefix (max 4) to know how wide the payload is
+ ***************************************************************************************
+*/
+static uint32_t TSC_readField(TSC_Decoder *dec){
+    static const uint8_t payloadBits[5] = {0, 7, 9, 12, 32};
+    uint8_t ones = 0;
+
+    while(ones < 4 && TSC_readBits(dec, 1)){
+        ones++;
+    }
+    return (ones == 0) ? 0 : TSC_readBits(dec, payloadBits[ones]);
+}
+
+/**************************************************************************************
+ * Encoder Initialize Function
+ * Starts a new block in the given buffer. The header is written straight away so the
+ * block can be decoded at any point, even while it is still being filled.
+ ***************************************************************************************
+*/
+void TSC_encoderInit(TSC_Encoder *enc, uint8_t *buffer, uint16_t size, uint8_t channels){
+    enc->buffer = buffer;
+    enc->size = size;
+    enc->channels = (channels > TSC_MAX_CHANNELS) ? TSC_MAX_CHANNELS : channels;
+    enc->count = 0;
+    enc->prevTime = 0;
+    enc->prevDelta = 0;
+    enc->bitPos = TSC_HEADER_SIZE * 8;
+
+    buffer[0] = TSC_VERSION;
+    buffer[1] = enc->channels;
+    buffer[2] = 0;
+    buffer[3] = 0;
+}
+
+/**************************************************************************************
+ * Encode Sample Function
+ * Appends one sample to the block. Returns 0 without touching the block if the worst
+ * case size of the sample does not fit anymore, the caller should then start a new
+ * block. The sample count in the header is updated after every sample.
+ ***************************************************************************************
+*/
+uint8_t TSC_encodeSample(TSC_Encoder *enc, uint32_t timestamp, const int32_t *values){
+    uint32_t worstCase = (uint32_t)(enc->channels + 1) * TSC_MAX_FIELD_BITS;
+    uint8_t i;
+
+    if(enc->bitPos + worstCase > (uint32_t)enc->size * 8 || enc->count == 0xFFFF){
+        return 0;
+    }
+
+    if(enc->count == 0){
+        TSC_writeBits(enc, timestamp, 32);
+        for(i = 0; i < enc->channels; i++){
+            TSC_writeBits(enc, (uint32_t)values[i], 32);
+        }
+    } else {
+        int32_t delta = (int32_t)(timestamp - enc->prevTime);
+        TSC_writeField(enc, TSC_zigzag((int32_t)((uint32_t)delta - (uint32_t)enc->prevDelta)));
+        enc->prevDelta = delta;
+        for(i = 0; i < enc->channels; i++){
+            TSC_writeField(enc, TSC_zigzag((int32_t)((uint32_t)values[i] - (uint32_t)enc->prevValue[i])));
+        }
+    }
+
+    enc->prevTime = timestamp;
+    for(i = 0; i < enc->channels; i++){
+        enc->prevValue[i] = values[i];
+    }
+    enc->count++;
+    enc->buffer[2] = enc->count & 0xFF;
+    enc->buffer[3] = enc->count >> 8;
+    return 1;
+}
+
+/**************************************************************************************
+ * Encoded Bytes Function
+ * Returns the number of bytes of the block in use, including the header
+ ***************************************************************************************
+*/
+uint16_t TSC_encodedBytes(const TSC_Encoder *enc){
+    return (enc->bitPos + 7) >> 3;
+}
+
+/**************************************************************************************
+ * Decoder Initialize Function
+ * Checks the block header and prepares to read samples from it. Returns 0 if the
+ * buffer does not hold a block this codec understands, or is too short for the
+ * sample count of its header: the first sample takes 32 bits per field and every
+ * other one at least a bit per field.
+ ***************************************************************************************
+*/
+uint8_t TSC_decoderInit(TSC_Decoder *dec, const uint8_t *buffer, uint16_t size){
+    uint16_t count;
+    uint32_t minimumBits;
+
+    if(size < TSC_HEADER_SIZE || buffer[0] != TSC_VERSION ||
+       buffer[1] == 0 || buffer[1] > TSC_MAX_CHANNELS){
+        return 0;
+    }
+    count = buffer[2] | (buffer[3] << 8);
+    minimumBits = (count == 0) ? 0 : (uint32_t)(buffer[1] + 1) * (32U + count - 1U);
+    if(TSC_HEADER_SIZE * 8U + minimumBits > (uint32_t)size * 8){
+        return 0;
+    }
+    dec->buffer = buffer;
+    dec->size = size;
+    dec->channels = buffer[1];
+    dec->count = count;
+    dec->index = 0;
+    dec->overrun = 0;
+    dec->prevTime = 0;
+    dec->prevDelta = 0;
+    dec->bitPos = TSC_HEADER_SIZE * 8;
+    return 1;
+}
+
+/**************************************************************************************
+ * Decode Sample Function
+ * Reads the next sample out of the block. Returns 0 once every sample has been read,
+ * or if the block ends in the middle of a sample (overrun is set then and nothing
+ * more is decoded). values needs room for the number of channels stored in the block
+ * header.
+ ***************************************************************************************
+*/
+uint8_t TSC_decodeSample(TSC_Decoder *dec, uint32_t *timestamp, int32_t *values){
+    uint32_t time;
+    int32_t delta = dec->prevDelta;
+    int32_t value[TSC_MAX_CHANNELS];
+    uint8_t i;
+
+    if(dec->index >= dec->count || dec->overrun){
+        return 0;
+    }
+
+    if(dec->index == 0){
+        time = TSC_readBits(dec, 32);
+        for(i = 0; i < dec->channels; i++){
+            value[i] = (int32_t)TSC_readBits(dec, 32);
+        }
+    } else {
+        delta = (int32_t)((uint32_t)delta + (uint32_t)TSC_unzigzag(TSC_readField(dec)));
+        time = dec->prevTime + (uint32_t)delta;
+        for(i = 0; i < dec->channels; i++){
+            value[i] = (int32_t)((uint32_t)dec->prevValue[i] + (uint32_t)TSC_unzigzag(TSC_readField(dec)));
+        }
+    }
+    if(dec->overrun){
+        return 0;
+    }
+
+    dec->prevTime = time;
+    dec->prevDelta = delta;
+    *timestamp = time;
+    for(i = 0; i < dec->channels; i++){
+        dec->prevValue[i] = value[i];
+        values[i] = value[i];
+    }
+    dec->index++;
+    return 1;
+}
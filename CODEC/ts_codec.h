@@ -0,0 +1,55 @@
+/*
+ * ts_codec.h
+ *
+ * Streaming time-series codec for sensor samples. Timestamps are stored as
+ * delta-of-delta and every channel as a zigzag-encoded delta against the
+ * previous sample, both written with a short prefix code into a bit-packed
+ * block. Slowly changing values like temperature and humidity usually cost
+ * only one bit per field.
+ */
+
+#ifndef TS_CODEC_H_
+#define TS_CODEC_H_
+
+#include <stdint.h>
+
+#define TSC_VERSION             0x01
+#define TSC_HEADER_SIZE         4
+#define TSC_MAX_CHANNELS        4
+
+//Worst case bits for a single field: 4 bit prefix + 32 bit payload
+#define TSC_MAX_FIELD_BITS      36
+
+typedef struct
+{
+    uint8_t  *buffer;
+    uint16_t size;
+    uint32_t bitPos;
+    uint8_t  channels;
+    uint16_t count;
+    uint32_t prevTime;
+    int32_t  prevDelta;
+    int32_t  prevValue[TSC_MAX_CHANNELS];
+} TSC_Encoder;
+
+typedef struct
+{
+    const uint8_t *buffer;
+    uint16_t size;
+    uint32_t bitPos;
+    uint8_t  channels;
+    uint16_t count;
+    uint16_t index;
+    uint8_t  overrun;           //a read went past size, the block is cut short or corrupt
+    uint32_t prevTime;
+    int32_t  prevDelta;
+    int32_t  prevValue[TSC_MAX_CHANNELS];
+} TSC_Decoder;
+
+void        TSC_encoderInit(TSC_Encoder *enc, uint8_t *buffer, uint16_t size, uint8_t channels);
+uint8_t     TSC_encodeSample(TSC_Encoder *enc, uint32_t timestamp, const int32_t *values);
+uint16_t    TSC_encodedBytes(const TSC_Encoder *enc);
+uint8_t     TSC_decoderInit(TSC_Decoder *dec, const uint8_t *buffer, uint16_t size);
+uint8_t     TSC_decodeSample(TSC_Decoder *dec, uint32_t *timestamp, int32_t *values);
+
+#endif /* TS_CODEC_H_ */
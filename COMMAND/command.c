@@ -0,0 +1,547 @@
+/*
+ * command.c
+ *
+ * Line based command parser for UART0. A line is split on spaces into the command
+ * name and up to CMD_MAX_ARGS-1 arguments, then looked up in cmdTable.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "command.h"
+#include "UART\uart.h"
+#include "BME280\BME280_I2C.h"
+#include "LOG\sample_log.h"
+#include "TELEMETRY\telemetry.h"
+#include "HM10\hm10.h"
+#include "OUTPUT\output.h"
+#include "TIMER\timer_wheel.h"
+#include "SCHED\scheduler.h"
+#include "APP\active_objects.h"
+#include "READING\reading.h"
+#include "ACQ\acquisition.h"
+#include "I2C\i2c.h"
+#include "OLED\SSD1306_I2C_TivaC.h"
+#include "ZONES\zones.h"
+#include "UI\ui.h"
+#include "BUTTON\buttons.h"
+
+RuntimeConfig runtimeConfig = {3500, 0, CMD_ACQ_INTERRUPT, CMD_GRAPH_TEMPERATURE, 30, 120, 50};
+
+static char     cmdLine[CMD_LINE_SIZE];
+static uint8_t  cmdLength;
+static uint8_t  cmdOverflow;
+
+static void CMD_help(uint8_t argc, char *argv[]);
+static void CMD_period(uint8_t argc, char *argv[]);
+static void CMD_osr(uint8_t argc, char *argv[]);
+static void CMD_acq(uint8_t argc, char *argv[]);
+static void CMD_format(uint8_t argc, char *argv[]);
+static void CMD_page(uint8_t argc, char *argv[]);
+static void CMD_graph(uint8_t argc, char *argv[]);
+static void CMD_scroll(uint8_t argc, char *argv[]);
+static void CMD_power(uint8_t argc, char *argv[]);
+static void CMD_read(uint8_t argc, char *argv[]);
+static void CMD_stats(uint8_t argc, char *argv[]);
+static void CMD_dump(uint8_t argc, char *argv[]);
+static void CMD_zones(uint8_t argc, char *argv[]);
+
+static const CMD_Entry cmdTable[] =
+{
+    {"help",    "help",                     CMD_help},
+    {"period",  "period <ms>",              CMD_period},
+    {"osr",     "osr <low|std|high>",       CMD_osr},
+    {"acq",     "acq <serial|pipelined|irq>", CMD_acq},
+    {"format",  "format <ascii|binary>",    CMD_format},
+    {"page",    "page <n>",                 CMD_page},
+    {"graph",   "graph <temp|hum>",         CMD_graph},
+    {"scroll",  "scroll <left|right|off>",  CMD_scroll},
+    {"power",   "power [dim s] [off s] [delta]", CMD_power},
+    {"read",    "read",                     CMD_read},
+    {"stats",   "stats",                    CMD_stats},
+    {"dump",    "dump",                     CMD_dump},
+    {"zones",   "zones [period ms]",        CMD_zones}
+};
+
+#define CMD_TABLE_SIZE (sizeof(cmdTable) / sizeof(cmdTable[0]))
+
+/**************************************************************************************
+ * Command Reply Function
+ * Sends a reply to the PC. In binary telemetry mode the text is wrapped in a text
+ * frame so it does not break the framing of the binary stream.
+ ***************************************************************************************
+*/
+void CMD_reply(const char *text){
+    if(telemetryMode == TELEM_MODE_BINARY){
+        TELEM_sendText(UART0, BSP_MILLIS(), text);
+    } else {
+        printStringToUart((char *)text, UART0);
+    }
+}
+
+/**************************************************************************************
+ * Command Execute Function
+ * Splits the received line into arguments and calls the handler of the command
+ ***************************************************************************************
+*/
+static void CMD_execute(char *line){
+    char *argv[CMD_MAX_ARGS];
+    uint8_t argc = 0;
+    uint8_t i;
+
+    while(*line && argc < CMD_MAX_ARGS){
+        while(*line == ' '){
+            *(line++) = '\0';
+        }
+        if(*line){
+            argv[argc++] = line;
+        }
+        while(*line && *line != ' '){
+            line++;
+        }
+    }
+    if(argc == 0){
+        return;
+    }
+
+    for(i = 0; i < CMD_TABLE_SIZE; i++){
+        if(strcmp(argv[0], cmdTable[i].name) == 0){
+            cmdTable[i].handler(argc, argv);
+            return;
+        }
+    }
+    CMD_reply("Unknown command, type help\n");
+}
+
+void CMD_init(void){
+    cmdLength = 0;
+    cmdOverflow = 0;
+}
+
+/**************************************************************************************
+ * Command Poll Function
+ * Called from the main loop. Takes every received byte out of the UART0 RX ring and
+ * runs the command once a full line (\r or \n) has arrived.
+ ***************************************************************************************
+*/
+void CMD_poll(void){
+    char c;
+
+    while(readCharFromUart(&c, UART0)){
+        if(c == '\r' || c == '\n'){
+            if(cmdOverflow){
+                CMD_reply("Line too long\n");
+            } else {
+                cmdLine[cmdLength] = '\0';
+                CMD_execute(cmdLine);
+            }
+            cmdLength = 0;
+            cmdOverflow = 0;
+        } else if(c == '\b' || c == 0x7F){
+            if(cmdLength > 0){
+                cmdLength--;
+            }
+        } else if(cmdLength < CMD_LINE_SIZE - 1){
+            cmdLine[cmdLength++] = c;
+        } else {
+            cmdOverflow = 1;
+        }
+    }
+}
+
+/**************************************************************************************
+ * Command Handlers
+ ***************************************************************************************
+*/
+static void CMD_help(uint8_t argc, char *argv[]){
+    uint8_t i;
+    for(i = 0; i < CMD_TABLE_SIZE; i++){
+        CMD_reply(cmdTable[i].usage);
+        CMD_reply("\n");
+    }
+}
+
+static void CMD_period(uint8_t argc, char *argv[]){
+    char line[40];
+    uint32_t period;
+
+    if(argc < 2){
+        snprintf(line, sizeof(line), "period %lu ms\n", (unsigned long)runtimeConfig.samplePeriodMs);
+        CMD_reply(line);
+        return;
+    }
+    period = strtoul(argv[1], 0, 10);
+    if(period < CMD_MIN_PERIOD_MS || period > CMD_MAX_PERIOD_MS){
+        CMD_reply("Period out of range\n");
+        return;
+    }
+    runtimeConfig.samplePeriodMs = period;
+    CMD_reply("OK\n");
+}
+
+static void CMD_osr(uint8_t argc, char *argv[]){
+    static const char *profileNames[BME280_NUM_PROFILES] = {"low", "std", "high"};
+    uint8_t i;
+
+    if(argc < 2){
+        CMD_reply("osr ");
+        CMD_reply(profileNames[bme280Profile]);
+        CMD_reply("\n");
+        return;
+    }
+    for(i = 0; i < BME280_NUM_PROFILES; i++){
+        if(strcmp(argv[1], profileNames[i]) == 0){
+            CMD_reply((BME280_setOversampling(i) == I2C_STATUS_DONE) ? "OK\n" : "Bus error\n");
+            return;
+        }
+    }
+    CMD_reply("Unknown profile\n");
+}
+
+static void CMD_acq(uint8_t argc, char *argv[]){
+    static const char *modeNames[] = {"serial", "pipelined", "irq"};
+    uint8_t i;
+
+    if(argc < 2){
+        CMD_reply("acq ");
+        CMD_reply(modeNames[runtimeConfig.acquisitionMode]);
+        CMD_reply("\n");
+        return;
+    }
+    for(i = 0; i < sizeof(modeNames) / sizeof(modeNames[0]); i++){
+        if(strcmp(argv[1], modeNames[i]) == 0){
+            runtimeConfig.acquisitionMode = i;
+            CMD_reply("OK\n");
+            return;
+        }
+    }
+    CMD_reply("Unknown mode\n");
+}
+
+static void CMD_format(uint8_t argc, char *argv[]){
+    if(argc < 2){
+        CMD_reply((telemetryMode == TELEM_MODE_BINARY) ? "format binary\n" : "format ascii\n");
+    } else if(strcmp(argv[1], "ascii") == 0){
+        TELEM_setMode(TELEM_MODE_ASCII);
+        CMD_reply("OK\n");
+    } else if(strcmp(argv[1], "binary") == 0){
+        TELEM_setMode(TELEM_MODE_BINARY);
+        CMD_reply("OK\n");
+    } else {
+        CMD_reply("Unknown format\n");
+    }
+}
+
+static void CMD_page(uint8_t argc, char *argv[]){
+    char line[24];
+    uint32_t page;
+
+    if(argc < 2){
+        snprintf(line, sizeof(line), "page %u\n", runtimeConfig.displayPage);
+        CMD_reply(line);
+        return;
+    }
+    page = strtoul(argv[1], 0, 10);
+    if(page >= UI_NUM_PAGES){
+        CMD_reply("No such page\n");
+        return;
+    }
+    UI_wake(UI_WAKE_COMMAND);
+    UI_show(page);
+    CMD_reply("OK\n");
+}
+
+static void CMD_graph(uint8_t argc, char *argv[]){
+    if(argc < 2){
+        CMD_reply((runtimeConfig.graphSource == CMD_GRAPH_HUMIDITY) ? "graph hum\n" : "graph temp\n");
+    } else if(strcmp(argv[1], "temp") == 0){
+        runtimeConfig.graphSource = CMD_GRAPH_TEMPERATURE;
+        CMD_reply("OK\n");
+    } else if(strcmp(argv[1], "hum") == 0){
+        runtimeConfig.graphSource = CMD_GRAPH_HUMIDITY;
+        CMD_reply("OK\n");
+    } else {
+        CMD_reply("Unknown value\n");
+    }
+}
+
+/*
+ * Scrolls the graph pages with the scroll engine of the display. Nothing is drawn
+ * while it scrolls, the page that is up is redrawn when it stops.
+ */
+static void CMD_scroll(uint8_t argc, char *argv[]){
+    uint8_t lastPage = UI_GRAPH_FIRST_PAGE + UI_GRAPH_PAGES - 1;
+    uint8_t status;
+
+    if(argc < 2){
+        CMD_reply(ssdScrolling ? "scroll on\n" : "scroll off\n");
+        return;
+    }
+    if(strcmp(argv[1], "left") == 0){
+        status = SSD_scrollHorizontal(SSD_SCROLL_LEFT, UI_GRAPH_FIRST_PAGE, lastPage, SSD_SCROLL_5_FRAMES);
+    } else if(strcmp(argv[1], "right") == 0){
+        status = SSD_scrollHorizontal(SSD_SCROLL_RIGHT, UI_GRAPH_FIRST_PAGE, lastPage, SSD_SCROLL_5_FRAMES);
+    } else if(strcmp(argv[1], "off") == 0){
+        status = SSD_scrollStop();
+        UI_show(runtimeConfig.displayPage);
+    } else {
+        CMD_reply("Unknown direction\n");
+        return;
+    }
+    CMD_reply((status == I2C_STATUS_DONE) ? "OK\n" : "Bus error\n");
+}
+
+/*
+ * Shows or sets the display power settings: seconds to dimming and to off without
+ * activity, and the change in 0.01 C or %rH that wakes it, 0 turns each off. Setting
+ * them wakes the display and counts from then.
+ */
+static void CMD_power(uint8_t argc, char *argv[]){
+    static const char *const states[] = {"on", "dim", "off"};
+    char line[80];
+    uint32_t value[3];
+    uint8_t i;
+
+    if(argc < 2){
+        snprintf(line, sizeof(line), "power %s, dim %u s, off %u s, delta %u\n", states[uiPower.state],
+                 runtimeConfig.dimSeconds, runtimeConfig.offSeconds, runtimeConfig.wakeDelta);
+        CMD_reply(line);
+        return;
+    }
+    for(i = 0; i < 3 && i + 1 < argc; i++){
+        value[i] = strtoul(argv[i + 1], 0, 10);
+        if(value[i] > 0xFFFFU){
+            CMD_reply("Value out of range\n");
+            return;
+        }
+    }
+    runtimeConfig.dimSeconds = value[0];
+    if(argc >= 3){
+        runtimeConfig.offSeconds = value[1];
+    }
+    if(argc >= 4){
+        runtimeConfig.wakeDelta = value[2];
+    }
+    if(UI_wake(UI_WAKE_COMMAND)){
+        UI_show(runtimeConfig.displayPage);
+    }
+    CMD_reply("OK\n");
+}
+
+static void CMD_read(uint8_t argc, char *argv[]){
+    char line[96];
+    READING_Data reading;
+    uint32_t magnitude;
+    uint32_t ageMs;
+
+    if(!READING_get(&reading)){
+        CMD_reply("No reading yet\n");
+        return;
+    }
+    magnitude = (reading.temperature < 0) ? -(uint32_t)reading.temperature : (uint32_t)reading.temperature;
+    ageMs = (uint32_t)((BSP_timestampUs() - reading.readUs) / 1000);
+    snprintf(line, sizeof(line), "#%lu: %s%lu.%02lu C, %u.%02u %%rH (%lu ms ago)\n",
+             (unsigned long)reading.count, (reading.temperature < 0) ? "-" : "",
+             (unsigned long)(magnitude / 100), (unsigned long)(magnitude % 100),
+             reading.humidity / 100, reading.humidity % 100, (unsigned long)ageMs);
+    CMD_reply(line);
+}
+
+static void CMD_stats(uint8_t argc, char *argv[]){
+    char line[112];
+    static I2C0_Type *const i2cBuses[I2C_NUM_BUSES] = {I2C0, I2C1, I2C2, I2C3};
+    const UART_Stats *uart0 = getUartStats(UART0);
+    const I2C_Stats *i2c;
+    OUT_Sink *sink;
+    ActiveObject *ao;
+    uint8_t i;
+
+    snprintf(line, sizeof(line), "Uptime: %lu s, samples: %lu, timers fired: %lu (max late %lu ticks)\n",
+             (unsigned long)(BSP_uptimeTicks() / SYS_TICKS_PER_SEC), (unsigned long)logStats.samples,
+             (unsigned long)twStats.fired, (unsigned long)twStats.maxLateTicks);
+    CMD_reply(line);
+    snprintf(line, sizeof(line), "Acquisition: conversion %lu us, read %lu us (max %lu), publish %lu us (max %lu), deferred %lu\n",
+             (unsigned long)acqStats.conversionUs, (unsigned long)acqStats.readUs, (unsigned long)acqStats.maxReadUs,
+             (unsigned long)acqStats.publishUs, (unsigned long)acqStats.maxPublishUs, (unsigned long)acqStats.deferred);
+    CMD_reply(line);
+    snprintf(line, sizeof(line), "  fan-out %lu us (max %lu), max rate serial %lu mHz, pipelined %lu mHz\n",
+             (unsigned long)outStats.fanOutUs, (unsigned long)outStats.maxFanOutUs,
+             (unsigned long)APP_maxRateMilliHz(CMD_ACQ_SERIAL), (unsigned long)APP_maxRateMilliHz(CMD_ACQ_PIPELINED));
+    CMD_reply(line);
+    snprintf(line, sizeof(line), "  jitter %lu us (max %lu), sample to output %lu us (max %lu), bus errors %lu\n",
+             (unsigned long)acqStats.jitterUs, (unsigned long)acqStats.maxJitterUs,
+             (unsigned long)outStats.latencyUs, (unsigned long)outStats.maxLatencyUs, (unsigned long)acqStats.busErrors);
+    CMD_reply(line);
+    snprintf(line, sizeof(line), "  irq: %lu ticks, %lu samples, %lu overruns, %lu bus errors, %lu dropped\n",
+             (unsigned long)acqIrqStats.ticks, (unsigned long)acqIrqStats.samples, (unsigned long)acqIrqStats.overruns,
+             (unsigned long)acqIrqStats.busErrors, (unsigned long)acqIrqStats.dropped);
+    CMD_reply(line);
+    snprintf(line, sizeof(line), "  irq: jitter %lu us (max %lu), tick to sample %lu us (max %lu)\n",
+             (unsigned long)acqIrqStats.jitterUs, (unsigned long)acqIrqStats.maxJitterUs,
+             (unsigned long)acqIrqStats.sequenceUs, (unsigned long)acqIrqStats.maxSequenceUs);
+    CMD_reply(line);
+    for(i = 0; i < I2C_NUM_BUSES; i++){
+        if(!I2C_enabled(i2cBuses[i])){
+            continue;
+        }
+        i2c = I2C_getStats(i2cBuses[i]);
+        snprintf(line, sizeof(line), "I2C%u: %lu transactions, %lu errors, max %lu queued, %lu mux selects\n", i,
+                 (unsigned long)i2c->transactions, (unsigned long)i2c->errors, (unsigned long)i2c->maxQueued,
+                 (unsigned long)i2c->muxSelects);
+        CMD_reply(line);
+        snprintf(line, sizeof(line), "  errors: %lu addr nack, %lu data nack, %lu arb lost, %lu timeouts, %lu recoveries\n",
+                 (unsigned long)i2c->addrNacks, (unsigned long)i2c->dataNacks, (unsigned long)i2c->arbLost,
+                 (unsigned long)i2c->timeouts, (unsigned long)i2c->recoveries);
+        CMD_reply(line);
+    }
+    snprintf(line, sizeof(line), "  speed: BME280 %lu kHz (%s), OLED %lu kHz\n",
+             (unsigned long)((bme280Transport->queued ? I2C_speedHz(I2C_getSpeed(bme280Bus, bme280Address))
+                                                      : SSI_clockHz(bme280Ssi)) / 1000U),
+             bme280Transport->name,
+             (unsigned long)((ssdTransport == &ssdI2CTransport ? I2C_speedHz(I2C_getSpeed(ssdBus, ssdAddress))
+                                                               : SSI_clockHz(ssdSsi)) / 1000U));
+    CMD_reply(line);
+    snprintf(line, sizeof(line), "  OLED flush: I2C %lu us, SPI %lu us%s, on %s\n",
+             (unsigned long)ssdI2CTransport.flushUs, (unsigned long)ssdSsiTransport.flushUs,
+             ssdDma ? " (uDMA)" : "", ssdTransport->name);
+    CMD_reply(line);
+    snprintf(line, sizeof(line), "  OLED graph: %lu updates, %lu redrawn, last %u bytes, redraw %u bytes\n",
+             (unsigned long)uiGraph.updates, (unsigned long)uiGraph.rescales,
+             uiGraph.lastBytes, uiGraph.fullBytes);
+    CMD_reply(line);
+    snprintf(line, sizeof(line), "  UI: page %u, %lu switches (last %lu us), %lu presses, %lu bounces, CPU %u%%\n",
+             runtimeConfig.displayPage, (unsigned long)uiStats.switches, (unsigned long)uiStats.switchUs,
+             (unsigned long)btnStats.presses, (unsigned long)btnStats.bounces, uiStats.cpuLoad);
+    CMD_reply(line);
+    snprintf(line, sizeof(line), "  OLED power: %s, %lu dims, %lu sleeps, woken %lu by button, %lu by change, %lu by command\n",
+             (uiPower.state == UI_POWER_OFF) ? "off" : (uiPower.state == UI_POWER_DIM) ? "dim" : "on",
+             (unsigned long)uiPower.dims, (unsigned long)uiPower.sleeps, (unsigned long)uiPower.wakes[UI_WAKE_BUTTON],
+             (unsigned long)uiPower.wakes[UI_WAKE_CHANGE], (unsigned long)uiPower.wakes[UI_WAKE_COMMAND]);
+    CMD_reply(line);
+    snprintf(line, sizeof(line), "  sample bus time: I2C %lu us (max %lu), SPI %lu us (max %lu)\n",
+             (unsigned long)bme280I2CTransport.sampleUs, (unsigned long)bme280I2CTransport.maxSampleUs,
+             (unsigned long)bme280SsiTransport.sampleUs, (unsigned long)bme280SsiTransport.maxSampleUs);
+    CMD_reply(line);
+    snprintf(line, sizeof(line), "  sensor read: wait %lu us (max %lu), worst case %lu us\n",
+             (unsigned long)I2C_getStats(bme280Bus)->waitUs, (unsigned long)I2C_getStats(bme280Bus)->maxWaitUs,
+             (unsigned long)I2C_latencyBoundUs(bme280Bus, bme280Address, 1, BME280_BURST_LENGTH));
+    CMD_reply(line);
+    LOG_formatStats(line, sizeof(line));
+    CMD_reply(line);
+    snprintf(line, sizeof(line), "Telemetry: %lu frames, %lu bytes\n",
+             (unsigned long)telemStats.frames, (unsigned long)telemStats.bytes);
+    CMD_reply(line);
+    snprintf(line, sizeof(line), "UART0: tx %lu (waits %lu), rx %lu (dropped %lu, errors %lu)\n",
+             (unsigned long)uart0->txBytes, (unsigned long)uart0->txWaits, (unsigned long)uart0->rxBytes,
+             (unsigned long)uart0->rxDropped, (unsigned long)uart0->rxErrors);
+    CMD_reply(line);
+    snprintf(line, sizeof(line), "UART3: %lu baud, %lu us per reading\n",
+             (unsigned long)getUartBaud(UART3), (unsigned long)HM10_transmitTimeUs(HM10_READING_BYTES));
+    CMD_reply(line);
+    snprintf(line, sizeof(line), "Output: %lu published, %lu lost (pool empty)\n",
+             (unsigned long)outStats.published, (unsigned long)outStats.poolEmpty);
+    CMD_reply(line);
+    for(i = 0; i < OUT_numSinks(); i++){
+        sink = OUT_getSink(i);
+        snprintf(line, sizeof(line), "  %s: backlog %u (max %u), delivered %lu, dropped %lu\n",
+                 sink->name, sink->backlog, sink->maxBacklog, (unsigned long)sink->delivered, (unsigned long)sink->dropped);
+        CMD_reply(line);
+    }
+    snprintf(line, sizeof(line), "Scheduler: %lu idle entries\n", (unsigned long)schedStats.idleEntries);
+    CMD_reply(line);
+    for(i = 0; i < SCHED_numObjects(); i++){
+        ao = SCHED_getObject(i);
+        snprintf(line, sizeof(line), "  %s: queue %lu/%lu (max %lu), events %lu, lost %lu, max %lu cycles\n",
+                 ao->name, (unsigned long)(ao->head - ao->tail), (unsigned long)(ao->mask + 1),
+                 (unsigned long)ao->highWater, (unsigned long)ao->dispatched,
+                 (unsigned long)ao->overflows, (unsigned long)ao->maxCycles);
+        CMD_reply(line);
+    }
+}
+
+/*
+ * The dump is sent by the uDMA, see UART_dmaBegin. Afterwards the throughput and
+ * the share of the dump the CPU was awake for are reported.
+ */
+static void CMD_dump(uint8_t argc, char *argv[]){
+    char line[80];
+    UART_DmaStats dma = {0};
+    const uint8_t *block;
+    uint16_t length;
+    uint8_t streaming;
+    uint8_t i;
+
+    //Without the uDMA the dump still goes out through the TX ring, only unmeasured
+    streaming = UART_dmaBegin(UART0);
+    if(telemetryMode == TELEM_MODE_BINARY){
+        for(i = 0; i < LOG_numBlocks(); i++){
+            block = LOG_getBlock(i, &length);
+            TELEM_sendLogBlock(UART0, BSP_MILLIS(), block, length);
+        }
+    } else {
+        LOG_dump(UART0);
+    }
+    if(!streaming){
+        CMD_reply("Dump: uDMA busy, sent without it\n");
+        return;
+    }
+    UART_dmaEnd(UART0, &dma);
+
+    if(dma.us != 0){
+        snprintf(line, sizeof(line), "Dump: %lu bytes in %lu ms, %lu bytes/s, CPU %lu%%\n",
+                 (unsigned long)dma.bytes, (unsigned long)(dma.us / 1000U),
+                 (unsigned long)((uint64_t)dma.bytes * 1000000U / dma.us),
+                 (unsigned long)(((uint64_t)(dma.us - dma.sleepUs) * 100U) / dma.us));
+        CMD_reply(line);
+    }
+}
+
+/*
+ * Lists the zone sensors with their last sample and counters, and how many sensors
+ * the bus could sample at the zone rate. With a period the sampling is restarted at
+ * that period, if the sensors fit in it.
+ */
+static void CMD_zones(uint8_t argc, char *argv[]){
+    char line[96];
+    const ZONE_Sensor *zone;
+    uint32_t periodMs = ZONE_periodMs();
+    uint32_t previousMs = periodMs;
+    uint32_t magnitude;
+    uint8_t i;
+
+    if(argc >= 2){
+        periodMs = strtoul(argv[1], 0, 10);
+        if(ZONE_count() == 0){
+            CMD_reply("No zones\n");
+            return;
+        }
+        ZONE_stop();
+        if(!ZONE_start(periodMs)){
+            CMD_reply("Period too short for the zones\n");
+            ZONE_start(previousMs);
+            return;
+        }
+        CMD_reply("OK\n");
+        return;
+    }
+
+    snprintf(line, sizeof(line), "Zones: %u, period %lu ms, %lu slots, %lu overruns\n", ZONE_count(),
+             (unsigned long)periodMs, (unsigned long)zoneStats.slots, (unsigned long)zoneStats.overruns);
+    CMD_reply(line);
+    for(i = 0; i < ZONE_count(); i++){
+        zone = ZONE_get(i);
+        magnitude = (zone->temperature < 0) ? -(uint32_t)zone->temperature : (uint32_t)zone->temperature;
+        snprintf(line, sizeof(line), "  %u: mux %u 0x%02X, %s%lu.%02lu C, %u.%02u %%rH, %lu samples, %lu errors\n",
+                 i, I2C_DEVICE_CHANNEL(zone->device), I2C_DEVICE_ADDRESS(zone->device),
+                 (zone->temperature < 0) ? "-" : "", (unsigned long)(magnitude / 100), (unsigned long)(magnitude % 100),
+                 zone->humidity / 100, zone->humidity % 100, (unsigned long)zone->samples, (unsigned long)zone->errors);
+        CMD_reply(line);
+    }
+    if(periodMs != 0){
+        snprintf(line, sizeof(line), "  max at %lu mHz: %lu at 100 kHz, %lu at 400 kHz, %u per mux\n",
+                 (unsigned long)(1000000U / periodMs),
+                 (unsigned long)ZONE_maxSensors(1000000U / periodMs, I2C_SPEED_STANDARD),
+                 (unsigned long)ZONE_maxSensors(1000000U / periodMs, I2C_SPEED_FAST), ZONE_MAX_SENSORS);
+        CMD_reply(line);
+    }
+}
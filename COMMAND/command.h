@@ -0,0 +1,57 @@
+/*
+ * command.h
+ *
+ * Text command interface on UART0. Bytes are received by the UART interrupt,
+ * CMD_poll is called from the main loop to assemble them into lines and run the
+ * matching entry of the command table, so no command ever runs in ISR context.
+ */
+
+#ifndef COMMAND_H_
+#define COMMAND_H_
+
+#include <stdint.h>
+#include "BSP\bsp.h"
+
+#define CMD_LINE_SIZE           48
+#define CMD_MAX_ARGS            4
+
+#define CMD_MIN_PERIOD_MS       100
+#define CMD_MAX_PERIOD_MS       3600000UL
+
+//Acquisition modes, see APP\active_objects.h
+#define CMD_ACQ_SERIAL          0
+#define CMD_ACQ_PIPELINED       1
+#define CMD_ACQ_INTERRUPT       2
+
+//What the OLED graph shows
+#define CMD_GRAPH_TEMPERATURE   0
+#define CMD_GRAPH_HUMIDITY      1
+
+//Settings that can be changed at runtime through the command interface
+typedef struct
+{
+    uint32_t samplePeriodMs;
+    uint8_t  displayPage;
+    uint8_t  acquisitionMode;
+    uint8_t  graphSource;
+    uint16_t dimSeconds;        //display dims after this long without activity, 0 never
+    uint16_t offSeconds;        //and turns off after this long, 0 never
+    uint16_t wakeDelta;         //0.01 C or %rH a reading has to move to wake it, 0 never
+} RuntimeConfig;
+
+typedef void (*CMD_Handler)(uint8_t argc, char *argv[]);
+
+typedef struct
+{
+    const char  *name;
+    const char  *usage;
+    CMD_Handler handler;
+} CMD_Entry;
+
+extern RuntimeConfig runtimeConfig;
+
+void    CMD_init(void);
+void    CMD_poll(void);
+void    CMD_reply(const char *text);
+
+#endif /* COMMAND_H_ */
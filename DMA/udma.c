@@ -0,0 +1,81 @@
+/*
+ * udma.c
+ *
+ * Micro DMA controller set-up, see udma.h
+ */
+
+#include "udma.h"
+
+UDMA_Stats udmaStats;
+
+//32 primary descriptors followed by 32 alternate ones, the table has to be 1 KB aligned
+static UDMA_Descriptor udmaTable[64] __attribute__((aligned(1024)));
+
+/**************************************************************************************
+ * uDMA Initialize Function
+ * Enables the controller and points it at the control table. Safe to call more than
+ * once, every driver using a channel calls it.
+ ***************************************************************************************
+*/
+void UDMA_init(void){
+    if(SYSCTL->RCGCDMA & (1U<<0)){
+        return;
+    }
+    SYSCTL->RCGCDMA |= (1U<<0);
+    while((SYSCTL->PRDMA & (1U<<0)) == 0);
+    UDMA->CFG = 1U;
+    UDMA->CTLBASE = (uint32_t)(uintptr_t)udmaTable;
+    NVIC_EnableIRQ(UDMAERR_IRQn);
+}
+
+/**************************************************************************************
+ * uDMA Assign Function
+ * Selects which peripheral drives a channel (4 bit encoding per channel in CHMAPn)
+ * and puts the channel in a known state: primary descriptor, no bursts only, not
+ * masked, default priority
+ ***************************************************************************************
+*/
+void UDMA_assign(uint8_t channel, uint8_t encoding){
+    volatile uint32_t *map = &UDMA->CHMAP0 + (channel / 8);
+    uint32_t shift = (channel % 8) * 4;
+
+    *map = (*map & ~(0xFU << shift)) | ((uint32_t)encoding << shift);
+    UDMA->ENACLR = (1U << channel);
+    UDMA->ALTCLR = (1U << channel);
+    UDMA->USEBURSTCLR = (1U << channel);
+    UDMA->REQMASKCLR = (1U << channel);
+    UDMA->PRIOCLR = (1U << channel);
+    udmaTable[channel].control = UDMA_MODE_STOP;
+    udmaTable[32 + channel].control = UDMA_MODE_STOP;
+}
+
+UDMA_Descriptor *UDMA_primary(uint8_t channel){
+    return &udmaTable[channel];
+}
+
+UDMA_Descriptor *UDMA_alternate(uint8_t channel){
+    return &udmaTable[32 + channel];
+}
+
+uint8_t UDMA_enabled(uint8_t channel){
+    return (UDMA->ENASET & (1U << channel)) != 0;
+}
+
+/**************************************************************************************
+ * uDMA Enable Function
+ * Starts a channel on its primary or alternate descriptor
+ ***************************************************************************************
+*/
+void UDMA_enable(uint8_t channel, uint8_t alternate){
+    if(alternate){
+        UDMA->ALTSET = (1U << channel);
+    } else {
+        UDMA->ALTCLR = (1U << channel);
+    }
+    UDMA->ENASET = (1U << channel);
+}
+
+void uDMAError_IRQHandler(void){
+    UDMA->ERRCLR = 1U;
+    udmaStats.errors++;
+}
@@ -0,0 +1,59 @@
+/*
+ * udma.h
+ *
+ * Micro DMA controller: the channel control table and helpers to set up channel
+ * descriptors. Peripheral drivers own their channels, this module only keeps the
+ * table and the channel assignments.
+ */
+
+#ifndef UDMA_H_
+#define UDMA_H_
+
+#include <stdint.h>
+#include "BSP\bsp.h"
+
+//Channels and encodings used (TM4C123GH6PM datasheet table 9-1)
+#define UDMA_CH_UART0_TX        9
+#define UDMA_ENC_UART0_TX       0
+#define UDMA_CH_UART3_TX        17
+#define UDMA_ENC_UART3_TX       2
+#define UDMA_CH_SSI2_TX         13
+#define UDMA_ENC_SSI2_TX        2
+
+//Fields of the channel control word
+#define UDMA_DSTINC_NONE        (3U<<30)
+#define UDMA_DSTSIZE_8          (0U<<28)
+#define UDMA_SRCINC_8           (0U<<26)
+#define UDMA_SRCSIZE_8          (0U<<24)
+#define UDMA_ARBSIZE_4          (2U<<14)
+#define UDMA_XFERSIZE(n)        ((((uint32_t)(n) - 1U) & 0x3FFU) << 4)
+#define UDMA_MODE_MASK          (7U<<0)
+#define UDMA_MODE_STOP          (0U<<0)
+#define UDMA_MODE_BASIC         (1U<<0)
+#define UDMA_MODE_PINGPONG      (3U<<0)
+
+#define UDMA_MAX_TRANSFER       1024
+
+typedef struct
+{
+    volatile const void *srcEnd;    //last source byte
+    volatile void       *dstEnd;    //last destination byte
+    volatile uint32_t   control;
+    uint32_t            unused;
+} UDMA_Descriptor;
+
+typedef struct
+{
+    uint32_t errors;                //bus errors seen by uDMAError_IRQHandler
+} UDMA_Stats;
+
+extern UDMA_Stats udmaStats;
+
+void             UDMA_init(void);
+void             UDMA_assign(uint8_t channel, uint8_t encoding);
+UDMA_Descriptor *UDMA_primary(uint8_t channel);
+UDMA_Descriptor *UDMA_alternate(uint8_t channel);
+uint8_t          UDMA_enabled(uint8_t channel);
+void             UDMA_enable(uint8_t channel, uint8_t alternate);
+
+#endif /* UDMA_H_ */
@@ -0,0 +1,141 @@
+/*
+ * hm10.c
+ *
+ * HM-10 baud rate negotiation. The module answers "AT" with "OK" when no phone is
+ * connected. AT+BAUD<n> sets the rate (0=9600, 1=19200, 2=38400, 3=57600,
+ * 4=115200) which is used after AT+RESET.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "hm10.h"
+#include "UART\uart.h"
+
+static const uint32_t hm10Rates[] = {9600, 19200, 38400, 57600, 115200};
+
+#define HM10_NUM_RATES (sizeof(hm10Rates) / sizeof(hm10Rates[0]))
+
+static uint8_t hm10Answered;
+
+/**************************************************************************************
+ * HM-10 Command Function
+ * Sends an AT command and collects the reply until it contains the expected text or
+ * timeoutMs runs out. Anything left in the RX ring before the command is dropped.
+ * Returns 1 if the expected reply was received.
+ ***************************************************************************************
+*/
+static uint8_t HM10_command(const char *command, const char *expect, uint32_t timeoutMs){
+    char reply[24];
+    uint8_t length = 0;
+    uint32_t start;
+    char c;
+
+    while(readCharFromUart(&c, UART3));
+    printStringToUart((char *)command, UART3);
+    flushUart(UART3);
+
+    start = BSP_CYCLES();
+    while((BSP_CYCLES() - start) < timeoutMs * (SYS_CLOCK_HZ / 1000U)){
+        if(readCharFromUart(&c, UART3) && length < sizeof(reply) - 1){
+            reply[length++] = c;
+            reply[length] = '\0';
+            if(strstr(reply, expect) != 0){
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+/**************************************************************************************
+ * HM-10 Probe Function
+ * Switches UART3 to the given rate and checks if the module answers there
+ ***************************************************************************************
+*/
+static uint8_t HM10_probe(uint32_t baud){
+    setUartBaud(UART3, baud);
+    return HM10_command("AT", "OK", HM10_PROBE_TIMEOUT_MS);
+}
+
+/**************************************************************************************
+ * HM-10 Negotiate Baud Function
+ * 1) Find the rate the module currently runs at, only the default 9600 and the
+ *    target (where it will be after a previous boot) are tried
+ * 2) If it is not at the target yet, send AT+BAUD and AT+RESET and switch UART3
+ * 3) Check the module answers at the new rate, otherwise go back to the old rate
+ * If the module answers at neither rate it is taken as not fitted and UART3 is left
+ * at 9600, which costs the boot two probe timeouts instead of a sweep of every
+ * rate. Returns the rate in use.
+ ***************************************************************************************
+*/
+uint32_t HM10_negotiateBaud(uint32_t targetBaud){
+    char command[12];
+    uint32_t currentBaud = 0;
+    uint8_t targetCode = HM10_NUM_RATES;
+    uint8_t i;
+
+    for(i = 0; i < HM10_NUM_RATES; i++){
+        if(hm10Rates[i] == targetBaud){
+            targetCode = i;
+        }
+    }
+
+    hm10Answered = 0;
+    if(HM10_probe(HM10_DEFAULT_BAUD)){
+        currentBaud = HM10_DEFAULT_BAUD;
+    } else if(targetCode < HM10_NUM_RATES && targetBaud != HM10_DEFAULT_BAUD && HM10_probe(targetBaud)){
+        currentBaud = targetBaud;
+    }
+
+    if(currentBaud == 0){
+        setUartBaud(UART3, HM10_DEFAULT_BAUD);
+        return HM10_DEFAULT_BAUD;
+    }
+    hm10Answered = 1;
+
+    if(currentBaud == targetBaud || targetCode == HM10_NUM_RATES){
+        return currentBaud;
+    }
+
+    snprintf(command, sizeof(command), "AT+BAUD%u", targetCode);
+    if(HM10_command(command, "OK+Set", HM10_REPLY_TIMEOUT_MS) && HM10_command("AT+RESET", "OK", HM10_REPLY_TIMEOUT_MS)){
+        BSP_delayMs(HM10_RESET_DELAY_MS);
+        if(HM10_probe(targetBaud)){
+            return targetBaud;
+        }
+    }
+
+    //Module did not come back at the new rate, fall back to the rate it answered at
+    if(!HM10_probe(currentBaud)){
+        hm10Answered = 0;
+        setUartBaud(UART3, HM10_DEFAULT_BAUD);
+        return HM10_DEFAULT_BAUD;
+    }
+    return currentBaud;
+}
+
+/**************************************************************************************
+ * HM-10 Transmit Time Function
+ * Time in microseconds the given number of bytes takes on UART3 at the current
+ * rate, 10 bits per byte for 8N1
+ ***************************************************************************************
+*/
+uint32_t HM10_transmitTimeUs(uint16_t bytes){
+    uint32_t baud = getUartBaud(UART3);
+    return baud ? (uint32_t)(((uint64_t)bytes * 10U * 1000000U) / baud) : 0;
+}
+
+/**************************************************************************************
+ * HM-10 Report Function
+ * Prints the negotiated rate and the time one reading takes on the link to UART0
+ ***************************************************************************************
+*/
+void HM10_report(void){
+    char line[80];
+    uint32_t us = HM10_transmitTimeUs(HM10_READING_BYTES);
+
+    snprintf(line, sizeof(line), "HM-10: %s, %lu baud, %lu.%lu ms per reading\n",
+             hm10Answered ? "found" : "no answer", (unsigned long)getUartBaud(UART3),
+             (unsigned long)(us / 1000), (unsigned long)((us % 1000) / 100));
+    printStringToUart(line, UART0);
+}
@@ -0,0 +1,28 @@
+/*
+ * hm10.h
+ *
+ * HM-10 Bluetooth module on UART3. At start-up the module is probed with AT
+ * commands and switched to a faster baud rate with AT+BAUD so the Bluetooth
+ * link is no longer the slowest output.
+ */
+
+#ifndef HM10_H_
+#define HM10_H_
+
+#include <stdint.h>
+#include "BSP\bsp.h"
+
+#define HM10_DEFAULT_BAUD       9600
+#define HM10_TARGET_BAUD        115200
+#define HM10_REPLY_TIMEOUT_MS   300
+#define HM10_PROBE_TIMEOUT_MS   100     //"AT" is answered within a few ms when no phone is connected
+#define HM10_RESET_DELAY_MS     800
+
+//Bytes in one reading sent to the phone: "Temp: xx.xx(C) -> xx.xx(F)         Humidity: xx.xx %rH\n"
+#define HM10_READING_BYTES      55
+
+uint32_t    HM10_negotiateBaud(uint32_t targetBaud);
+uint32_t    HM10_transmitTimeUs(uint16_t bytes);
+void        HM10_report(void);
+
+#endif /* HM10_H_ */
@@ -3,33 +3,145 @@
  * Created on: Nov 12, 2019
  * Author: Robert Novak
  */
+#include <string.h>
 #include "i2c.h"
+#include "BSP\bsp.h"
+
+//Bits of the master control/status register (MCS)
+#define I2C_MCS_RUN     (1<<0)
+#define I2C_MCS_START   (1<<1)
+#define I2C_MCS_STOP    (1<<2)
+#define I2C_MCS_ACK     (1<<3)
+#define I2C_MCS_QCMD    (1<<5)
+#define I2C_MCS_BUSY    (1<<0)
+#define I2C_MCS_ERROR   (1<<1)
+#define I2C_MCS_ADRACK  (1<<2)
+#define I2C_MCS_DATACK  (1<<3)
+#define I2C_MCS_ARBLST  (1<<4)
+#define I2C_MCS_BUSBSY  (1<<6)
+
+//Half an SCL period of the recovery clocks, 100 kHz
+#define I2C_RECOVERY_HALF_US    5U
+
+//Longest the STOP after an error may keep the bus busy, a few SCL periods at 100 kHz
+#define I2C_STOP_WAIT_US        50U
+
+//Pin function of SCL and SDA in GPIOPCTL, the same for all four controllers
+#define I2C_PCTL        3U
+
+//Channel mask of the mux not known (after a reset or a failed select)
+#define I2C_MUX_UNKNOWN 0x100
+
+//Pins, interrupt and state of one I2C controller
+typedef struct
+{
+    I2C0_Type           *i2c;
+    GPIOA_Type          *gpio;
+    uint8_t             gpioPort;       //bit in RCGCGPIO
+    uint8_t             sclPin;
+    uint8_t             sdaPin;
+    IRQn_Type           irq;
+    uint8_t             enabled;
+
+    //Transaction on the bus and one queue per priority
+    I2C_Transaction     *active;
+    I2C_Transaction     *head[I2C_NUM_PRIORITIES];
+    I2C_Transaction     *tail[I2C_NUM_PRIORITIES];
+    uint32_t            queued;
+
+    //Speed and priority of every 7-bit address, standard and normal until set otherwise
+    uint8_t             deviceSpeed[128];
+    uint8_t             devicePriority[128];
+    uint8_t             tpr;
+
+    //When the transaction on the bus is given up, set as it is started
+    uint64_t            deadlineUs;
+    uint8_t             recovering;     //I2C_checkTimeout has claimed the active transaction
+
+    //TCA9548A: address (0 for none) and the channel mask it has selected
+    uint8_t             muxAddress;
+    uint16_t            muxChannels;
+    uint16_t            muxPending;
+    uint8_t             selecting;      //the select for the active transaction is on the bus
+    uint8_t             stopping;       //the last command on the bus ends with a STOP
+    I2C_Stats           stats;
+} I2C_Bus;
+
+/*
+ * Pin mapping of the launchpad. PD0 and PD1 (I2C3) are tied to PB6 and PB7 through
+ * R9 and R10, those have to be removed to use I2C3.
+ */
+static I2C_Bus i2cBuses[I2C_NUM_BUSES] =
+{
+    {.i2c = I2C0, .gpio = GPIOB, .gpioPort = 1, .sclPin = 2, .sdaPin = 3, .irq = I2C0_IRQn},   //PB2(SCL), PB3(SDA)
+    {.i2c = I2C1, .gpio = GPIOA, .gpioPort = 0, .sclPin = 6, .sdaPin = 7, .irq = I2C1_IRQn},   //PA6(SCL), PA7(SDA)
+    {.i2c = I2C2, .gpio = GPIOE, .gpioPort = 4, .sclPin = 4, .sdaPin = 5, .irq = I2C2_IRQn},   //PE4(SCL), PE5(SDA)
+    {.i2c = I2C3, .gpio = GPIOD, .gpioPort = 3, .sclPin = 0, .sdaPin = 1, .irq = I2C3_IRQn}    //PD0(SCL), PD1(SDA)
+};
+
+static const uint32_t   i2cSpeedHz[I2C_NUM_SPEEDS] = {100000, 400000};
+
+//The controllers are 4 KB apart from I2C0 on
+static I2C_Bus *getI2CBus(I2C0_Type *bus){
+    return &i2cBuses[(((uint32_t)(uintptr_t)bus - I2C0_BASE) >> 12) & (I2C_NUM_BUSES - 1)];
+}
 
 /**************************************************************************************
- * I2C1 initialization Function
- * This function initializes I2C1 to be used with pins PA6(SCL) and PA7(SDA)
+ * I2C Master Setup Function
+ * Enables the master of a bus with its current speed and its interrupt. Used by
+ * I2C_init and again after a bus recovery, which resets the module.
  ***************************************************************************************
 */
-void I2C_init(void){
-    //Enable I2C1 Module Clock
-    SYSCTL->RCGCI2C |= (1<<1);
-    //Enable clock for GPIOA
-    SYSCTL->RCGCGPIO |= (1<<0);
+static void I2C_masterInit(I2C_Bus *bus){
+    bus->i2c->MCR = (1<<4);
+    bus->i2c->MTPR = bus->tpr;
+
+    //Master interrupt, raised after every byte and on errors
+    bus->i2c->MICR = 1;
+    bus->i2c->MIMR = 1;
+}
+
+/**************************************************************************************
+ * I2C initialization Function
+ * This function initializes one of I2C0 to I2C3 with the pins of i2cBuses, e.g.
+ * I2C1 with pins PA6(SCL) and PA7(SDA). Calling it again for a bus that is already
+ * set up does nothing, so every driver on a bus can make sure it is.
+ ***************************************************************************************
+*/
+void I2C_init(I2C0_Type *i2c){
+    I2C_Bus *bus = getI2CBus(i2c);
+    uint8_t scl = 1 << bus->sclPin;
+    uint8_t sda = 1 << bus->sdaPin;
+
+    if(bus->enabled){
+        return;
+    }
+
+    //Enable the I2C Module Clock
+    SYSCTL->RCGCI2C |= (1 << (bus - i2cBuses));
+    //Enable clock for the GPIO port of the pins
+    SYSCTL->RCGCGPIO |= (1 << bus->gpioPort);
+
+    //Enables the digital function of the SCL and SDA pins
+    bus->gpio->DEN |= scl | sda;
 
     /*
-    * The next 2 lines are for defining the specific peripheral to the pins PA6 and PA7
+     * A device left in the middle of a read by a reset of the launchpad holds SDA low
+     * until it has clocked out its byte, which blocks the bus for good. Check SDA while
+     * the pins are still plain inputs and clock the device free if needed.
+     */
+    if((bus->gpio->DATA_Bits[sda] & sda) == 0){
+        I2C_recoverBus(i2c);
+    }
+
+    /*
+    * The next 2 lines are for defining the specific peripheral to the pins
     * Alternative Function Select (AFSEL) Page 671 of TM4C123GH6PM Datasheet
     * GPIO Port Control (PCTL) Page 688 of TM4C123GH6PM Datasheet
     */
-    GPIOA->AFSEL |= (1<<6)|(1<<7);
-    GPIOA->PCTL |= (3<<28)|(3<<24);
-
-    //Enables the digital function of pins PA6 and PA7
-    GPIOA->DEN |= (1<<6)|(1<<7);
-    GPIOA->ODR = (1<<7);
-
-    //Initalize the I2C Master
-    I2C1->MCR = (1<<4);
+    bus->gpio->AFSEL |= scl | sda;
+    bus->gpio->PCTL |= (I2C_PCTL << (bus->sclPin * 4)) | (I2C_PCTL << (bus->sdaPin * 4));
+    bus->gpio->ODR = (bus->gpio->ODR & ~scl) | sda;
 
     /*
      * Set desired SCL clock speed of 100 Kbps by writing the value from the formula into
@@ -38,63 +150,683 @@ void I2C_init(void){
      *  TPR = (16MHz / 2*(6+4)*100000))-1
      *  TPR = 7
      */
-    I2C1->MTPR = (7<<0);
+    bus->tpr = 7;
+    I2C_masterInit(bus);
+    bus->enabled = 1;
+    NVIC_EnableIRQ(bus->irq);
+}
+
+/**************************************************************************************
+ * I2C Bus Recovery Function
+ * Frees a bus held by a device that lost track of a transaction (SDA stuck low).
+ * The controller is switched off and SCL driven through GPIO for up to 9 clocks,
+ * until the device has shifted out its byte and lets go of SDA. A STOP is then
+ * generated by hand and the pins are handed back to the freshly set up controller.
+ * Both pins are open drain, so the device and the pull-ups decide the level
+ * whenever we let go.
+ ***************************************************************************************
+*/
+void I2C_recoverBus(I2C0_Type *i2c){
+    I2C_Bus *bus = getI2CBus(i2c);
+    GPIOA_Type *gpio = bus->gpio;
+    uint8_t scl = 1 << bus->sclPin;
+    uint8_t sda = 1 << bus->sdaPin;
+    uint8_t clocks;
+
+    i2c->MCR = 0;
+    gpio->AFSEL &= ~(scl | sda);
+    gpio->ODR |= scl | sda;
+    gpio->DATA_Bits[scl | sda] = scl | sda;
+    gpio->DIR = (gpio->DIR | scl) & ~sda;
+    BSP_delayUs(I2C_RECOVERY_HALF_US);
+
+    for(clocks = 0; clocks < 9 && (gpio->DATA_Bits[sda] & sda) == 0; clocks++){
+        gpio->DATA_Bits[scl] = 0;
+        BSP_delayUs(I2C_RECOVERY_HALF_US);
+        gpio->DATA_Bits[scl] = scl;
+        BSP_delayUs(I2C_RECOVERY_HALF_US);
+    }
+
+    //STOP: SDA goes high while SCL is high
+    gpio->DATA_Bits[scl] = 0;
+    gpio->DATA_Bits[sda] = 0;
+    gpio->DIR |= sda;
+    BSP_delayUs(I2C_RECOVERY_HALF_US);
+    gpio->DATA_Bits[scl] = scl;
+    BSP_delayUs(I2C_RECOVERY_HALF_US);
+    gpio->DATA_Bits[sda] = sda;
+    BSP_delayUs(I2C_RECOVERY_HALF_US);
+
+    gpio->DIR &= ~(scl | sda);
+    gpio->ODR = (gpio->ODR & ~scl) | sda;
+    gpio->AFSEL |= scl | sda;
+    I2C_masterInit(bus);
+    bus->selecting = 0;
+    bus->muxChannels = I2C_MUX_UNKNOWN;
+    bus->stats.recoveries++;
+}
+
+/**************************************************************************************
+ * I2C Error Functions
+ * I2C_errorStatus turns the MCS bits after a byte into a status code. I2C_countError
+ * keeps the per-error counters of the bus.
+ ***************************************************************************************
+*/
+static uint8_t I2C_errorStatus(uint32_t mcs){
+    if(!(mcs & I2C_MCS_ERROR)){
+        return I2C_STATUS_DONE;
+    }
+    if(mcs & I2C_MCS_ARBLST){
+        return I2C_STATUS_ARB_LOST;
+    }
+    if(mcs & I2C_MCS_ADRACK){
+        return I2C_STATUS_ADDR_NACK;
+    }
+    if(mcs & I2C_MCS_DATACK){
+        return I2C_STATUS_DATA_NACK;
+    }
+    return I2C_STATUS_ERROR;
+}
+
+static void I2C_countError(I2C_Bus *bus, uint8_t status){
+    switch(status){
+    case I2C_STATUS_DONE:
+        return;
+    case I2C_STATUS_ADDR_NACK:
+        bus->stats.addrNacks++;
+        break;
+    case I2C_STATUS_DATA_NACK:
+        bus->stats.dataNacks++;
+        break;
+    case I2C_STATUS_ARB_LOST:
+        bus->stats.arbLost++;
+        break;
+    case I2C_STATUS_TIMEOUT:
+        bus->stats.timeouts++;
+        break;
+    default:
+        break;
+    }
+    bus->stats.errors++;
 }
 
+/**************************************************************************************
+ * I2C Bus Time and Timeout Functions
+ * I2C_busTimeUs is how long a transaction of txLength bytes written and rxLength
+ * bytes read keeps the bus at the speed of the device: 9 clocks per byte including
+ * the address bytes, plus start, repeated start and stop. I2C_timeoutUs is the
+ * longest it may take before it is given up, see I2C_TIMEOUT_FACTOR.
+ ***************************************************************************************
+*/
+uint32_t I2C_busTimeUs(I2C0_Type *i2c, uint16_t slaveAddress, uint16_t txLength, uint16_t rxLength){
+    I2C_Bus *bus = getI2CBus(i2c);
+    uint32_t khz = i2cSpeedHz[bus->deviceSpeed[slaveAddress & 0x7F]] / 1000U;
+    uint32_t bytes = 1U + txLength + ((rxLength != 0) ? 1U + rxLength : 0U);
+    uint32_t clocks = bytes * 9U + 3U;
+
+    return (clocks * 1000U + khz - 1U) / khz;
+}
+
+uint32_t I2C_timeoutUs(I2C0_Type *i2c, uint16_t slaveAddress, uint16_t txLength, uint16_t rxLength){
+    return I2C_TIMEOUT_FACTOR * I2C_busTimeUs(i2c, slaveAddress, txLength, rxLength) + I2C_TIMEOUT_MARGIN_US;
+}
+
+/**************************************************************************************
+ * I2C Command Functions
+ * I2C_command writes MCS for the transaction on the bus and remembers if the command
+ * ends with a STOP, in which case the controller also sends it after an error.
+ * I2C_waitIdle waits, for at most I2C_STOP_WAIT_US, until the STOP after an error is
+ * on the bus, the next transaction must not be started while it is generated.
+ ***************************************************************************************
+*/
+static void I2C_command(I2C_Bus *bus, uint32_t command){
+    bus->stopping = (command & I2C_MCS_STOP) != 0;
+    bus->i2c->MCS = command;
+}
+
+static void I2C_waitIdle(I2C_Bus *bus){
+    uint64_t deadline = BSP_timestampUs() + I2C_STOP_WAIT_US;
+
+    while((bus->i2c->MCS & I2C_MCS_BUSBSY) && BSP_timestampUs() < deadline);
+}
+
+/**************************************************************************************
+ * I2C Start Functions
+ * Put the first byte of the write or the read part of a transaction on the bus.
+ * STOP goes with the last byte, the read part starts with a repeated start.
+ ***************************************************************************************
+*/
+static void I2C_startRead(I2C_Bus *bus, I2C_Transaction *transaction){
+    transaction->reading = 1;
+    transaction->index = 0;
+    bus->i2c->MSA = (I2C_DEVICE_ADDRESS(transaction->address) << 1) | 1;
+    I2C_command(bus, I2C_MCS_START | I2C_MCS_RUN | ((transaction->rxLength == 1) ? I2C_MCS_STOP : I2C_MCS_ACK));
+}
+
+static void I2C_startTransfer(I2C_Bus *bus, I2C_Transaction *transaction){
+    uint8_t address = I2C_DEVICE_ADDRESS(transaction->address);
+
+    transaction->reading = 0;
+    transaction->index = 0;
+    if(transaction->txLength == 0 && transaction->rxLength == 0){
+        /*
+         * Zero-length write (quick command): only the address goes out. MDR is cleared
+         * so a controller that ignores QCMD sends a 0x00 byte, which neither device on
+         * the bus minds (register pointer of the BME280, a command control byte of the
+         * SSD1306).
+         */
+        bus->i2c->MSA = address << 1;
+        bus->i2c->MDR = 0;
+        I2C_command(bus, I2C_MCS_QCMD | I2C_MCS_START | I2C_MCS_RUN | I2C_MCS_STOP);
+        return;
+    }
+    if(transaction->txLength == 0){
+        I2C_startRead(bus, transaction);
+        return;
+    }
+    bus->i2c->MSA = address << 1;
+    bus->i2c->MDR = transaction->txData[0];
+    I2C_command(bus, I2C_MCS_START | I2C_MCS_RUN |
+                     ((transaction->txLength == 1 && transaction->rxLength == 0) ? I2C_MCS_STOP : 0));
+}
+
+static void I2C_start(I2C_Bus *bus, I2C_Transaction *transaction){
+    //The bus is idle between transactions, the only time the speed may change
+    uint8_t tpr = I2C_TPR(i2cSpeedHz[bus->deviceSpeed[transaction->address & 0x7F]]);
+    uint32_t busUs = I2C_busTimeUs(bus->i2c, transaction->address, transaction->txLength, transaction->rxLength);
+    uint64_t now = BSP_timestampUs();
+    uint16_t channels = bus->muxChannels;
+
+    if(tpr != bus->tpr){
+        bus->i2c->MTPR = tpr;
+        bus->tpr = tpr;
+    }
+    //Devices on the bus itself see every channel, only muxed ones need a select
+    if(bus->muxAddress != 0 && I2C_DEVICE_MUXED(transaction->address)){
+        channels = 1U << I2C_DEVICE_CHANNEL(transaction->address);
+    }
+    if(channels != bus->muxChannels){
+        //The select is a 1 byte write to the mux at the speed of the device
+        busUs += I2C_busTimeUs(bus->i2c, transaction->address, 1, 0);
+    }
+    bus->active = transaction;
+    bus->deadlineUs = now + I2C_TIMEOUT_FACTOR * busUs + I2C_TIMEOUT_MARGIN_US;
+
+    if(transaction->priority == I2C_PRIORITY_HIGH){
+        bus->stats.waitUs = (uint32_t)(now - transaction->submitUs);
+        if(bus->stats.waitUs > bus->stats.maxWaitUs){
+            bus->stats.maxWaitUs = bus->stats.waitUs;
+        }
+    } else if(busUs > bus->stats.maxBlockingUs){
+        bus->stats.maxBlockingUs = busUs;
+    }
+
+    if(channels != bus->muxChannels){
+        //Select first, the interrupt starts the transaction once the mux has taken it
+        bus->selecting = 1;
+        bus->muxPending = channels;
+        bus->stats.muxSelects++;
+        bus->i2c->MSA = bus->muxAddress << 1;
+        bus->i2c->MDR = (uint8_t)channels;
+        I2C_command(bus, I2C_MCS_START | I2C_MCS_RUN | I2C_MCS_STOP);
+        return;
+    }
+    I2C_startTransfer(bus, transaction);
+}
+
+/**************************************************************************************
+ * I2C Start Next Function
+ * Takes the oldest transaction of the highest priority off its queue and starts it,
+ * or leaves the bus idle if nothing is queued
+ ***************************************************************************************
+*/
+static void I2C_startNext(I2C_Bus *bus){
+    I2C_Transaction *transaction;
+    int8_t priority;
+
+    bus->active = 0;
+    for(priority = I2C_NUM_PRIORITIES - 1; priority >= 0; priority--){
+        transaction = bus->head[priority];
+        if(transaction != 0){
+            bus->head[priority] = transaction->next;
+            if(bus->head[priority] == 0){
+                bus->tail[priority] = 0;
+            }
+            I2C_start(bus, transaction);
+            return;
+        }
+    }
+}
+
+/**************************************************************************************
+ * I2C Finish Functions
+ * I2C_retire takes the finished transaction off the bus and starts the next one, it
+ * must not be interrupted by I2C_submit. I2C_complete then sets the status and calls
+ * the callback, so the callback can queue a follow-up transaction right away.
+ * I2C_finish does both.
+ ***************************************************************************************
+*/
+static void I2C_retire(I2C_Bus *bus, uint8_t status){
+    I2C_startNext(bus);
+    bus->queued--;
+    bus->stats.transactions++;
+    I2C_countError(bus, status);
+}
+
+static void I2C_complete(I2C_Transaction *transaction, uint8_t status){
+    transaction->status = status;
+    if(transaction->callback != 0){
+        transaction->callback(transaction);
+    }
+}
+
+static void I2C_finish(I2C_Bus *bus, I2C_Transaction *transaction, uint8_t status){
+    I2C_retire(bus, status);
+    I2C_complete(transaction, status);
+}
+
+/**************************************************************************************
+ * I2C Interrupt Handlers
+ * Called after every byte. Moves the transaction at the head of the queue of the bus
+ * on by one byte, or starts it once the mux select before it is done. On an error
+ * (no ACK, lost arbitration) the transaction is ended with a STOP, unless its last
+ * command already had one or arbitration was lost, in which case the bus is not ours
+ * to stop. The next transaction only starts once the bus is idle again. The status
+ * tells which error it was. Each controller has its own queue and interrupt, so
+ * transactions on different buses run at the same time.
+ ***************************************************************************************
+*/
+static void I2C_service(I2C_Bus *bus){
+    I2C_Transaction *transaction = bus->active;
+    I2C0_Type *i2c = bus->i2c;
+    uint32_t mcs;
+    uint16_t remaining;
+
+    i2c->MICR = 1;
+    if(transaction == 0){
+        return;
+    }
+
+    mcs = i2c->MCS;
+    if(mcs & I2C_MCS_ERROR){
+        if(!(mcs & I2C_MCS_ARBLST) && !bus->stopping){
+            I2C_command(bus, I2C_MCS_STOP);
+        }
+        I2C_waitIdle(bus);
+        if(bus->selecting){
+            bus->selecting = 0;
+            bus->muxChannels = I2C_MUX_UNKNOWN;
+        }
+        I2C_finish(bus, transaction, I2C_errorStatus(mcs));
+        return;
+    }
+
+    if(bus->selecting){
+        bus->selecting = 0;
+        bus->muxChannels = bus->muxPending;
+        I2C_startTransfer(bus, transaction);
+        return;
+    }
+
+    if(!transaction->reading){
+        transaction->index++;
+        if(transaction->index < transaction->txLength){
+            i2c->MDR = transaction->txData[transaction->index];
+            I2C_command(bus, I2C_MCS_RUN |
+                        ((transaction->index == transaction->txLength - 1 && transaction->rxLength == 0) ? I2C_MCS_STOP : 0));
+        } else if(transaction->rxLength != 0){
+            I2C_startRead(bus, transaction);
+        } else {
+            I2C_finish(bus, transaction, I2C_STATUS_DONE);
+        }
+        return;
+    }
+
+    transaction->rxData[transaction->index++] = i2c->MDR;
+    remaining = transaction->rxLength - transaction->index;
+    if(remaining == 0){
+        I2C_finish(bus, transaction, I2C_STATUS_DONE);
+    } else {
+        I2C_command(bus, I2C_MCS_RUN | ((remaining == 1) ? I2C_MCS_STOP : I2C_MCS_ACK));
+    }
+}
+
+void I2C0_IRQHandler(void){
+    I2C_service(&i2cBuses[0]);
+}
+
+void I2C1_IRQHandler(void){
+    I2C_service(&i2cBuses[1]);
+}
+
+void I2C2_IRQHandler(void){
+    I2C_service(&i2cBuses[2]);
+}
+
+void I2C3_IRQHandler(void){
+    I2C_service(&i2cBuses[3]);
+}
+
+/**************************************************************************************
+ * I2C Submit Function
+ * Queues a transaction on a bus with the priority of its device, it is started
+ * straight away if the bus is free. The transaction must stay valid until its status
+ * is no longer I2C_STATUS_PENDING. Can be called from interrupts, including from a
+ * transaction callback.
+ ***************************************************************************************
+*/
+void I2C_submit(I2C0_Type *i2c, I2C_Transaction *transaction){
+    I2C_Bus *bus = getI2CBus(i2c);
+    uint32_t primask = __get_PRIMASK();
+    uint8_t priority = bus->devicePriority[transaction->address & 0x7F];
+
+    transaction->status = I2C_STATUS_PENDING;
+    transaction->priority = priority;
+    transaction->next = 0;
+
+    __disable_irq();
+    transaction->submitUs = BSP_timestampUs();
+    if(bus->active == 0){
+        I2C_start(bus, transaction);
+    } else if(bus->tail[priority] == 0){
+        bus->head[priority] = transaction;
+        bus->tail[priority] = transaction;
+    } else {
+        bus->tail[priority]->next = transaction;
+        bus->tail[priority] = transaction;
+    }
+    if(++bus->queued > bus->stats.maxQueued){
+        bus->stats.maxQueued = bus->queued;
+    }
+    __set_PRIMASK(primask);
+}
+
+/**************************************************************************************
+ * I2C Check Timeout Function
+ * Gives up the transaction on the bus if it is past its deadline: the bus is
+ * recovered, the transaction finished with I2C_STATUS_TIMEOUT and the next one
+ * started. Nothing else notices a stuck bus, since it raises no interrupts, so this
+ * is called while waiting for a transaction (I2C_transfer, the acquisition tick).
+ * Only claiming the transaction and starting the next one happen with interrupts
+ * disabled. The recovery clocks take 100 us and more, for them just the interrupt
+ * of the bus is kept out; the transaction stays active meanwhile, so I2C_submit
+ * queues behind it.
+ ***************************************************************************************
+*/
+void I2C_checkTimeout(I2C0_Type *i2c){
+    I2C_Bus *bus = getI2CBus(i2c);
+    uint32_t primask = __get_PRIMASK();
+    I2C_Transaction *transaction = 0;
+
+    __disable_irq();
+    if(bus->active != 0 && !bus->recovering && BSP_timestampUs() > bus->deadlineUs){
+        transaction = bus->active;
+        bus->recovering = 1;
+        NVIC_DisableIRQ(bus->irq);
+    }
+    __set_PRIMASK(primask);
+    if(transaction == 0){
+        return;
+    }
+
+    I2C_recoverBus(i2c);
+    NVIC_ClearPendingIRQ(bus->irq);
+
+    __disable_irq();
+    bus->recovering = 0;
+    I2C_retire(bus, I2C_STATUS_TIMEOUT);
+    NVIC_EnableIRQ(bus->irq);
+    __set_PRIMASK(primask);
+    I2C_complete(transaction, I2C_STATUS_TIMEOUT);
+}
+
+/**************************************************************************************
+ * I2C Transfer Function
+ * Blocking write and/or read through the transaction queue of a bus. Returns the
+ * final status, I2C_STATUS_DONE or the reason the transaction failed.
+ ***************************************************************************************
+*/
+uint8_t I2C_transfer(I2C0_Type *i2c, uint16_t slaveAddress, const uint8_t *txData, uint16_t txLength, uint8_t *rxData, uint16_t rxLength){
+    I2C_Transaction transaction;
+
+    transaction.address = slaveAddress;
+    transaction.txData = txData;
+    transaction.txLength = txLength;
+    transaction.rxData = rxData;
+    transaction.rxLength = rxLength;
+    transaction.callback = 0;
+    transaction.arg = 0;
+    I2C_submit(i2c, &transaction);
+    while(transaction.status == I2C_STATUS_PENDING){
+        I2C_checkTimeout(i2c);
+    }
+    return transaction.status;
+}
+
+/**************************************************************************************
+ * I2C Scan Function
+ * Probes every address outside the reserved ranges (0x08 to 0x77) with a zero-length
+ * write and stores the ones that acknowledge in found, up to maxFound of them.
+ * Returns how many answered. Each probe is an address byte and a stop, about 120 us
+ * at 100 kHz, so a full scan takes about 15 ms.
+ ***************************************************************************************
+*/
+uint8_t I2C_scan(I2C0_Type *i2c, uint8_t *found, uint8_t maxFound){
+    uint8_t address;
+    uint8_t count = 0;
+
+    for(address = I2C_FIRST_ADDRESS; address <= I2C_LAST_ADDRESS; address++){
+        if(I2C_transfer(i2c, address, 0, 0, 0, 0) == I2C_STATUS_DONE){
+            if(count < maxFound){
+                found[count] = address;
+            }
+            count++;
+        }
+    }
+    return count;
+}
+
+/**************************************************************************************
+ * I2C Mux Functions
+ * Set the TCA9548A of a bus (0 for none) and get it back. Its channels are taken as
+ * unknown, the first transaction behind it selects one.
+ ***************************************************************************************
+*/
+void I2C_setMux(I2C0_Type *i2c, uint8_t muxAddress){
+    I2C_Bus *bus = getI2CBus(i2c);
+    uint32_t primask = __get_PRIMASK();
+
+    __disable_irq();
+    bus->muxAddress = muxAddress & 0x7F;
+    bus->muxChannels = I2C_MUX_UNKNOWN;
+    __set_PRIMASK(primask);
+}
+
+uint8_t I2C_getMux(I2C0_Type *i2c){
+    return getI2CBus(i2c)->muxAddress;
+}
+
+/**************************************************************************************
+ * I2C Stats Functions
+ * Counters of a bus, whether I2C_init has set it up and its number
+ ***************************************************************************************
+*/
+const I2C_Stats *I2C_getStats(I2C0_Type *i2c){
+    return &getI2CBus(i2c)->stats;
+}
+
+uint8_t I2C_enabled(I2C0_Type *i2c){
+    return getI2CBus(i2c)->enabled;
+}
+
+//0 to 3 for I2C0 to I2C3
+uint8_t I2C_busNumber(I2C0_Type *i2c){
+    return (uint8_t)(getI2CBus(i2c) - i2cBuses);
+}
+
+/**************************************************************************************
+ * I2C Speed Functions
+ * Set and get the bus speed used for a device, applied from its next transaction
+ ***************************************************************************************
+*/
+void I2C_setSpeed(I2C0_Type *i2c, uint16_t slaveAddress, uint8_t speed){
+    if(speed < I2C_NUM_SPEEDS){
+        getI2CBus(i2c)->deviceSpeed[slaveAddress & 0x7F] = speed;
+    }
+}
+
+uint8_t I2C_getSpeed(I2C0_Type *i2c, uint16_t slaveAddress){
+    return getI2CBus(i2c)->deviceSpeed[slaveAddress & 0x7F];
+}
+
+uint32_t I2C_speedHz(uint8_t speed){
+    return (speed < I2C_NUM_SPEEDS) ? i2cSpeedHz[speed] : 0;
+}
+
+//Priority of the transactions of a device from the next one submitted
+void I2C_setPriority(I2C0_Type *i2c, uint16_t slaveAddress, uint8_t priority){
+    if(priority < I2C_NUM_PRIORITIES){
+        getI2CBus(i2c)->devicePriority[slaveAddress & 0x7F] = priority;
+    }
+}
+
+/**************************************************************************************
+ * I2C Latency Bound Function
+ * Worst case time from submitting a high priority transaction to it being done,
+ * assuming it is the only high priority one in flight (as the acquisition does): it
+ * waits for at most the longest normal priority transaction seen on the bus, then
+ * takes its own bus time. Interrupt latency comes on top, a few us per byte.
+ ***************************************************************************************
+*/
+uint32_t I2C_latencyBoundUs(I2C0_Type *i2c, uint16_t slaveAddress, uint16_t txLength, uint16_t rxLength){
+    return getI2CBus(i2c)->stats.maxBlockingUs + I2C_busTimeUs(i2c, slaveAddress, txLength, rxLength);
+}
+
+/**************************************************************************************
+ * I2C Probe Speed Function
+ * Finds the highest speed a device works at. Starting with the fastest, each speed
+ * has to pass I2C_PROBE_TRIES transfers with txData written and, for rxLength > 0,
+ * rxLength bytes read back that must match expected every time, or the first reply
+ * if expected is 0. A reply corrupted the same way every time passes the latter,
+ * so give expected where the answer is known, like a chip ID. The device is left
+ * set to the speed that passed, which is returned (I2C_SPEED_STANDARD if none did).
+ ***************************************************************************************
+*/
+uint8_t I2C_probeSpeed(I2C0_Type *i2c, uint16_t slaveAddress, const uint8_t *txData, uint16_t txLength,
+                       uint16_t rxLength, const uint8_t *expected){
+    uint8_t first[8];
+    uint8_t data[8];
+    uint8_t speed;
+    uint8_t tries;
+    uint8_t passed;
+    uint16_t i;
+
+    if(rxLength > sizeof(data)){
+        rxLength = sizeof(data);
+    }
+    for(speed = I2C_NUM_SPEEDS - 1; speed > I2C_SPEED_STANDARD; speed--){
+        I2C_setSpeed(i2c, slaveAddress, speed);
+        passed = 1;
+        for(tries = 0; tries < I2C_PROBE_TRIES && passed; tries++){
+            if(I2C_transfer(i2c, slaveAddress, txData, txLength, data, rxLength) != I2C_STATUS_DONE){
+                passed = 0;
+            }
+            if(expected == 0 && tries == 0){
+                memcpy(first, data, rxLength);
+            }
+            for(i = 0; i < rxLength && passed; i++){
+                passed = (data[i] == ((expected != 0) ? expected[i] : first[i]));
+            }
+        }
+        if(passed){
+            return speed;
+        }
+    }
+    I2C_setSpeed(i2c, slaveAddress, I2C_SPEED_STANDARD);
+    return I2C_SPEED_STANDARD;
+}
+
+/**************************************************************************************
+ * Register level functions
+ * setSlaveAddress, I2C_Wait, readByte and writeByte drive a controller directly and
+ * bypass its transaction queue. They must only be used while nothing else is queued
+ * on that bus, the drivers use the transaction based functions further down.
+ ***************************************************************************************
+*/
+
 /**************************************************************************************
  * I2C Set Slave Address Function
  * Sets the given given slave address and either clears or sets the lsb which tells
  * I2C which mode it should be in(either read or write)
  ***************************************************************************************
 */
-void setSlaveAddress(uint8_t slaveAddress, uint8_t mode){
+void setSlaveAddress(I2C0_Type *i2c, uint8_t slaveAddress, uint8_t mode){
     if(mode == 0){
-        I2C1->MSA = ((slaveAddress<<1) & ~(1<<0)); //write mode
+        i2c->MSA = ((slaveAddress<<1) & ~(1<<0)); //write mode
     } else {
-        I2C1->MSA = ((slaveAddress<<1) | (1<<0)); //read mode
+        i2c->MSA = ((slaveAddress<<1) | (1<<0)); //read mode
     }
 }
 
 
 /**************************************************************************************
 * I2C Wait Function
-* This function polls MCS register and waits for the controller and the I2C module
-* to not be busy
+* This function polls MCS register and waits for the controller to not be busy, for
+* no longer than a byte at the current speed may take. Returns the status of the
+* byte, after an error a STOP is sent unless arbitration was lost.
 ***************************************************************************************
 */
-void I2C_Wait(void){
-    while((I2C1->MCS & (1<<6)) == 1);
-    while((I2C1->MCS & (1<<0)) != 0);
+uint8_t I2C_Wait(I2C0_Type *i2c){
+    I2C_Bus *bus = getI2CBus(i2c);
+    uint32_t start = BSP_CYCLES();
+    uint32_t cycles = I2C_timeoutUs(i2c, i2c->MSA >> 1, 1, 0) * (SYS_CLOCK_HZ / 1000000U);
+    uint32_t mcs;
+    uint8_t status;
+
+    while((mcs = i2c->MCS) & I2C_MCS_BUSY){
+        if((BSP_CYCLES() - start) > cycles){
+            I2C_countError(bus, I2C_STATUS_TIMEOUT);
+            I2C_recoverBus(i2c);
+            return I2C_STATUS_TIMEOUT;
+        }
+    }
+    status = I2C_errorStatus(mcs);
+    if(status != I2C_STATUS_DONE && status != I2C_STATUS_ARB_LOST){
+        i2c->MCS = I2C_MCS_STOP;
+    }
+    I2C_countError(bus, status);
+    return status;
 }
 
 /**************************************************************************************
 * I2C Read Byte Function
 * Following the flow charts on page 1008 of the TM4C123GH6PM Datasheet
 * This function sets conditions(stop, start, run, ack) then waits for the controller
-* and I2C module to not be busy. Then returns the data.
+* and I2C module to not be busy. Then stores the data and returns the status.
  ***************************************************************************************
 */
-uint8_t readByte(uint8_t conditions){
-    uint8_t tempRead;
+uint8_t readByte(I2C0_Type *i2c, uint8_t conditions, uint8_t *data){
+    uint8_t status;
 
-    I2C1->MCS = conditions;
-    I2C_Wait();
+    i2c->MCS = conditions;
+    status = I2C_Wait(i2c);
 
-    tempRead = I2C1->MDR;
-    return tempRead;
+    *data = i2c->MDR;
+    return status;
 }
 
 /**************************************************************************************
 * I2C Write Byte Function
 * Following the flow chart on page 1008 of the TM4C123GH6PM Datasheet
 * This function writes a byte of data, then sends the conditions(stop, start, run, ack)
+* and returns the status
 ***************************************************************************************
 */
-void writeByte(uint8_t dataByte, uint8_t conditions){
-    I2C1->MDR = dataByte;
+uint8_t writeByte(I2C0_Type *i2c, uint8_t dataByte, uint8_t conditions){
+    i2c->MDR = dataByte;
 
-    I2C1->MCS = conditions;
-    I2C_Wait();
+    i2c->MCS = conditions;
+    return I2C_Wait(i2c);
 }
 
 
@@ -102,37 +834,32 @@ void writeByte(uint8_t dataByte, uint8_t conditions){
  * I2C Read 1 byte function
  * To read a byte at a specific register address you first need to write 1 byte to
  * the slave address telling it which address you want to read from, then you can switch
- * the device to read mode and read the byte
+ * the device to read mode (repeated start) and read the byte. The read functions
+ * store the value and return the status, the value is 0 if the read failed.
  ***************************************************************************************
 */
-uint8_t I2C_Read8(uint8_t slaveAddress, uint8_t regAddress){
-    uint8_t tempRead;
-    setSlaveAddress(slaveAddress, 0);
-    writeByte(regAddress, ((1<<0)|(1<<1)|(1<<2)));
-    setSlaveAddress(slaveAddress, 1);
-    tempRead = readByte((1<<0)|(1<<1)|(1<<2));
-    return tempRead;
+uint8_t I2C_Read8(I2C0_Type *i2c, uint16_t slaveAddress, uint8_t regAddress, uint8_t *value){
+    uint8_t tempRead = 0;
+    uint8_t status = I2C_transfer(i2c, slaveAddress, &regAddress, 1, &tempRead, 1);
+
+    *value = (status == I2C_STATUS_DONE) ? tempRead : 0;
+    return status;
 }
 
 /**************************************************************************************
  * I2C Read 2 bytes function
  * To read at a specific register address you first need to write 1 byte to
  * the slave address telling it which address you want to read from, then you can switch
- * the device to read mode and read the bytes. Temp read needs to be left shifted by
- * 8 bits to store the next 8 bits in the LSB
+ * the device to read mode (repeated start) and read the bytes. The first byte read
+ * is the MSB.
 ***************************************************************************************
 */
-uint16_t I2C_Read16(uint8_t slaveAddress, uint8_t regAddress){
-    uint16_t tempRead;
-    setSlaveAddress(slaveAddress, 0);
-    writeByte(regAddress, ((1<<0)|(1<<1)|(1<<2)));
-
-    setSlaveAddress(slaveAddress, 1);
+uint8_t I2C_Read16(I2C0_Type *i2c, uint16_t slaveAddress, uint8_t regAddress, uint16_t *value){
+    uint8_t data[2] = {0, 0};
+    uint8_t status = I2C_transfer(i2c, slaveAddress, &regAddress, 1, data, 2);
 
-    tempRead = readByte((1<<0)|(1<<1)|(1<<3));
-    tempRead <<= 8;
-    tempRead |= readByte((1<<0)|(1<<2));
-    return tempRead;
+    *value = (status == I2C_STATUS_DONE) ? (((uint16_t)data[0] << 8) | data[1]) : 0;
+    return status;
 }
 
 /**************************************************************************************
@@ -142,11 +869,12 @@ uint16_t I2C_Read16(uint8_t slaveAddress, uint8_t regAddress){
 * bytes then reverse them.
  ***************************************************************************************
 */
-uint16_t read16_Reverse(uint8_t slaveAddress, uint8_t reg) {
-
-    uint16_t tempRead = I2C_Read16(slaveAddress, reg);
+uint8_t read16_Reverse(I2C0_Type *i2c, uint16_t slaveAddress, uint8_t reg, uint16_t *value) {
+    uint16_t tempRead;
+    uint8_t status = I2C_Read16(i2c, slaveAddress, reg, &tempRead);
 
-    return ((tempRead >> 8) | (tempRead << 8));
+    *value = (uint16_t)((tempRead >> 8) | (tempRead << 8));
+    return status;
 }
 
 /**************************************************************************************
@@ -154,8 +882,8 @@ uint16_t read16_Reverse(uint8_t slaveAddress, uint8_t reg) {
 * Based on our read 2 Bytes, this function returns a signed value by type casting
  ***************************************************************************************
 */
-int16_t readS16(uint8_t slaveAddress, uint8_t reg){
-    return (int16_t)I2C_Read16(slaveAddress, reg);
+uint8_t readS16(I2C0_Type *i2c, uint16_t slaveAddress, uint8_t reg, int16_t *value){
+    return I2C_Read16(i2c, slaveAddress, reg, (uint16_t *)value);
 }
 
 /**************************************************************************************
@@ -164,29 +892,24 @@ int16_t readS16(uint8_t slaveAddress, uint8_t reg){
 * calibration numbers having LSB stored in memory before the MSB
  ***************************************************************************************
 */
-int16_t readS16_Reverse(uint8_t slaveAddress, uint8_t reg){
-    return (int16_t)read16_Reverse(slaveAddress, reg);
+uint8_t readS16_Reverse(I2C0_Type *i2c, uint16_t slaveAddress, uint8_t reg, int16_t *value){
+    return read16_Reverse(i2c, slaveAddress, reg, (uint16_t *)value);
 }
 
 /**************************************************************************************
  * I2C Read 3 bytes function
  * To read at a specific register address you first need to write 1 byte to
  * the slave address telling it which address you want to read from, then you can switch
- * the device to read mode and read the bytes. Temp read needs to be left shifted by
- * 8 bits after each read to make room for the next 8 bits.
+ * the device to read mode (repeated start) and read the bytes. The first byte read
+ * is the MSB.
 ***************************************************************************************
 */
-uint32_t I2C_Read24(uint8_t slaveAddress, uint8_t regAddress){
-    uint32_t tempRead;
-    setSlaveAddress(slaveAddress, 0);
-    writeByte(regAddress, ((1<<0)|(1<<1)|(1<<2)));
-    setSlaveAddress(slaveAddress, 1);
-    tempRead = readByte((1<<0)|(1<<1)|(1<<3));
-    tempRead <<= 8;
-    tempRead |= readByte((1<<0)|(1<<3));
-    tempRead <<= 8;
-    tempRead |= readByte((1<<0)|(1<<2));
-    return tempRead;
+uint8_t I2C_Read24(I2C0_Type *i2c, uint16_t slaveAddress, uint8_t regAddress, uint32_t *value){
+    uint8_t data[3] = {0, 0, 0};
+    uint8_t status = I2C_transfer(i2c, slaveAddress, &regAddress, 1, data, 3);
+
+    *value = (status == I2C_STATUS_DONE) ? (((uint32_t)data[0] << 16) | ((uint32_t)data[1] << 8) | data[2]) : 0;
+    return status;
 }
 
 /**************************************************************************************
@@ -194,38 +917,33 @@ uint32_t I2C_Read24(uint8_t slaveAddress, uint8_t regAddress){
  * This function uses the read 3 bytes function, then returns a typecasted version
  ***************************************************************************************
 */
-int32_t readS24(uint8_t slaveAddress, uint8_t reg){
-    return (int32_t)I2C_Read24(slaveAddress, reg);
+uint8_t readS24(I2C0_Type *i2c, uint16_t slaveAddress, uint8_t reg, int32_t *value){
+    return I2C_Read24(i2c, slaveAddress, reg, (uint32_t *)value);
+}
+
+/**************************************************************************************
+ * I2C Read Bytes Function
+ * Burst read of numberOfBytes starting at regAddress. The register address is
+ * written first, then the bytes are read after a repeated start.
+***************************************************************************************
+*/
+uint8_t I2C_ReadBytes(I2C0_Type *i2c, uint16_t slaveAddress, uint8_t regAddress, uint8_t *data, uint8_t numberOfBytes){
+    if(numberOfBytes == 0){
+        return I2C_STATUS_ERROR;
+    }
+    return I2C_transfer(i2c, slaveAddress, &regAddress, 1, data, numberOfBytes);
 }
 
 /**************************************************************************************
 * I2C Write Bytes Function
-* This function will write a number of bytes to the slave address. There are three
-* cases to look out for when writing the byte.
-* 1) First Byte Sent ( i == 0 ): We need to send run and start conditions
-* 2) Last byte Sent ( i == (numberofBytes)-1 ): We need to send a run and stop condition
-* 3) Else: We need to send only a run condition
-* We need to wait for controller and I2C module to not be busy after writing each byte
- ***************************************************************************************
-*/
-void I2C_Write(uint8_t slaveAddress, uint8_t *dataByte, uint8_t numberOfBytes){
-    setSlaveAddress(slaveAddress, 0);
-
-    for(int i = 0; i < numberOfBytes ; i++){
-        if(i == 0){
-            I2C1->MDR = *dataByte;
-            I2C1->MCS = ((1<<0)|(1<<1));
-            I2C_Wait();
-            dataByte++;
-        } else if (i == (numberOfBytes-1)){
-            I2C1->MDR = *dataByte;
-            I2C1->MCS = ((1<<0)|(1<<2));
-            I2C_Wait();
-        } else {
-            I2C1->MDR = *dataByte;
-            I2C1->MCS = (1<<0);
-            I2C_Wait();
-            dataByte++;
-        }
+* This function will write a number of bytes to the slave address. The first byte is
+* sent with a start and the last one with a stop, the I2C interrupt feeds the ones
+* in between.
+ ***************************************************************************************
+*/
+uint8_t I2C_Write(I2C0_Type *i2c, uint16_t slaveAddress, uint8_t *dataByte, uint16_t numberOfBytes){
+    if(numberOfBytes == 0){
+        return I2C_STATUS_ERROR;
     }
+    return I2C_transfer(i2c, slaveAddress, dataByte, numberOfBytes, 0, 0);
 }
@@ -10,21 +10,173 @@
 
 #include <stdint.h>
 #include "BSP\TM4C123GH6PM.h"
+#include "BSP\bsp.h"
 
+/*
+ * Any of the four controllers I2C0 to I2C3 can be used, every function takes the
+ * controller (I2C0, I2C1, ...) as its bus handle, the same way the UART functions
+ * take the UART. Each bus has its own pins, transaction queue, device speeds and
+ * counters, so transactions on different buses run at the same time.
+ */
+#define I2C_NUM_BUSES           4
+
+/*
+ * Interrupt driven transactions. A transaction writes txLength bytes and then, after
+ * a repeated start, reads rxLength bytes. Either length may be 0, with both 0 only the
+ * address is sent (a zero-length write, used to see if a device is there). They
+ * are queued and run one after the other by the interrupt of the bus, which calls the
+ * callback of a transaction from interrupt context once it is done. The blocking
+ * functions below queue a transaction and wait for it, so blocking and interrupt
+ * driven users can share the bus. Blocking functions may only be called from the
+ * main loop with interrupts enabled.
+ *
+ * Every function that touches the bus returns one of the status codes below. A
+ * transaction that is still on the bus after I2C_timeoutUs is abandoned with
+ * I2C_STATUS_TIMEOUT and the bus is recovered (see I2C_recoverBus).
+ */
+#define I2C_STATUS_IDLE         0
+#define I2C_STATUS_PENDING      1
+#define I2C_STATUS_DONE         2
+#define I2C_STATUS_ERROR        3       //bad arguments or an error the hardware gave no reason for
+#define I2C_STATUS_ADDR_NACK    4       //no device answered the address
+#define I2C_STATUS_DATA_NACK    5       //the device did not acknowledge a data byte
+#define I2C_STATUS_ARB_LOST     6
+#define I2C_STATUS_TIMEOUT      7
+
+/*
+ * Timeout of a transaction, I2C_TIMEOUT_FACTOR times the time its bytes (9 clocks
+ * each, plus start, repeated start and stop) take at the speed of the device, plus
+ * I2C_TIMEOUT_MARGIN_US for interrupt latency
+ */
+#define I2C_TIMEOUT_FACTOR      2U
+#define I2C_TIMEOUT_MARGIN_US   1000U
+
+/*
+ * Bus speeds. Each device address has its own speed, MTPR is switched between
+ * transactions when the next one is for a device with a different speed.
+ *  TPR = (System Clock/(2*(SCL_LP + SCL_HP)*SCL_CLK))-1, SCL_LP + SCL_HP = 10
+ * At 16 MHz that gives 7 for 100 kHz and 1 for 400 kHz. Fast-mode plus (1 MHz)
+ * would need TPR = -0.2, so it cannot be generated from this clock. High-speed mode
+ * (3.4 MHz, which the BME280 supports) fails the same way: with SCL_LP + SCL_HP = 3
+ * in that mode it would need TPR = 16 MHz/(2*3*3.4 MHz) - 1 = -0.2 as well.
+ */
+#define I2C_SPEED_STANDARD      0       //100 kHz
+#define I2C_SPEED_FAST          1       //400 kHz
+#define I2C_NUM_SPEEDS          2
+
+#define I2C_TPR(hz)             (SYS_CLOCK_HZ / (2U * 10U * (hz)) - 1U)
+
+//7-bit addresses I2C_scan probes, the others are reserved
+#define I2C_FIRST_ADDRESS       0x08
+#define I2C_LAST_ADDRESS        0x77
+
+//Transfers a speed has to pass in I2C_probeSpeed
+#define I2C_PROBE_TRIES         8
+
+/*
+ * Priorities. Like the speed, each device address has a priority and its
+ * transactions go into the queue of that priority. When the bus becomes free the
+ * oldest transaction of the highest priority goes next, so a sensor read only waits
+ * for the transaction already on the bus, never for the ones queued before it.
+ * Transactions are not interrupted, long writes (a display frame) have to be split
+ * into bounded transactions for this to work, see SSD_writePages.
+ */
+#define I2C_PRIORITY_NORMAL     0
+#define I2C_PRIORITY_HIGH       1
+#define I2C_NUM_PRIORITIES      2
+
+/*
+ * TCA9548A multiplexer. A mux set with I2C_setMux puts up to eight downstream buses
+ * behind one address (0x70 to 0x77), so eight sensors with the same address can sit
+ * on one controller. A device behind channel c is addressed as I2C_MUX_DEVICE(c,
+ * address) wherever the functions below take a slaveAddress, plain 7-bit addresses
+ * are devices on the bus itself. Before a transaction the engine writes the channel
+ * mask to the mux if it is not already selected, so a run of transactions on one
+ * channel costs a single select (2 bytes). Direct devices see the traffic of every
+ * channel and leave the selected one as it is, which also means an address used on
+ * the bus itself cannot be used behind the mux. Speed and priority go by the 7-bit
+ * address, so devices of one kind share them whatever channel they are on.
+ */
+#define I2C_MUX_FIRST_ADDRESS   0x70
+#define I2C_MUX_LAST_ADDRESS    0x77
+#define I2C_MUX_CHANNELS        8
+
+#define I2C_MUX_DEVICE(channel, address)    ((uint16_t)((((channel) + 1U) << 8) | ((address) & 0x7F)))
+#define I2C_DEVICE_ADDRESS(device)          ((uint8_t)((device) & 0x7F))
+#define I2C_DEVICE_MUXED(device)            (((device) >> 8) != 0)
+#define I2C_DEVICE_CHANNEL(device)          ((uint8_t)(((device) >> 8) - 1U))
+
+typedef struct I2C_Transaction I2C_Transaction;
+typedef void (*I2C_Callback)(I2C_Transaction *transaction);
+
+struct I2C_Transaction
+{
+    uint16_t            address;        //7-bit address or I2C_MUX_DEVICE
+    const uint8_t       *txData;
+    uint16_t            txLength;
+    uint8_t             *rxData;
+    uint16_t            rxLength;
+    I2C_Callback        callback;       //may be 0
+    void                *arg;
+    volatile uint8_t    status;
+
+    //Used by the driver while the transaction is queued
+    uint16_t            index;
+    uint8_t             reading;
+    uint8_t             priority;
+    uint64_t            submitUs;
+    I2C_Transaction     *next;
+};
+
+typedef struct
+{
+    uint32_t transactions;
+    uint32_t errors;            //all of the below and I2C_STATUS_ERROR
+    uint32_t addrNacks;
+    uint32_t dataNacks;
+    uint32_t arbLost;
+    uint32_t timeouts;
+    uint32_t recoveries;
+    uint32_t maxQueued;
+    uint32_t waitUs;            //submit to start of the last high priority transaction
+    uint32_t maxWaitUs;
+    uint32_t maxBlockingUs;     //bus time of the longest normal priority transaction
+    uint32_t muxSelects;        //channel switches written to the mux
+} I2C_Stats;
 
+void        I2C_init(I2C0_Type *i2c);
+uint8_t     I2C_enabled(I2C0_Type *i2c);
+uint8_t     I2C_busNumber(I2C0_Type *i2c);
+const I2C_Stats *I2C_getStats(I2C0_Type *i2c);
+void        I2C_setSpeed(I2C0_Type *i2c, uint16_t slaveAddress, uint8_t speed);
+uint8_t     I2C_getSpeed(I2C0_Type *i2c, uint16_t slaveAddress);
+uint32_t    I2C_speedHz(uint8_t speed);
+void        I2C_setPriority(I2C0_Type *i2c, uint16_t slaveAddress, uint8_t priority);
+uint32_t    I2C_busTimeUs(I2C0_Type *i2c, uint16_t slaveAddress, uint16_t txLength, uint16_t rxLength);
+uint32_t    I2C_latencyBoundUs(I2C0_Type *i2c, uint16_t slaveAddress, uint16_t txLength, uint16_t rxLength);
+uint8_t     I2C_probeSpeed(I2C0_Type *i2c, uint16_t slaveAddress, const uint8_t *txData, uint16_t txLength,
+                           uint16_t rxLength, const uint8_t *expected);
+void        I2C_submit(I2C0_Type *i2c, I2C_Transaction *transaction);
+uint8_t     I2C_transfer(I2C0_Type *i2c, uint16_t slaveAddress, const uint8_t *txData, uint16_t txLength, uint8_t *rxData, uint16_t rxLength);
+uint32_t    I2C_timeoutUs(I2C0_Type *i2c, uint16_t slaveAddress, uint16_t txLength, uint16_t rxLength);
+void        I2C_checkTimeout(I2C0_Type *i2c);
+uint8_t     I2C_scan(I2C0_Type *i2c, uint8_t *found, uint8_t maxFound);
+void        I2C_recoverBus(I2C0_Type *i2c);
+void        I2C_setMux(I2C0_Type *i2c, uint8_t muxAddress);
+uint8_t     I2C_getMux(I2C0_Type *i2c);
 
-void        writeByte(uint8_t dataByte, uint8_t conditions);
-void        I2C_init(void);
-void        I2C_Wait(void);
-void        I2C_Write(uint8_t slaveAddress, uint8_t *dataByte, uint8_t numberOfBytes);
-void        setSlaveAddress(uint8_t slaveAddress, uint8_t mode);
-uint8_t     I2C_Read8(uint8_t slaveAddress, uint8_t regAddress);
-int16_t     readS16(uint8_t slaveAddress, uint8_t reg);
-uint16_t    I2C_Read16(uint8_t slaveAddress, uint8_t regAddress);
-uint16_t    read16_Reverse(uint8_t slaveAddress, uint8_t reg);
-int16_t     readS16_Reverse(uint8_t slaveAddress, uint8_t reg);
-uint32_t    I2C_Read24(uint8_t slaveAddress, uint8_t regAddress);
-int32_t     readS24(uint8_t slaveAddress, uint8_t reg);
-uint8_t     readByte(uint8_t conditions);
+uint8_t     writeByte(I2C0_Type *i2c, uint8_t dataByte, uint8_t conditions);
+uint8_t     I2C_Wait(I2C0_Type *i2c);
+uint8_t     I2C_Write(I2C0_Type *i2c, uint16_t slaveAddress, uint8_t *dataByte, uint16_t numberOfBytes);
+void        setSlaveAddress(I2C0_Type *i2c, uint8_t slaveAddress, uint8_t mode);
+uint8_t     I2C_Read8(I2C0_Type *i2c, uint16_t slaveAddress, uint8_t regAddress, uint8_t *value);
+uint8_t     readS16(I2C0_Type *i2c, uint16_t slaveAddress, uint8_t reg, int16_t *value);
+uint8_t     I2C_Read16(I2C0_Type *i2c, uint16_t slaveAddress, uint8_t regAddress, uint16_t *value);
+uint8_t     read16_Reverse(I2C0_Type *i2c, uint16_t slaveAddress, uint8_t reg, uint16_t *value);
+uint8_t     readS16_Reverse(I2C0_Type *i2c, uint16_t slaveAddress, uint8_t reg, int16_t *value);
+uint8_t     I2C_Read24(I2C0_Type *i2c, uint16_t slaveAddress, uint8_t regAddress, uint32_t *value);
+uint8_t     readS24(I2C0_Type *i2c, uint16_t slaveAddress, uint8_t reg, int32_t *value);
+uint8_t     readByte(I2C0_Type *i2c, uint8_t conditions, uint8_t *data);
+uint8_t     I2C_ReadBytes(I2C0_Type *i2c, uint16_t slaveAddress, uint8_t regAddress, uint8_t *data, uint8_t numberOfBytes);
 
 #endif /* I2C_H_ */
@@ -0,0 +1,159 @@
+/*
+ * sample_log.c
+ *
+ * RAM sample history built on top of the time-series codec. Blocks are used as a
+ * ring, logHead is the block currently being filled.
+ */
+
+#include <stdio.h>
+#include "sample_log.h"
+#include "UART\uart.h"
+
+LOG_Stats logStats;
+
+static uint8_t      logBlocks[LOG_NUM_BLOCKS][LOG_BLOCK_SIZE];
+static uint16_t     logBlockBytes[LOG_NUM_BLOCKS];
+static uint16_t     logBlockSamples[LOG_NUM_BLOCKS];
+static uint8_t      logHead;
+static uint8_t      logUsed;
+static TSC_Encoder  logEncoder;
+
+/**************************************************************************************
+ * Sample Log Initialize Function
+ * Clears the history and starts encoding into the first block
+ ***************************************************************************************
+*/
+void LOG_init(void){
+    uint8_t i;
+    for(i = 0; i < LOG_NUM_BLOCKS; i++){
+        logBlockBytes[i] = 0;
+        logBlockSamples[i] = 0;
+    }
+    logHead = 0;
+    logUsed = 1;
+    TSC_encoderInit(&logEncoder, logBlocks[0], LOG_BLOCK_SIZE, LOG_CHANNELS);
+    logBlockBytes[0] = TSC_encodedBytes(&logEncoder);
+}
+
+/**************************************************************************************
+ * Sample Log Append Function
+ * Compresses one sample into the current block. When the block is full the next one
+ * in the ring is started (overwriting the oldest history if needed) and the sample
+ * is written there. Returns 1 if a block was completed by this call.
+ * Temperature is in 0.01 degC and humidity in 0.01 %rH.
+ ***************************************************************************************
+*/
+uint8_t LOG_append(uint32_t timestamp, int32_t temperature, int32_t humidity){
+    int32_t values[LOG_CHANNELS] = {temperature, humidity};
+    uint8_t blockCompleted = 0;
+    uint32_t start = BSP_CYCLES();
+    uint32_t cycles;
+
+    if(!TSC_encodeSample(&logEncoder, timestamp, values)){
+        logHead = (logHead + 1) % LOG_NUM_BLOCKS;
+        if(logUsed < LOG_NUM_BLOCKS){
+            logUsed++;
+        }
+        TSC_encoderInit(&logEncoder, logBlocks[logHead], LOG_BLOCK_SIZE, LOG_CHANNELS);
+        TSC_encodeSample(&logEncoder, timestamp, values);
+        logStats.blocksCompleted++;
+        blockCompleted = 1;
+    }
+    cycles = BSP_CYCLES() - start;
+
+    logBlockBytes[logHead] = TSC_encodedBytes(&logEncoder);
+    logBlockSamples[logHead] = logEncoder.count;
+
+    logStats.samples++;
+    logStats.encodeCycles += cycles;
+    if(cycles > logStats.maxEncodeCycles){
+        logStats.maxEncodeCycles = cycles;
+    }
+    return blockCompleted;
+}
+
+/**************************************************************************************
+ * Sample Log Block Access Functions
+ * Blocks are indexed from the oldest (0) to the one being filled (LOG_numBlocks()-1).
+ * Each block can be handed to TSC_decoderInit as is.
+ ***************************************************************************************
+*/
+uint8_t LOG_numBlocks(void){
+    return logUsed;
+}
+
+const uint8_t *LOG_getBlock(uint8_t index, uint16_t *length){
+    uint8_t block = (logHead + LOG_NUM_BLOCKS - (logUsed - 1) + index) % LOG_NUM_BLOCKS;
+    *length = logBlockBytes[block];
+    return logBlocks[block];
+}
+
+/**************************************************************************************
+ * Sample Log Size Functions
+ * Number of bytes and samples currently held in the history
+ ***************************************************************************************
+*/
+uint32_t LOG_compressedBytes(void){
+    uint32_t total = 0;
+    uint8_t i;
+    for(i = 0; i < LOG_NUM_BLOCKS; i++){
+        total += logBlockBytes[i];
+    }
+    return total;
+}
+
+uint32_t LOG_storedSamples(void){
+    uint32_t total = 0;
+    uint8_t i;
+    for(i = 0; i < LOG_NUM_BLOCKS; i++){
+        total += logBlockSamples[i];
+    }
+    return total;
+}
+
+/**************************************************************************************
+ * Sample Log Format Statistics Function
+ * Writes the compression ratio of the stored history (full width size / compressed
+ * size) and the average and worst encode time in CPU cycles per sample into line
+ ***************************************************************************************
+*/
+void LOG_formatStats(char *line, uint16_t size){
+    uint32_t stored = LOG_storedSamples();
+    uint32_t compressed = LOG_compressedBytes();
+    uint32_t ratio = compressed ? (stored * LOG_RAW_SAMPLE_BYTES * 100) / compressed : 0;
+    uint32_t avgCycles = logStats.samples ? logStats.encodeCycles / logStats.samples : 0;
+
+    snprintf(line, size, "Log: %lu samples in %lu bytes, ratio %lu.%02lu, %lu cycles/sample (max %lu)\n",
+             (unsigned long)stored, (unsigned long)compressed, (unsigned long)(ratio / 100), (unsigned long)(ratio % 100),
+             (unsigned long)avgCycles, (unsigned long)logStats.maxEncodeCycles);
+}
+
+/**************************************************************************************
+ * Sample Log Dump Function
+ * Decodes the whole history, oldest sample first, and prints it as CSV
+ ***************************************************************************************
+*/
+void LOG_dump(UART0_Type *UARTtemp){
+    char line[48];
+    TSC_Decoder decoder;
+    const uint8_t *block;
+    uint16_t length;
+    uint32_t timestamp;
+    int32_t values[LOG_CHANNELS];
+    uint8_t i;
+
+    printStringToUart("time_ms,temp_c,humidity_rh\n", UARTtemp);
+    for(i = 0; i < LOG_numBlocks(); i++){
+        block = LOG_getBlock(i, &length);
+        if(!TSC_decoderInit(&decoder, block, length)){
+            continue;
+        }
+        while(TSC_decodeSample(&decoder, &timestamp, values)){
+            snprintf(line, sizeof(line), "%lu,%s%ld.%02ld,%ld.%02ld\n", (unsigned long)timestamp,
+                     (values[0] < 0 && values[0] > -100) ? "-" : "",
+                     (long)(values[0] / 100), (long)((values[0] < 0 ? -values[0] : values[0]) % 100),
+                     (long)(values[1] / 100), (long)(values[1] % 100));
+            printStringToUart(line, UARTtemp);
+        }
+    }
+}
@@ -0,0 +1,49 @@
+/*
+ * sample_log.h
+ *
+ * On-device history of sensor samples kept in RAM. Samples are compressed with
+ * the time-series codec into fixed size blocks, once every block is full the
+ * oldest block is overwritten.
+ *
+ * host/ts_codec_test.c takes the block size from here, with -DHOST_TEST only the
+ * definitions that do not need the target headers are left.
+ */
+
+#ifndef SAMPLE_LOG_H_
+#define SAMPLE_LOG_H_
+
+#include <stdint.h>
+#ifndef HOST_TEST
+#include "BSP\bsp.h"
+#include "CODEC\ts_codec.h"
+#endif
+
+#define LOG_BLOCK_SIZE          256
+#define LOG_NUM_BLOCKS          8
+#define LOG_CHANNELS            2
+
+//Size of one sample if it was stored at full width (timestamp + channels)
+#define LOG_RAW_SAMPLE_BYTES    (4 + 4 * LOG_CHANNELS)
+
+typedef struct
+{
+    uint32_t samples;           //samples appended since boot
+    uint32_t encodeCycles;      //total CPU cycles spent in the encoder
+    uint32_t maxEncodeCycles;   //slowest single encode
+    uint32_t blocksCompleted;   //blocks filled since boot
+} LOG_Stats;
+
+extern LOG_Stats logStats;
+
+void            LOG_init(void);
+uint8_t         LOG_append(uint32_t timestamp, int32_t temperature, int32_t humidity);
+uint8_t         LOG_numBlocks(void);
+const uint8_t  *LOG_getBlock(uint8_t index, uint16_t *length);
+uint32_t        LOG_compressedBytes(void);
+uint32_t        LOG_storedSamples(void);
+void            LOG_formatStats(char *line, uint16_t size);
+#ifndef HOST_TEST
+void            LOG_dump(UART0_Type *UARTtemp);
+#endif
+
+#endif /* SAMPLE_LOG_H_ */
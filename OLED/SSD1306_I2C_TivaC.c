@@ -1,22 +1,96 @@
-// SSD1306 128x64 OLED screen using I2C
+// SSD1306 128x64 OLED screen using I2C or SPI (see SSD1306_SSI_TivaC.c)
 // Datasheet: https://cdn-shop.adafruit.com/datasheets/SSD1306.pdf
 
 #include <OLED\font_6x8.h>
 #include "SSD1306_I2C_TivaC.h"
 
+I2C0_Type *ssdBus = I2C1;
+uint8_t ssdAddress = SSD_ADDRESS;
+uint8_t ssdScrolling;
+uint8_t ssdAsleep;
+
+static uint8_t SSD_i2cCommand(const uint8_t *commands, uint8_t length);
+static uint8_t SSD_i2cData(const uint8_t *data, uint8_t length);
+static uint8_t SSD_i2cPages(uint8_t count, const SSD_Page *pages, uint8_t step);
+
+SSD_Transport ssdI2CTransport = {.name = "I2C", .command = SSD_i2cCommand, .data = SSD_i2cData, .pages = SSD_i2cPages};
+SSD_Transport *ssdTransport = &ssdI2CTransport;
+
+//Display RAM is not written while the scroll engine runs or the panel is off
+#define SSD_RAM_LOCKED()    (ssdScrolling || ssdAsleep)
+
+/**************************************************************************************
+ * SSD1306 I2C Transport Functions
+ * A control byte of 0x00 says every byte after it is a command, 0x40 that they are
+ * display data, so a list of commands or a run of columns goes out as one write.
+ * Pages are written each as its own transaction of the 0x40 control byte and 128
+ * columns. All pages are queued at once and the function returns when the last is
+ * done, giving higher priority transactions on the bus (the sensor) a chance to go
+ * between pages instead of waiting for the whole write.
+ ***************************************************************************************
+*/
+static uint8_t SSD_i2cWrite(uint8_t control, const uint8_t *bytes, uint8_t length){
+    uint8_t buffer[SSD_MAX_TRANSFER + 1];
+    uint8_t i;
+
+    if(length == 0 || length > SSD_MAX_TRANSFER){
+        return I2C_STATUS_ERROR;
+    }
+    buffer[0] = control;
+    for(i = 0; i < length; i++){
+        buffer[i + 1] = bytes[i];
+    }
+    return I2C_transfer(ssdBus, ssdAddress, buffer, length + 1, 0, 0);
+}
+
+static uint8_t SSD_i2cCommand(const uint8_t *commands, uint8_t length){
+    return SSD_i2cWrite(0x00, commands, length);
+}
+
+static uint8_t SSD_i2cData(const uint8_t *data, uint8_t length){
+    return SSD_i2cWrite(0x40, data, length);
+}
+
+static uint8_t SSD_i2cPages(uint8_t count, const SSD_Page *pages, uint8_t step){
+    static I2C_Transaction pageTransactions[SSD_MAX_PAGE_NUMBER + 1];
+    I2C_Transaction *transaction;
+    uint8_t status = I2C_STATUS_DONE;
+    uint8_t i;
+
+    for(i = 0; i < count; i++){
+        transaction = &pageTransactions[i];
+        transaction->address = ssdAddress;
+        transaction->txData = &pages[i * step].control;
+        transaction->txLength = sizeof(SSD_Page);
+        transaction->rxData = 0;
+        transaction->rxLength = 0;
+        transaction->callback = 0;
+        transaction->arg = 0;
+        I2C_submit(ssdBus, transaction);
+    }
+    while(pageTransactions[count - 1].status == I2C_STATUS_PENDING){
+        I2C_checkTimeout(ssdBus);
+    }
+    for(i = 0; i < count && status == I2C_STATUS_DONE; i++){
+        status = pageTransactions[i].status;
+    }
+    return status;
+}
+
 /**************************************************************************************
  * SSD1306 send command function
- * To write commands to SSD1306 you need to send a value of 0x80 before each command
+ * Sends a single command byte through the transport
  ***************************************************************************************
 */
 void SSD_command(unsigned char command){
-    uint8_t ptr[2] = {0x80, command};
-    I2C_Write(SSD_ADDRESS, ptr, 2);
+    ssdTransport->command(&command, 1);
 }
 
 /**************************************************************************************
  * SSD1306 initialization Function
- * This function initializes SSD1306
+ * This function initializes SSD1306 at address on the given I2C bus, which is set up
+ * if it is not yet. See SSD_initSsi for a display on SPI, both go on with SSD_start,
+ * which sends the whole command list below at once and clears the screen.
  ***************************************************************************************
 */
 unsigned char ssdInit[26] =
@@ -38,7 +112,7 @@ unsigned char ssdInit[26] =
     SSD_SETCOMPINS,
     0x12,
     SSD_SETCONTRAST,
-    0xCF,
+    SSD_CONTRAST_DEFAULT,
     SSD_SETPRECHARGE,
     0xF1,
     SSD_SETVCOMDETECT,
@@ -50,12 +124,18 @@ unsigned char ssdInit[26] =
 
 };
 
-void SSD_init(void) {
-    setSlaveAddress(SSD_ADDRESS, 0);
-    uint8_t i;
-    for(i = 0; i < 26 ; i++){
-        SSD_command(ssdInit[i]);
-    }
+void SSD_init(I2C0_Type *bus, uint8_t address) {
+    ssdBus = bus;
+    ssdAddress = address;
+    ssdTransport = &ssdI2CTransport;
+    I2C_init(bus);
+    SSD_start();
+}
+
+void SSD_start(void){
+    ssdTransport->command(ssdInit, sizeof(ssdInit));
+    ssdScrolling = 0;
+    ssdAsleep = 0;
     SSD_clearScreen();
     SSD_setPosition(0,0);
 }
@@ -69,27 +149,19 @@ void SSD_init(void) {
 */
 void SSD_setPosition(uint8_t column, uint8_t page) {
     uint8_t sendCommand[6];
-    sendCommand[0] = 0x80;
     //Register Address for Column
-    sendCommand[1] = SSD_COLUMNADDR;
-    sendCommand[2] = 0x80;
+    sendCommand[0] = SSD_COLUMNADDR;
     //Column start
-    sendCommand[3] = column;
-    sendCommand[4] = 0x80;
+    sendCommand[1] = column;
     //Column End
-    sendCommand[5] = SSD_LCDWIDTH-1;
-
-    I2C_Write(SSD_ADDRESS, sendCommand, 6);
-    sendCommand[0] = 0x80;
+    sendCommand[2] = SSD_LCDWIDTH-1;
     //Register Address for Page
-    sendCommand[1] = SSD_PAGEADDR;
-    sendCommand[2] = 0x80;
+    sendCommand[3] = SSD_PAGEADDR;
     //Page start
-    sendCommand[3] = page;
-    sendCommand[4] = 0x80;
+    sendCommand[4] = page;
     //Page end
     sendCommand[5] = 7;
-    I2C_Write(SSD_ADDRESS, sendCommand, 6);
+    ssdTransport->command(sendCommand, 6);
 }
 
 /**************************************************************************************
@@ -100,52 +172,204 @@ void SSD_setPosition(uint8_t column, uint8_t page) {
  ***************************************************************************************
 */
 void SSD_printText_6x8(uint8_t x, uint8_t y, char *strPtr) {
-    uint8_t dataBuffer[8];
+    uint8_t dataBuffer[7];
+    if(SSD_RAM_LOCKED()){
+        return;
+    }
     SSD_setPosition(x, y);
     while (*strPtr) {
-        //0x40 command is what tells the SSD you are writing to the screen
-        dataBuffer[0] = 0x40;
         uint8_t i;
         for(i = 0; i< 6; i++) {
-            dataBuffer[i+1] = font_6x8[((*strPtr - ' ')*6)+i];
-        }
-        dataBuffer[7] = 0x0; //Prints space after letter
-        setSlaveAddress(SSD_ADDRESS, 0);
-
-        /*
-         * This loop writes the dataBuffer array to each bit in the current segment
-         * Cases to watch out for are start and stop (i == 7 and i == 0), in which
-         * you need to write specific start and stop commands to.
-         */
-        for(int i = 0 ; i < 8 ; i++){
-            if(i == 7){
-                writeByte(dataBuffer[i],(1<<0)|(1<<2));
-            } else if(i == 0){
-                writeByte(dataBuffer[i],(1<<0)|(1<<1));
-            } else {
-                writeByte(dataBuffer[i],(1<<0));
-            }
+            dataBuffer[i] = font_6x8[((*strPtr - ' ')*6)+i];
         }
+        dataBuffer[6] = 0x0; //Prints space after letter
+
+        //The 7 columns of the character go out as one write
+        ssdTransport->data(dataBuffer, 7);
         strPtr++;
         x+=7;
     }
 }
 
+/**************************************************************************************
+ * SSD1306 Render Text Function
+ * Draws a string like SSD_printText_6x8 but into a page in RAM, to be sent later by
+ * SSD_writePages. Characters past the right edge are cut off.
+ ***************************************************************************************
+*/
+void SSD_renderText_6x8(SSD_Page *page, uint8_t x, const char *strPtr){
+    uint8_t i;
+
+    while(*strPtr && x + 7 <= SSD_LCDWIDTH){
+        for(i = 0; i < 6; i++){
+            page->columns[x + i] = font_6x8[((*strPtr - ' ')*6)+i];
+        }
+        page->columns[x + 6] = 0x0;
+        strPtr++;
+        x += 7;
+    }
+}
+
+/**************************************************************************************
+ * SSD Write Pages Functions
+ * Write whole pages starting at firstPage. With the horizontal addressing mode set
+ * in SSD_init the column pointer wraps to the next page by itself, so the pages only
+ * need to be addressed once, the transport then sends them one after the other.
+ * SSD_writePages sends count consecutive pages, SSD_fillPages the same page count
+ * times. Both return the first failed status or I2C_STATUS_DONE.
+ ***************************************************************************************
+*/
+static uint8_t SSD_queuePages(uint8_t firstPage, uint8_t count, const SSD_Page *pages, uint8_t step){
+    if(count == 0 || firstPage + count > SSD_MAX_PAGE_NUMBER + 1 || SSD_RAM_LOCKED()){
+        return I2C_STATUS_ERROR;
+    }
+    SSD_setPosition(0, firstPage);
+    return ssdTransport->pages(count, pages, step);
+}
+
+uint8_t SSD_writePages(uint8_t firstPage, uint8_t count, const SSD_Page *pages){
+    return SSD_queuePages(firstPage, count, pages, 1);
+}
+
+uint8_t SSD_fillPages(uint8_t firstPage, uint8_t count, const SSD_Page *page){
+    return SSD_queuePages(firstPage, count, page, 0);
+}
+
+/**************************************************************************************
+ * SSD Write Columns Function
+ * Writes a run of columns of one page, starting at column. Runs longer than the
+ * transport takes at once go out in pieces, the column pointer carries on between
+ * them. SSD_writeCost is what such a write puts on the bus after the address: the
+ * position commands, the columns and over I2C the control byte of each write.
+ ***************************************************************************************
+*/
+uint8_t SSD_writeColumns(uint8_t column, uint8_t page, const uint8_t *columns, uint8_t length){
+    uint8_t status = I2C_STATUS_DONE;
+    uint8_t chunk;
+
+    if(length == 0 || column + length > SSD_LCDWIDTH || page > SSD_MAX_PAGE_NUMBER || SSD_RAM_LOCKED()){
+        return I2C_STATUS_ERROR;
+    }
+    SSD_setPosition(column, page);
+    while(length > 0 && status == I2C_STATUS_DONE){
+        chunk = (length > SSD_MAX_TRANSFER) ? SSD_MAX_TRANSFER : length;
+        status = ssdTransport->data(columns, chunk);
+        columns += chunk;
+        length -= chunk;
+    }
+    return status;
+}
+
+uint16_t SSD_writeCost(uint8_t length){
+    uint16_t cost = 6 + length;
+
+    if(ssdTransport == &ssdI2CTransport){
+        cost += 1 + (length + SSD_MAX_TRANSFER - 1) / SSD_MAX_TRANSFER;
+    }
+    return cost;
+}
+
 /**************************************************************************************
  * SSD Clear Screen Function
- * This function scrolls through the screen and clears it one row at a time
+ * This function clears the screen by filling all pages with a blank page
  ***************************************************************************************
 */
 void SSD_clearScreen(void){
-    uint8_t i = 0, j = 0;
-    setSlaveAddress(SSD_ADDRESS, 0);
-    for(j = 0; j <= SSD_MAX_PAGE_NUMBER; j++){
-        SSD_setPosition(0, j);
-        writeByte(0x40, (1<<0)|(1<<1));
-        for(i = 0; i <= SSD_MAX_COLUMN_NUMBER ; i++){
-            writeByte(0x00, (1<<0));
-        }
-        writeByte(0x00, (1<<0)|(1<<2));
+    static const SSD_Page blankPage = {0x40, {0}};
+    SSD_fillPages(0, SSD_MAX_PAGE_NUMBER + 1, &blankPage);
+}
+
+
+/**************************************************************************************
+ * SSD Flush Time Function
+ * Times a write of the whole screen (all 8 pages, the same traffic as a full frame
+ * update) over the transport and at the current speed of the display, and keeps it
+ * with the transport. The screen is left cleared.
+ ***************************************************************************************
+*/
+uint32_t SSD_flushTimeUs(void){
+    uint32_t start = BSP_CYCLES();
+    SSD_clearScreen();
+    ssdTransport->flushUs = (BSP_CYCLES() - start) / (SYS_CLOCK_HZ / 1000000U);
+    return ssdTransport->flushUs;
+}
+
+/**************************************************************************************
+ * SSD Scroll Functions
+ * Run the scroll engine of the SSD1306 on pages firstPage to lastPage, one step
+ * every interval (SSD_SCROLL_x_FRAMES), until SSD_scrollStop. SSD_scrollHorizontal
+ * shifts the pages by one column a step, the column pushed out comes back in on the
+ * other side. The controller does the shifting, so scrolling costs no bus traffic
+ * after the setup, but the display RAM must not be written while it runs:
+ * SSD_printText_6x8, SSD_writePages, SSD_fillPages and SSD_writeColumns do nothing
+ * while ssdScrolling is set. The datasheet also has the RAM rewritten after a
+ * horizontal scroll is stopped, the owner of the scrolled pages has to redraw them.
+ * All return the status of the command write.
+ ***************************************************************************************
+*/
+static uint8_t SSD_scrollStart(const uint8_t *setup, uint8_t length){
+    uint8_t commands[9];
+    uint8_t status;
+    uint8_t i;
+
+    //Scroll parameters may only be changed while it is stopped
+    commands[0] = SSD_DEACTIVATE_SCROLL;
+    for(i = 0; i < length; i++){
+        commands[i + 1] = setup[i];
+    }
+    commands[length + 1] = SSD_ACTIVATE_SCROLL;
+    status = ssdTransport->command(commands, length + 2);
+    ssdScrolling = (status == I2C_STATUS_DONE);
+    return status;
+}
+
+uint8_t SSD_scrollHorizontal(uint8_t direction, uint8_t firstPage, uint8_t lastPage, uint8_t interval){
+    uint8_t setup[7];
+
+    if(firstPage > lastPage || lastPage > SSD_MAX_PAGE_NUMBER || interval > SSD_SCROLL_2_FRAMES){
+        return I2C_STATUS_ERROR;
+    }
+    setup[0] = (direction == SSD_SCROLL_LEFT) ? SSD_LEFT_HORIZONTAL_SCROLL : SSD_RIGHT_HORIZONTAL_SCROLL;
+    setup[1] = 0x00;            //dummy
+    setup[2] = firstPage;
+    setup[3] = interval;
+    setup[4] = lastPage;
+    setup[5] = 0x00;            //dummy
+    setup[6] = 0xFF;            //dummy
+    return SSD_scrollStart(setup, sizeof(setup));
+}
+
+uint8_t SSD_scrollStop(void){
+    uint8_t command = SSD_DEACTIVATE_SCROLL;
+    uint8_t status = ssdTransport->command(&command, 1);
+
+    if(status == I2C_STATUS_DONE){
+        ssdScrolling = 0;
     }
+    return status;
+}
+
+/**************************************************************************************
+ * SSD Power Functions
+ * SSD_setContrast sets the segment current, 0 to 255, the display starts at
+ * SSD_CONTRAST_DEFAULT. SSD_setDisplayOn(0) turns the panel off (SSD_DISPLAYOFF), the
+ * display RAM keeps its content but is not written until it is turned on again,
+ * SSD_printText_6x8, SSD_writePages, SSD_fillPages and SSD_writeColumns send nothing
+ * meanwhile. What was drawn before is shown again on SSD_DISPLAYON.
+ ***************************************************************************************
+*/
+uint8_t SSD_setContrast(uint8_t contrast){
+    uint8_t commands[2] = {SSD_SETCONTRAST, contrast};
+
+    return ssdTransport->command(commands, sizeof(commands));
 }
 
+uint8_t SSD_setDisplayOn(uint8_t on){
+    uint8_t command = on ? SSD_DISPLAYON : SSD_DISPLAYOFF;
+    uint8_t status = ssdTransport->command(&command, 1);
+
+    if(status == I2C_STATUS_DONE){
+        ssdAsleep = !on;
+    }
+    return status;
+}
@@ -3,17 +3,84 @@
 
 #include "BSP\bsp.h"
 #include "I2C\i2c.h"
+#include "SSI\ssi.h"
+
+//One page (8 pixel rows) as it is sent: the 0x40 data control byte then the columns
+typedef struct
+{
+    uint8_t control;
+    uint8_t columns[128];           //SSD_LCDWIDTH
+} SSD_Page;
+
+/*
+ * The drawing functions below only send commands, short data and whole pages
+ * through ssdTransport, which SSD_init sets to I2C and SSD_initSsi to SPI. Over I2C
+ * every write starts with a control byte (0x00 commands, 0x40 data), over SPI the
+ * D/C pin tells them apart and the control byte of an SSD_Page is skipped. Both
+ * return the status codes of i2c.h, SPI I2C_STATUS_DONE unless a uDMA page timed
+ * out (I2C_STATUS_TIMEOUT, the pages are polled after that). flushUs is the last
+ * full frame timed by SSD_flushTimeUs over the transport.
+ */
+typedef struct
+{
+    const char  *name;
+    uint8_t     (*command)(const uint8_t *commands, uint8_t length);
+    uint8_t     (*data)(const uint8_t *data, uint8_t length);
+    uint8_t     (*pages)(uint8_t count, const SSD_Page *pages, uint8_t step);
+    uint32_t    flushUs;
+} SSD_Transport;
+
+extern SSD_Transport ssdI2CTransport;
+extern SSD_Transport ssdSsiTransport;
+extern SSD_Transport *ssdTransport;
+
+//Longest command list or data run SSD_Transport.command and .data take at once
+#define SSD_MAX_TRANSFER            32
+
+/*
+ * SPI wiring: SCK, MOSI and CS (the FSS pin) of the SSI module, D/C and RES on
+ * SSD_SSI_PORT. The clock is the fastest the module makes up to the 10 MHz of the
+ * SSD1306 (8 MHz). The uDMA can only feed SSI2, which has the pins of SSD_SSI_PORT.
+ */
+#define SSD_SSI_HZ                  10000000U
+#define SSD_SSI_PORT                GPIOB
+#define SSD_SSI_PORT_BIT            1           //bit in RCGCGPIO
+#define SSD_SSI_DC_PIN              1           //PB1, low for commands
+#define SSD_SSI_RES_PIN             0           //PB0, reset, active low
+#define SSD_SSI_RESET_US            10U
 
 void SSD_setPosition(uint8_t column, uint8_t page);
 void SSD_command(unsigned char command);
-void SSD_init(void);
+void SSD_init(I2C0_Type *bus, uint8_t address);
+void SSD_initSsi(SSI0_Type *ssi, uint8_t useDma);
+void SSD_start(void);
 void SSD_clearScreen(void);
 void SSD_printText_6x8(uint8_t x, uint8_t y, char *strPtr);
+void SSD_renderText_6x8(SSD_Page *page, uint8_t x, const char *strPtr);
+uint8_t SSD_writePages(uint8_t firstPage, uint8_t count, const SSD_Page *pages);
+uint8_t SSD_fillPages(uint8_t firstPage, uint8_t count, const SSD_Page *page);
+uint8_t SSD_writeColumns(uint8_t column, uint8_t page, const uint8_t *columns, uint8_t length);
+uint16_t SSD_writeCost(uint8_t length);
+uint32_t SSD_flushTimeUs(void);
+uint8_t SSD_scrollHorizontal(uint8_t direction, uint8_t firstPage, uint8_t lastPage, uint8_t interval);
+uint8_t SSD_scrollStop(void);
+uint8_t SSD_setContrast(uint8_t contrast);
+uint8_t SSD_setDisplayOn(uint8_t on);
+
+//I2C controller and address or SSI module of the display, set by the init functions
+extern I2C0_Type *ssdBus;
+extern uint8_t ssdAddress;
+extern SSI0_Type *ssdSsi;
+extern uint8_t ssdDma;          //SPI pages are sent by the uDMA
+extern uint8_t ssdScrolling;    //the scroll engine runs, display RAM must not be written
+extern uint8_t ssdAsleep;       //the panel is off, display RAM is not written
 
 #define SSD_ADDRESS                 0x3C
+#define SSD_ADDRESS_ALT             0x3D        //D/C# strapped high
 #define SSD_LCDWIDTH                128
 #define SSD_LCDHEIGHT               64
 #define SSD_SETCONTRAST             0x81
+#define SSD_CONTRAST_DEFAULT        0xCF
 #define SSD_DISPLAYALLON_RESUME     0xA4
 #define SSD_DISPLAYALLON            0xA5
 #define SSD_NORMALDISPLAY           0xA6
@@ -38,8 +105,26 @@ void SSD_printText_6x8(uint8_t x, uint8_t y, char *strPtr);
 #define SSD_CHARGEPUMP              0x8D
 #define SSD_EXTERNALVCC             0x1
 #define SSD_SWITCHCAPVCC            0x2
+#define SSD_RIGHT_HORIZONTAL_SCROLL 0x26
+#define SSD_LEFT_HORIZONTAL_SCROLL  0x27
 #define SSD_DEACTIVATE_SCROLL       0x2E
+#define SSD_ACTIVATE_SCROLL         0x2F
+#define SSD_NOP                     0xE3
 #define SSD_MAX_PAGE_NUMBER         7
 #define SSD_MAX_COLUMN_NUMBER       127
 
+//Scroll directions of SSD_scrollHorizontal
+#define SSD_SCROLL_RIGHT            0
+#define SSD_SCROLL_LEFT             1
+
+//Frames between two scroll steps, the interval codes of the scroll setup commands
+#define SSD_SCROLL_2_FRAMES         0x7
+#define SSD_SCROLL_3_FRAMES         0x4
+#define SSD_SCROLL_4_FRAMES         0x5
+#define SSD_SCROLL_5_FRAMES         0x0
+#define SSD_SCROLL_25_FRAMES        0x6
+#define SSD_SCROLL_64_FRAMES        0x1
+#define SSD_SCROLL_128_FRAMES       0x2
+#define SSD_SCROLL_256_FRAMES       0x3
+
 #endif /* SD1306_I2C_TIVAC_H_ */
@@ -0,0 +1,152 @@
+// SPI transport of the SSD1306 driver, see SSD1306_I2C_TivaC.h
+// 4-wire SPI: SCK, MOSI, CS and D/C, the display has no data out
+
+#include "SSD1306_I2C_TivaC.h"
+#include "DMA\udma.h"
+
+//TX DMA enable bit of SSIDMACTL
+#define SSD_SSI_TXDMAE      (1U<<1)
+
+//A uDMA page is given up after twice its time on the bus plus this
+#define SSD_SSI_DMA_MARGIN_US   100U
+
+SSI0_Type *ssdSsi = SSI2;
+uint8_t ssdDma;
+
+static uint8_t SSD_ssiCommand(const uint8_t *commands, uint8_t length);
+static uint8_t SSD_ssiData(const uint8_t *data, uint8_t length);
+static uint8_t SSD_ssiPages(uint8_t count, const SSD_Page *pages, uint8_t step);
+
+SSD_Transport ssdSsiTransport = {.name = "SPI", .command = SSD_ssiCommand, .data = SSD_ssiData, .pages = SSD_ssiPages};
+
+/**************************************************************************************
+ * SSD1306 SPI Write Function
+ * Sends bytes with D/C low (commands) or high (display data) while the display is
+ * selected. D/C is sampled with the last bit of each byte, so it is only changed
+ * while CS is high.
+ ***************************************************************************************
+*/
+static void SSD_ssiWrite(uint8_t isData, const uint8_t *bytes, uint16_t length){
+    uint8_t dc = 1 << SSD_SSI_DC_PIN;
+
+    SSD_SSI_PORT->DATA_Bits[dc] = isData ? dc : 0;
+    SSI_select(ssdSsi, 1);
+    SSI_transfer(ssdSsi, bytes, 0, length);
+    SSI_select(ssdSsi, 0);
+}
+
+static uint8_t SSD_ssiCommand(const uint8_t *commands, uint8_t length){
+    SSD_ssiWrite(0, commands, length);
+    return I2C_STATUS_DONE;
+}
+
+static uint8_t SSD_ssiData(const uint8_t *data, uint8_t length){
+    SSD_ssiWrite(1, data, length);
+    return I2C_STATUS_DONE;
+}
+
+/**************************************************************************************
+ * SSD1306 SPI uDMA Send Function
+ * Hands one page of columns to the uDMA, which feeds the transmit FIFO of SSI2 as it
+ * empties, and sleeps until it is done (the completion comes in on the SSI2
+ * interrupt). The last bytes are still in the FIFO then, SSI_select waits for them
+ * before releasing the display. A uDMA bus error never brings the descriptor back to
+ * stop, so the wait is bounded (SysTick wakes the CPU up to check): past the deadline
+ * the channel is disabled and I2C_STATUS_TIMEOUT returned.
+ ***************************************************************************************
+*/
+static uint8_t SSD_ssiDmaSend(const uint8_t *bytes, uint16_t length){
+    UDMA_Descriptor *descriptor = UDMA_primary(UDMA_CH_SSI2_TX);
+    uint32_t busUs = (uint32_t)(((uint64_t)length * 8U * 1000000U) / SSI_clockHz(ssdSsi));
+    uint64_t deadline = BSP_timestampUs() + 2U * busUs + SSD_SSI_DMA_MARGIN_US;
+
+    descriptor->srcEnd = &bytes[length - 1];
+    descriptor->dstEnd = &ssdSsi->DR;
+    descriptor->control = UDMA_DSTINC_NONE | UDMA_DSTSIZE_8 | UDMA_SRCINC_8 | UDMA_SRCSIZE_8 |
+                          UDMA_ARBSIZE_4 | UDMA_XFERSIZE(length) | UDMA_MODE_BASIC;
+    UDMA_enable(UDMA_CH_SSI2_TX, 0);
+
+    while((descriptor->control & UDMA_MODE_MASK) != UDMA_MODE_STOP){
+        if(BSP_timestampUs() > deadline){
+            UDMA->ENACLR = (1U << UDMA_CH_SSI2_TX);
+            return I2C_STATUS_TIMEOUT;
+        }
+        __disable_irq();
+        if((descriptor->control & UDMA_MODE_MASK) != UDMA_MODE_STOP){
+            __WFI();
+        }
+        __enable_irq();
+    }
+    return I2C_STATUS_DONE;
+}
+
+void SSI2_IRQHandler(void){
+    if(UDMA->CHIS & (1U << UDMA_CH_SSI2_TX)){
+        UDMA->CHIS = (1U << UDMA_CH_SSI2_TX);
+    }
+}
+
+/**************************************************************************************
+ * SSD1306 SPI Pages Function
+ * Sends the 128 columns of each page, without the I2C control byte, by uDMA or by
+ * polling the FIFO. The display stays selected over all pages, a full frame is
+ * 1 KB, about 1 ms at 8 MHz. If the uDMA does not finish a page, the pages are
+ * polled from then on. How much of that page the display got is not known, so the
+ * rest is not sent and I2C_STATUS_TIMEOUT returned for the caller to redraw.
+ ***************************************************************************************
+*/
+static uint8_t SSD_ssiPages(uint8_t count, const SSD_Page *pages, uint8_t step){
+    uint8_t dc = 1 << SSD_SSI_DC_PIN;
+    uint8_t status = I2C_STATUS_DONE;
+    uint8_t i;
+
+    SSD_SSI_PORT->DATA_Bits[dc] = dc;
+    SSI_select(ssdSsi, 1);
+    for(i = 0; i < count && status == I2C_STATUS_DONE; i++){
+        if(ssdDma){
+            status = SSD_ssiDmaSend(pages[i * step].columns, SSD_LCDWIDTH);
+            if(status != I2C_STATUS_DONE){
+                ssdDma = 0;
+            }
+        } else {
+            SSI_transfer(ssdSsi, pages[i * step].columns, 0, SSD_LCDWIDTH);
+        }
+    }
+    SSI_select(ssdSsi, 0);
+    return status;
+}
+
+/**************************************************************************************
+ * SSD1306 SPI initialization Function
+ * Sets up the SSI module in mode 0 with D/C and RES as outputs, resets the display
+ * and initializes it like SSD_init. useDma has the pages sent by the uDMA, which only
+ * works on SSI2. A display on SPI cannot be read back, so whether it is there cannot
+ * be told.
+ ***************************************************************************************
+*/
+void SSD_initSsi(SSI0_Type *ssi, uint8_t useDma){
+    uint8_t dc = 1 << SSD_SSI_DC_PIN;
+    uint8_t res = 1 << SSD_SSI_RES_PIN;
+
+    ssdSsi = ssi;
+    ssdDma = useDma && (ssi == SSI2);
+    ssdTransport = &ssdSsiTransport;
+
+    SYSCTL->RCGCGPIO |= (1U << SSD_SSI_PORT_BIT);
+    SSI_init(ssi, SSD_SSI_HZ, SSI_MODE_0);
+    SSD_SSI_PORT->DATA_Bits[dc | res] = 0;
+    SSD_SSI_PORT->AFSEL &= ~(dc | res);
+    SSD_SSI_PORT->DIR |= dc | res;
+    SSD_SSI_PORT->DEN |= dc | res;
+    BSP_delayUs(SSD_SSI_RESET_US);
+    SSD_SSI_PORT->DATA_Bits[res] = res;
+    BSP_delayUs(SSD_SSI_RESET_US);
+
+    if(ssdDma){
+        UDMA_init();
+        UDMA_assign(UDMA_CH_SSI2_TX, UDMA_ENC_SSI2_TX);
+        ssi->DMACTL = SSD_SSI_TXDMAE;
+        NVIC_EnableIRQ(SSI2_IRQn);
+    }
+    SSD_start();
+}
@@ -0,0 +1,286 @@
+/*
+ * SSD1306_graph.c
+ *
+ * Sparkline widget of the SSD1306 driver, see SSD1306_graph.h
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "SSD1306_graph.h"
+
+static int32_t SSD_graphFloor(int32_t value){
+    int32_t rest = value % SSD_GRAPH_SCALE_STEP;
+
+    return (rest < 0) ? value - rest - SSD_GRAPH_SCALE_STEP : value - rest;
+}
+
+static int32_t SSD_graphCeil(int32_t value){
+    return -SSD_graphFloor(-value);
+}
+
+//Sample of the ones shown, index 0 is the oldest
+static int32_t SSD_graphSample(const SSD_Graph *graph, uint8_t index){
+    return graph->samples[(graph->head + graph->width - graph->count + index) % graph->width];
+}
+
+/**************************************************************************************
+ * SSD Graph Initialization Function
+ * Sets up a graph of width samples in pages firstPage to firstPage + pages - 1, at
+ * least 2 pages for the labels. minSpan is the smallest scale, in the 0.01 units of
+ * the samples, unit is printed on the page under the top label when the graph has 3
+ * pages or more. Nothing is drawn until the first sample. Returns 0 if the graph
+ * does not fit.
+ ***************************************************************************************
+*/
+uint8_t SSD_graphInit(SSD_Graph *graph, uint8_t firstPage, uint8_t pages, uint8_t width,
+                      int32_t minSpan, const char *unit){
+    if(pages < 2 || pages > SSD_GRAPH_MAX_PAGES || firstPage + pages > SSD_MAX_PAGE_NUMBER + 1 ||
+       width == 0 || width > SSD_GRAPH_MAX_WIDTH || minSpan < SSD_GRAPH_SCALE_STEP){
+        graph->pages = 0;
+        return 0;
+    }
+    graph->firstPage = firstPage;
+    graph->pages = pages;
+    graph->width = width;
+    graph->minSpan = minSpan;
+    graph->unit = unit;
+    graph->head = 0;
+    graph->count = 0;
+    graph->shownValid = 0;
+    graph->hidden = 0;
+    graph->updates = 0;
+    graph->rescales = 0;
+    graph->lastBytes = 0;
+    graph->fullBytes = pages * SSD_writeCost(width);
+    return 1;
+}
+
+/**************************************************************************************
+ * SSD Graph Scale Function
+ * Works out the scale for the samples shown: their range with a quarter of it as
+ * room on either side, at least minSpan, rounded out to SSD_GRAPH_SCALE_STEP. The
+ * current scale is kept while the samples are inside it and it is no more than
+ * twice that, so a value wandering around does not redraw the band every sample.
+ * Returns 1 if the scale changed.
+ ***************************************************************************************
+*/
+static uint8_t SSD_graphFitScale(SSD_Graph *graph){
+    int32_t lowest = SSD_graphSample(graph, 0);
+    int32_t highest = lowest;
+    int32_t sample;
+    int32_t pad;
+    int32_t low;
+    int32_t high;
+    uint8_t i;
+
+    for(i = 1; i < graph->count; i++){
+        sample = SSD_graphSample(graph, i);
+        if(sample < lowest){
+            lowest = sample;
+        }
+        if(sample > highest){
+            highest = sample;
+        }
+    }
+    pad = (highest - lowest) / 4;
+    if(highest - lowest + 2 * pad < graph->minSpan){
+        pad = (graph->minSpan - (highest - lowest) + 1) / 2;
+    }
+    low = SSD_graphFloor(lowest - pad);
+    high = SSD_graphCeil(highest + pad);
+
+    if(graph->shownValid && lowest >= graph->low && highest <= graph->high &&
+       graph->high - graph->low <= 2 * (high - low)){
+        return 0;
+    }
+    graph->low = low;
+    graph->high = high;
+    return 1;
+}
+
+/**************************************************************************************
+ * SSD Graph Column Function
+ * Draws the sample with the given index into a column of the frame, as a vertical
+ * line from the row of the sample before it so the plot stays connected. Row 0 is
+ * the top of the band, bit 0 of each page byte is its top row.
+ ***************************************************************************************
+*/
+static uint8_t SSD_graphRow(const SSD_Graph *graph, int32_t sample){
+    int32_t rows = graph->pages * 8 - 1;
+    int32_t range = graph->high - graph->low;
+
+    return (uint8_t)(rows - ((sample - graph->low) * rows + range / 2) / range);
+}
+
+static void SSD_graphColumn(SSD_Graph *graph, uint8_t column, uint8_t index){
+    uint8_t top = SSD_graphRow(graph, SSD_graphSample(graph, index));
+    uint8_t bottom = top;
+    uint8_t previous;
+    uint8_t row;
+    uint8_t page;
+
+    if(index > 0){
+        previous = SSD_graphRow(graph, SSD_graphSample(graph, index - 1));
+        if(previous < top){
+            top = previous;
+        } else if(previous > bottom){
+            bottom = previous;
+        }
+    }
+    for(page = 0; page < graph->pages; page++){
+        graph->frame[page][column] = 0;
+    }
+    for(row = top; row <= bottom; row++){
+        graph->frame[row >> 3][column] |= 1 << (row & 7);
+    }
+}
+
+/**************************************************************************************
+ * SSD Graph Send Function
+ * Sends the columns of the frame that differ from what was sent last, all of them
+ * when the display content is not known. Changed columns close together go out as
+ * one run. A run that fails leaves the display content unknown, everything is sent
+ * again next time. Returns the bytes it took.
+ ***************************************************************************************
+*/
+static uint16_t SSD_graphSend(SSD_Graph *graph){
+    uint8_t left = SSD_LCDWIDTH - graph->width;
+    uint16_t bytes = 0;
+    uint8_t sent = 1;
+    uint8_t page;
+    uint8_t start;
+    uint8_t last;
+    uint8_t c;
+
+    for(page = 0; page < graph->pages; page++){
+        c = 0;
+        while(c < graph->width){
+            if(graph->shownValid && graph->frame[page][c] == graph->shown[page][c]){
+                c++;
+                continue;
+            }
+            start = c;
+            last = c;
+            for(c = start + 1; c < graph->width && c - last <= SSD_GRAPH_MERGE_GAP; c++){
+                if(!graph->shownValid || graph->frame[page][c] != graph->shown[page][c]){
+                    last = c;
+                }
+            }
+            if(SSD_writeColumns(left + start, graph->firstPage + page, &graph->frame[page][start],
+                                last - start + 1) == I2C_STATUS_DONE){
+                memcpy(&graph->shown[page][start], &graph->frame[page][start], last - start + 1);
+            } else {
+                sent = 0;
+            }
+            bytes += SSD_writeCost(last - start + 1);
+            c = last + 1;
+        }
+    }
+    graph->shownValid = sent;
+    return bytes;
+}
+
+/**************************************************************************************
+ * SSD Graph Label Function
+ * Prints a scale limit with one decimal, padded to SSD_GRAPH_LABEL_CHARS so it
+ * covers a longer one printed before. Returns the bytes it took.
+ ***************************************************************************************
+*/
+static uint16_t SSD_graphLabel(uint8_t page, int32_t value){
+    char number[12];
+    char text[SSD_GRAPH_LABEL_CHARS + 1];
+    uint32_t tenths = (value < 0) ? -(uint32_t)value / 10U : (uint32_t)value / 10U;
+
+    snprintf(number, sizeof(number), "%s%lu.%lu", (value < 0) ? "-" : "", (unsigned long)(tenths / 10U),
+             (unsigned long)(tenths % 10U));
+    snprintf(text, sizeof(text), "%-*.*s", SSD_GRAPH_LABEL_CHARS, SSD_GRAPH_LABEL_CHARS, number);
+    SSD_printText_6x8(0, page, text);
+    return SSD_writeCost(0) + SSD_GRAPH_LABEL_CHARS * (SSD_writeCost(7) - SSD_writeCost(0));
+}
+
+/**************************************************************************************
+ * SSD Graph Redraw Function
+ * Draws the whole band again and resends it with the labels, for a new scale or
+ * after something else has drawn over it (a cleared screen). The scale is fitted
+ * to the samples from scratch.
+ ***************************************************************************************
+*/
+void SSD_graphRedraw(SSD_Graph *graph){
+    char unit[SSD_GRAPH_LABEL_CHARS + 1];
+    uint8_t page;
+    uint8_t i;
+
+    if(graph->pages == 0 || graph->hidden){
+        return;
+    }
+    graph->shownValid = 0;
+    if(graph->count > 0){
+        SSD_graphFitScale(graph);
+    }
+    for(page = 0; page < graph->pages; page++){
+        memset(graph->frame[page], 0, graph->width);
+    }
+    for(i = 0; i < graph->count; i++){
+        SSD_graphColumn(graph, graph->width - graph->count + i, i);
+    }
+    graph->shownValid = 0;
+    graph->lastBytes = SSD_graphSend(graph);
+    if(graph->count > 0){
+        graph->lastBytes += SSD_graphLabel(graph->firstPage, graph->high);
+        graph->lastBytes += SSD_graphLabel(graph->firstPage + graph->pages - 1, graph->low);
+    }
+    //Padded like the labels, so a shorter unit covers a longer one ("C" after "%rH")
+    if(graph->pages > 2 && graph->unit != 0){
+        snprintf(unit, sizeof(unit), "%-*.*s", SSD_GRAPH_LABEL_CHARS, SSD_GRAPH_LABEL_CHARS, graph->unit);
+        SSD_printText_6x8(0, graph->firstPage + 1, unit);
+    }
+}
+
+/**************************************************************************************
+ * SSD Graph Add Function
+ * Adds a sample in 0.01 units and updates the display. On the same scale the frame
+ * is shifted one column to the left and the new sample drawn into the last column,
+ * and only what changed is sent. A new scale redraws everything.
+ ***************************************************************************************
+*/
+void SSD_graphAdd(SSD_Graph *graph, int32_t sample){
+    uint8_t page;
+
+    if(graph->pages == 0){
+        return;
+    }
+    graph->samples[graph->head] = sample;
+    graph->head = (graph->head + 1 < graph->width) ? graph->head + 1 : 0;
+    if(graph->count < graph->width){
+        graph->count++;
+    }
+    graph->updates++;
+    if(graph->hidden){
+        return;
+    }
+
+    if(SSD_graphFitScale(graph)){
+        graph->rescales++;
+        SSD_graphRedraw(graph);
+        return;
+    }
+    for(page = 0; page < graph->pages; page++){
+        memmove(graph->frame[page], &graph->frame[page][1], graph->width - 1);
+    }
+    SSD_graphColumn(graph, graph->width - 1, graph->count - 1);
+    graph->lastBytes = SSD_graphSend(graph);
+}
+
+/**************************************************************************************
+ * SSD Graph Show Function
+ * Hides the graph while another view uses its pages, or shows it again, which
+ * redraws it with the samples that came in meanwhile
+ ***************************************************************************************
+*/
+void SSD_graphShow(SSD_Graph *graph, uint8_t visible){
+    graph->hidden = !visible;
+    graph->shownValid = 0;
+    if(visible){
+        SSD_graphRedraw(graph);
+    }
+}
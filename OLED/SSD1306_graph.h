@@ -0,0 +1,69 @@
+/*
+ * SSD1306_graph.h
+ *
+ * Sparkline of the last samples of a value in a band of whole pages of the SSD1306.
+ * The plot takes the right of the band, one column per sample with the newest on
+ * the right, the top and bottom of its y scale are printed to its left. The SSD1306
+ * cannot be read back or shifted sideways by one column, so the graph keeps the
+ * band in RAM twice: as it should look and as it was last sent. A new sample shifts
+ * the columns in RAM and draws one new column, then only the columns that came out
+ * different from what the display shows are sent. A slowly changing value draws
+ * mostly flat runs, which look the same shifted, so an update costs a few short runs
+ * instead of the whole band. The scale follows the samples shown, it is only changed
+ * when a sample leaves it or they shrink to a small part of it, as that redraws the
+ * whole band. A hidden graph (SSD_graphShow) keeps taking samples but draws nothing
+ * until it is shown again.
+ */
+
+#ifndef SSD1306_GRAPH_H_
+#define SSD1306_GRAPH_H_
+
+#include <stdint.h>
+#include "SSD1306_I2C_TivaC.h"
+
+#define SSD_GRAPH_MAX_PAGES     6
+#define SSD_GRAPH_LABEL_CHARS   5                                   //"-12.3", "100.0"
+#define SSD_GRAPH_LABEL_WIDTH   (SSD_GRAPH_LABEL_CHARS * 7)         //7 columns a character
+#define SSD_GRAPH_COLUMN        SSD_GRAPH_LABEL_WIDTH               //first column of the plot
+#define SSD_GRAPH_MAX_WIDTH     (SSD_LCDWIDTH - SSD_GRAPH_COLUMN)
+
+/*
+ * Unchanged columns shorter than this between two changed ones are sent along,
+ * addressing a new run costs about as much (6 command bytes and the control bytes)
+ */
+#define SSD_GRAPH_MERGE_GAP     8
+
+//Scale limits are rounded to this, in the 0.01 units of the samples, so the labels show one decimal
+#define SSD_GRAPH_SCALE_STEP    10
+
+typedef struct
+{
+    uint8_t     firstPage;
+    uint8_t     pages;
+    uint8_t     width;                                      //samples shown, one column each
+    int32_t     minSpan;                                    //smallest scale, keeps noise from filling the plot
+    const char  *unit;                                      //printed between the labels when there is room
+
+    int32_t     samples[SSD_GRAPH_MAX_WIDTH];               //ring, oldest at head once full
+    uint8_t     head;
+    uint8_t     count;
+    int32_t     low;                                        //scale of the plot and the labels
+    int32_t     high;
+    uint8_t     frame[SSD_GRAPH_MAX_PAGES][SSD_GRAPH_MAX_WIDTH];   //plot as it should look
+    uint8_t     shown[SSD_GRAPH_MAX_PAGES][SSD_GRAPH_MAX_WIDTH];   //plot as it was sent
+    uint8_t     shownValid;                                 //shown matches the display
+    uint8_t     hidden;                                     //something else is on the display
+
+    uint32_t    updates;
+    uint32_t    rescales;                                   //updates that redrew the whole band
+    uint16_t    lastBytes;                                  //bytes sent by the last update
+    uint16_t    fullBytes;                                  //bytes a redraw of the plot costs
+} SSD_Graph;
+
+uint8_t SSD_graphInit(SSD_Graph *graph, uint8_t firstPage, uint8_t pages, uint8_t width,
+                      int32_t minSpan, const char *unit);
+void    SSD_graphAdd(SSD_Graph *graph, int32_t sample);
+void    SSD_graphRedraw(SSD_Graph *graph);
+void    SSD_graphShow(SSD_Graph *graph, uint8_t visible);
+
+#endif /* SSD1306_GRAPH_H_ */
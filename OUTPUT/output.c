@@ -0,0 +1,203 @@
+/*
+ * output.c
+ *
+ * Message pool, per sink queues and formatting of readings. See output.h
+ */
+
+#include <stdio.h>
+#include "output.h"
+#include "BSP\bsp.h"
+
+OUT_Stats outStats;
+
+static OUT_Message  outPool[OUT_POOL_SIZE];
+static OUT_Sink     *outSinks[OUT_MAX_SINKS];
+static uint8_t      outNumSinks;
+static uint32_t     outSequence;
+
+/**************************************************************************************
+ * Format Value Function
+ * Formats a value in hundredths with 2 decimals, right aligned to 6 characters so a
+ * shorter value fully overwrites a longer one on the OLED, e.g. " 23.45" or " -0.05"
+ ***************************************************************************************
+*/
+void OUT_formatValue(char *dst, int32_t hundredths){
+    char digits[OUT_VALUE_SIZE];
+    uint32_t magnitude = (hundredths < 0) ? -(uint32_t)hundredths : (uint32_t)hundredths;
+
+    snprintf(digits, sizeof(digits), "%s%lu.%02lu", (hundredths < 0) ? "-" : "",
+             (unsigned long)(magnitude / 100), (unsigned long)(magnitude % 100));
+    snprintf(dst, OUT_VALUE_SIZE, "%6s", digits);
+}
+
+//Skips the alignment spaces of a formatted value for use inside text lines
+static const char *OUT_trim(const char *value){
+    while(*value == ' '){
+        value++;
+    }
+    return value;
+}
+
+/**************************************************************************************
+ * Format Message Function
+ * Does all the formatting for a reading: the three values for the OLED and the text
+ * lines for the PC and the phone
+ ***************************************************************************************
+*/
+static void OUT_format(OUT_Message *message, uint32_t timestamp, const TELEM_Sample *sample){
+    int32_t fahrenheit = (sample->temperature * 9) / 5 + 3200;
+    int length;
+
+    message->sequence = outSequence++;
+    message->timestamp = timestamp;
+    message->publishedUs = BSP_timestampUs();
+    message->sample = *sample;
+    OUT_formatValue(message->tempC, sample->temperature);
+    OUT_formatValue(message->tempF, fahrenheit);
+    OUT_formatValue(message->humidity, sample->humidity);
+
+    length = snprintf(message->pcLine, OUT_LINE_SIZE, "Temperature(C): %s     Temperature(F): %s\n",
+                      OUT_trim(message->tempC), OUT_trim(message->tempF));
+    message->pcLength = (length < OUT_LINE_SIZE) ? length : OUT_LINE_SIZE - 1;
+
+    length = snprintf(message->phoneLine, OUT_LINE_SIZE, "Temp: %s(C) -> %s(F)         Humidity: %s %%rH\n",
+                      OUT_trim(message->tempC), OUT_trim(message->tempF), OUT_trim(message->humidity));
+    message->phoneLength = (length < OUT_LINE_SIZE) ? length : OUT_LINE_SIZE - 1;
+}
+
+void OUT_init(void){
+    uint8_t i;
+    for(i = 0; i < OUT_POOL_SIZE; i++){
+        outPool[i].refCount = 0;
+    }
+    outNumSinks = 0;
+}
+
+/**************************************************************************************
+ * Register Sink Function
+ * Adds a sink to the fan-out list. Returns 0 if there is no room for another sink.
+ ***************************************************************************************
+*/
+uint8_t OUT_registerSink(OUT_Sink *sink, const char *name, OUT_Drain drain){
+    if(outNumSinks >= OUT_MAX_SINKS){
+        return 0;
+    }
+    sink->name = name;
+    sink->drain = drain;
+    sink->progress = 0;
+    sink->head = 0;
+    sink->tail = 0;
+    sink->backlog = 0;
+    sink->delivered = 0;
+    sink->dropped = 0;
+    sink->maxBacklog = 0;
+    outSinks[outNumSinks++] = sink;
+    return 1;
+}
+
+/**************************************************************************************
+ * Publish Function
+ * Formats the reading into a free message and queues a reference to it on every
+ * sink. A sink whose queue is full skips this message and counts a drop, the other
+ * sinks are not held back by it. Returns 0 if no message was free.
+ ***************************************************************************************
+*/
+uint8_t OUT_publish(uint32_t timestamp, const TELEM_Sample *sample){
+    OUT_Message *message = 0;
+    OUT_Sink *sink;
+    uint8_t i;
+
+    for(i = 0; i < OUT_POOL_SIZE && message == 0; i++){
+        if(outPool[i].refCount == 0){
+            message = &outPool[i];
+        }
+    }
+    if(message == 0){
+        outStats.poolEmpty++;
+        return 0;
+    }
+
+    OUT_format(message, timestamp, sample);
+    outStats.published++;
+
+    for(i = 0; i < outNumSinks; i++){
+        sink = outSinks[i];
+        if(sink->backlog >= OUT_QUEUE_SIZE){
+            sink->dropped++;
+            continue;
+        }
+        sink->queue[sink->head] = message;
+        sink->head = (sink->head + 1) % OUT_QUEUE_SIZE;
+        sink->backlog++;
+        if(sink->backlog > sink->maxBacklog){
+            sink->maxBacklog = sink->backlog;
+        }
+        message->refCount++;
+    }
+    return 1;
+}
+
+/**************************************************************************************
+ * Track Done Function
+ * Called when the last sink released a message, keeps the fan-out time and the
+ * sample-to-output latency of the reading
+ ***************************************************************************************
+*/
+static void OUT_trackDone(const OUT_Message *message){
+    uint64_t now = BSP_timestampUs();
+
+    outStats.fanOutUs = (uint32_t)(now - message->publishedUs);
+    if(outStats.fanOutUs > outStats.maxFanOutUs){
+        outStats.maxFanOutUs = outStats.fanOutUs;
+    }
+    outStats.latencyUs = (uint32_t)(now - message->sample.conversionUs);
+    if(outStats.latencyUs > outStats.maxLatencyUs){
+        outStats.maxLatencyUs = outStats.latencyUs;
+    }
+}
+
+/**************************************************************************************
+ * Drain Sink Function
+ * Gives one sink one go at the message at the head of its queue and releases the
+ * message once the sink has finished with it. Returns 1 if the sink still has work
+ * queued, so the caller knows to come back.
+ ***************************************************************************************
+*/
+uint8_t OUT_drainSink(OUT_Sink *sink){
+    OUT_Message *message;
+
+    if(sink->backlog == 0){
+        return 0;
+    }
+    message = (OUT_Message *)sink->queue[sink->tail];
+    if(sink->drain(sink, message)){
+        sink->tail = (sink->tail + 1) % OUT_QUEUE_SIZE;
+        sink->backlog--;
+        sink->progress = 0;
+        sink->delivered++;
+        if(--message->refCount == 0){
+            OUT_trackDone(message);
+        }
+    }
+    return sink->backlog != 0;
+}
+
+/**************************************************************************************
+ * Poll Function
+ * Drains a little of every sink, for callers that do not drain sinks one by one
+ ***************************************************************************************
+*/
+void OUT_poll(void){
+    uint8_t i;
+    for(i = 0; i < outNumSinks; i++){
+        OUT_drainSink(outSinks[i]);
+    }
+}
+
+uint8_t OUT_numSinks(void){
+    return outNumSinks;
+}
+
+OUT_Sink *OUT_getSink(uint8_t index){
+    return (index < outNumSinks) ? outSinks[index] : 0;
+}
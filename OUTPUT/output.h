@@ -0,0 +1,92 @@
+/*
+ * output.h
+ *
+ * Format-once, fan-out output stage. A reading is formatted a single time into a
+ * message taken from a small pool, then every registered sink gets a reference
+ * to it in its own queue. Sinks drain their queue from OUT_poll at their own
+ * pace, a little work per call, and the message goes back to the pool once the
+ * last sink is done with it. Messages are never changed after OUT_publish.
+ *
+ * Everything here runs from the main loop, nothing is called from interrupts.
+ */
+
+#ifndef OUTPUT_H_
+#define OUTPUT_H_
+
+#include <stdint.h>
+#include "TELEMETRY\telemetry_protocol.h"
+
+#define OUT_POOL_SIZE           4
+#define OUT_QUEUE_SIZE          4
+#define OUT_MAX_SINKS           4
+#define OUT_VALUE_SIZE          8
+#define OUT_LINE_SIZE           64
+
+typedef struct
+{
+    uint8_t         refCount;
+    uint32_t        sequence;
+    uint32_t        timestamp;
+    uint64_t        publishedUs;                    //when OUT_publish ran, for the fan-out time
+    TELEM_Sample    sample;
+    char            tempC[OUT_VALUE_SIZE];          //right aligned, 6 characters
+    char            tempF[OUT_VALUE_SIZE];
+    char            humidity[OUT_VALUE_SIZE];
+    char            pcLine[OUT_LINE_SIZE];          //ASCII line for the PC
+    uint8_t         pcLength;
+    char            phoneLine[OUT_LINE_SIZE];       //ASCII line for the phone
+    uint8_t         phoneLength;
+} OUT_Message;
+
+typedef struct OUT_Sink OUT_Sink;
+
+/*
+ * Drain callback of a sink. Called repeatedly with the message at the head of the
+ * sink's queue, progress starts at 0 for a new message and can be used by the sink
+ * to remember how far it got. Returns 1 once the sink is done with the message.
+ */
+typedef uint8_t (*OUT_Drain)(OUT_Sink *sink, const OUT_Message *message);
+
+struct OUT_Sink
+{
+    const char          *name;
+    OUT_Drain           drain;
+    uint16_t            progress;
+    const OUT_Message   *queue[OUT_QUEUE_SIZE];
+    uint8_t             head;
+    uint8_t             tail;
+    uint8_t             backlog;
+
+    uint32_t            delivered;      //messages fully drained
+    uint32_t            dropped;        //messages skipped because the queue was full
+    uint8_t             maxBacklog;     //high-water mark of the queue
+};
+
+typedef struct
+{
+    uint32_t published;
+    uint32_t poolEmpty;     //readings lost because every message was still in use
+    uint32_t fanOutUs;      //publish until the last sink finished, last message
+    uint32_t maxFanOutUs;
+    uint32_t latencyUs;     //conversion start until the last sink finished
+    uint32_t maxLatencyUs;
+} OUT_Stats;
+
+extern OUT_Stats outStats;
+
+//Sinks registered by OUT_registerDefaultSinks
+extern OUT_Sink oledSink;
+extern OUT_Sink pcSink;
+extern OUT_Sink phoneSink;
+
+void        OUT_init(void);
+uint8_t     OUT_registerSink(OUT_Sink *sink, const char *name, OUT_Drain drain);
+uint8_t     OUT_publish(uint32_t timestamp, const TELEM_Sample *sample);
+void        OUT_poll(void);
+uint8_t     OUT_drainSink(OUT_Sink *sink);
+uint8_t     OUT_numSinks(void);
+OUT_Sink   *OUT_getSink(uint8_t index);
+void        OUT_registerDefaultSinks(void);
+void        OUT_formatValue(char *dst, int32_t hundredths);
+
+#endif /* OUTPUT_H_ */
@@ -0,0 +1,82 @@
+/*
+ * output_sinks.c
+ *
+ * The output sinks of the application: the OLED, the PC on UART0 and the phone
+ * through the HM-10 on UART3. Each drain call does a bounded amount of work so
+ * a slow sink never holds up the others.
+ */
+
+#include "output.h"
+#include "UI\ui.h"
+#include "UART\uart.h"
+#include "TELEMETRY\telemetry.h"
+
+OUT_Sink oledSink;
+OUT_Sink pcSink;
+OUT_Sink phoneSink;
+
+/**************************************************************************************
+ * UART Line Drain Function
+ * Queues as much of the line as currently fits in the TX ring of the UART and keeps
+ * the position in progress, so the sink never waits for the UART
+ ***************************************************************************************
+*/
+static uint8_t drainLineToUart(OUT_Sink *sink, const char *line, uint8_t length, UART0_Type *UARTtemp){
+    uint16_t room = getUartTxFree(UARTtemp);
+
+    while(sink->progress < length && room > 0){
+        printCharToUart(line[sink->progress++], UARTtemp);
+        room--;
+    }
+    return sink->progress >= length;
+}
+
+/**************************************************************************************
+ * OLED Sink
+ * Hands the reading to the pages of the display, then draws one value of the page
+ * that is up per call (see UI_drawStep)
+ ***************************************************************************************
+*/
+static uint8_t drainOled(OUT_Sink *sink, const OUT_Message *message){
+    if(sink->progress == 0){
+        UI_track(message);
+    }
+    return UI_drawStep(sink->progress++);
+}
+
+/**************************************************************************************
+ * PC Sink
+ * Sends the ASCII line, or a binary telemetry frame when binary mode is selected.
+ * Frames are only started once the whole frame fits in the TX ring.
+ ***************************************************************************************
+*/
+static uint8_t drainPc(OUT_Sink *sink, const OUT_Message *message){
+    if(telemetryMode == TELEM_MODE_BINARY && sink->progress == 0){
+        if(getUartTxFree(UART0) < TELEM_COBS_MAX(TELEM_SAMPLE_SIZE + TELEM_CRC_SIZE)){
+            return 0;
+        }
+        TELEM_sendSample(UART0, message->timestamp, &message->sample);
+        return 1;
+    }
+    return drainLineToUart(sink, message->pcLine, message->pcLength, UART0);
+}
+
+/**************************************************************************************
+ * Phone Sink
+ * Sends the ASCII line to the HM-10
+ ***************************************************************************************
+*/
+static uint8_t drainPhone(OUT_Sink *sink, const OUT_Message *message){
+    return drainLineToUart(sink, message->phoneLine, message->phoneLength, UART3);
+}
+
+/**************************************************************************************
+ * Register Default Sinks Function
+ * Registers the OLED, PC and phone sinks with the output stage
+ ***************************************************************************************
+*/
+void OUT_registerDefaultSinks(void){
+    OUT_registerSink(&oledSink, "OLED", drainOled);
+    OUT_registerSink(&pcSink, "UART0", drainPc);
+    OUT_registerSink(&phoneSink, "UART3", drainPhone);
+}
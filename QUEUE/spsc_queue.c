@@ -0,0 +1,143 @@
+/*
+ * spsc_queue.c
+ *
+ * Single-producer/single-consumer ring queue, see spsc_queue.h
+ */
+
+#include <string.h>
+#include "spsc_queue.h"
+
+//The host tests run the queue between threads, a full barrier stands in for the DMB
+#ifdef HOST_TEST
+#define __DMB() __sync_synchronize()
+#else
+#include "BSP\bsp.h"
+#endif
+
+/**************************************************************************************
+ * Queue Initialize Function
+ * Sets up a queue over a caller supplied buffer of capacity * elementSize bytes.
+ * Returns 0 if the capacity is not a power of two.
+ ***************************************************************************************
+*/
+uint8_t SPSC_init(SPSC_Queue *queue, void *buffer, uint16_t elementSize, uint32_t capacity){
+    if(capacity == 0 || (capacity & (capacity - 1)) != 0){
+        return 0;
+    }
+    queue->buffer = buffer;
+    queue->elementSize = elementSize;
+    queue->mask = capacity - 1;
+    queue->head = 0;
+    queue->tail = 0;
+    return 1;
+}
+
+/**************************************************************************************
+ * Producer Functions
+ * SPSC_reserve returns the free slot at the head without publishing it, or 0 if the
+ * queue is full, so an element can be built in place. SPSC_commit then makes it
+ * visible to the consumer. SPSC_push does both with a copy.
+ ***************************************************************************************
+*/
+void *SPSC_reserve(SPSC_Queue *queue){
+    uint32_t head = queue->head;
+
+    if(head - queue->tail > queue->mask){
+        return 0;
+    }
+    return &queue->buffer[(head & queue->mask) * queue->elementSize];
+}
+
+void SPSC_commit(SPSC_Queue *queue){
+    __DMB();
+    queue->head = queue->head + 1;
+}
+
+uint8_t SPSC_push(SPSC_Queue *queue, const void *element){
+    void *slot = SPSC_reserve(queue);
+
+    if(slot == 0){
+        return 0;
+    }
+    memcpy(slot, element, queue->elementSize);
+    SPSC_commit(queue);
+    return 1;
+}
+
+/**************************************************************************************
+ * Consumer Functions
+ * SPSC_peek returns the oldest element without removing it, or 0 if the queue is
+ * empty. SPSC_release then hands its slot back to the producer. SPSC_pop does both
+ * with a copy.
+ ***************************************************************************************
+*/
+const void *SPSC_peek(const SPSC_Queue *queue){
+    uint32_t tail = queue->tail;
+
+    if(queue->head == tail){
+        return 0;
+    }
+    //The element must not be read before the head that covers it
+    __DMB();
+    return &queue->buffer[(tail & queue->mask) * queue->elementSize];
+}
+
+void SPSC_release(SPSC_Queue *queue){
+    __DMB();
+    queue->tail = queue->tail + 1;
+}
+
+uint8_t SPSC_pop(SPSC_Queue *queue, void *element){
+    const void *slot = SPSC_peek(queue);
+
+    if(slot == 0){
+        return 0;
+    }
+    memcpy(element, slot, queue->elementSize);
+    SPSC_release(queue);
+    return 1;
+}
+
+/**************************************************************************************
+ * Byte Functions
+ * Push and pop for queues of single bytes without the memcpy, for the UART rings
+ ***************************************************************************************
+*/
+uint8_t SPSC_pushByte(SPSC_Queue *queue, uint8_t byte){
+    uint32_t head = queue->head;
+
+    if(head - queue->tail > queue->mask){
+        return 0;
+    }
+    queue->buffer[head & queue->mask] = byte;
+    __DMB();
+    queue->head = head + 1;
+    return 1;
+}
+
+uint8_t SPSC_popByte(SPSC_Queue *queue, uint8_t *byte){
+    uint32_t tail = queue->tail;
+
+    if(queue->head == tail){
+        return 0;
+    }
+    __DMB();
+    *byte = queue->buffer[tail & queue->mask];
+    __DMB();
+    queue->tail = tail + 1;
+    return 1;
+}
+
+/**************************************************************************************
+ * Queue Level Functions
+ * Either side may call these, the result can only be too pessimistic: the producer
+ * may see fewer free slots and the consumer fewer elements than there really are.
+ ***************************************************************************************
+*/
+uint32_t SPSC_count(const SPSC_Queue *queue){
+    return queue->head - queue->tail;
+}
+
+uint32_t SPSC_free(const SPSC_Queue *queue){
+    return queue->mask + 1 - (queue->head - queue->tail);
+}
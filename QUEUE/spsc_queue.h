@@ -0,0 +1,50 @@
+/*
+ * spsc_queue.h
+ *
+ * Lock-free single-producer/single-consumer ring queue of fixed size elements,
+ * used to hand data between an interrupt handler and the main loop (UART rings,
+ * sensor samples). The capacity has to be a power of two.
+ *
+ * head and tail are free running counters, head is only written by the producer
+ * and tail only by the consumer, so neither side needs to disable interrupts.
+ * Every slot can be used, the queue is full when head - tail == capacity. A data
+ * memory barrier sits between writing an element and publishing the new index,
+ * so the other side never sees an index before the data it covers.
+ *
+ * One context may produce and one may consume at a time. A second producer or
+ * consumer (e.g. the main loop helping out an interrupt handler) has to keep the
+ * other one out for as long as it uses the queue, for example by disabling that
+ * interrupt in the NVIC. Masking a single source in the peripheral is not enough
+ * when the handler also runs for its other sources.
+ *
+ * host/spsc_stress.c runs a producer and a consumer thread against the queue on a
+ * PC, build it with -DHOST_TEST (see there).
+ */
+
+#ifndef SPSC_QUEUE_H_
+#define SPSC_QUEUE_H_
+
+#include <stdint.h>
+
+typedef struct
+{
+    uint8_t             *buffer;
+    uint16_t            elementSize;
+    uint32_t            mask;           //capacity - 1
+    volatile uint32_t   head;           //elements ever pushed, producer only
+    volatile uint32_t   tail;           //elements ever popped, consumer only
+} SPSC_Queue;
+
+uint8_t     SPSC_init(SPSC_Queue *queue, void *buffer, uint16_t elementSize, uint32_t capacity);
+uint8_t     SPSC_push(SPSC_Queue *queue, const void *element);
+uint8_t     SPSC_pop(SPSC_Queue *queue, void *element);
+void       *SPSC_reserve(SPSC_Queue *queue);
+void        SPSC_commit(SPSC_Queue *queue);
+const void *SPSC_peek(const SPSC_Queue *queue);
+void        SPSC_release(SPSC_Queue *queue);
+uint8_t     SPSC_pushByte(SPSC_Queue *queue, uint8_t byte);
+uint8_t     SPSC_popByte(SPSC_Queue *queue, uint8_t *byte);
+uint32_t    SPSC_count(const SPSC_Queue *queue);
+uint32_t    SPSC_free(const SPSC_Queue *queue);
+
+#endif /* SPSC_QUEUE_H_ */
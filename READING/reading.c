@@ -0,0 +1,60 @@
+/*
+ * reading.c
+ *
+ * Latched seqlock around the latest reading, see reading.h
+ */
+
+#include "reading.h"
+
+//The host tests run the seqlock between threads, a full barrier stands in for the DMB
+#ifdef HOST_TEST
+#define __DMB() __sync_synchronize()
+#else
+#include "BSP\bsp.h"
+#endif
+
+static volatile uint32_t readingSequence;
+static READING_Data readingCopy[2];
+
+/**************************************************************************************
+ * Reading Publish Function
+ * Called by the acquisition path once per sample with the complete reading, count
+ * is filled in here. While copy 0 is written the sequence is odd and readers use
+ * copy 1, then the other way round.
+ ***************************************************************************************
+*/
+void READING_publish(const READING_Data *data){
+    uint32_t count = readingSequence / 2 + 1;
+
+    readingSequence = readingSequence + 1;
+    __DMB();
+    readingCopy[0] = *data;
+    readingCopy[0].count = count;
+    __DMB();
+    readingSequence = readingSequence + 1;
+    __DMB();
+    readingCopy[1] = readingCopy[0];
+}
+
+/**************************************************************************************
+ * Reading Get Function
+ * Copies the latest reading. The copy is taken again if the writer moved on while it
+ * was being made. Returns 0 if nothing has been published yet.
+ ***************************************************************************************
+*/
+uint8_t READING_get(READING_Data *data){
+    uint32_t sequence;
+
+    do {
+        sequence = readingSequence;
+        __DMB();
+        *data = readingCopy[sequence & 1];
+        __DMB();
+    } while(sequence != readingSequence);
+    return data->count != 0;
+}
+
+//Number of readings published, a cheap way for a reader to see if there is a new one
+uint32_t READING_count(void){
+    return readingSequence / 2;
+}
@@ -0,0 +1,41 @@
+/*
+ * reading.h
+ *
+ * The latest BME280 reading, published once per sample by the acquisition path
+ * and readable from anywhere (main loop, other active objects, interrupts) as a
+ * consistent snapshot. The driver globals (temperature, humidity, t_fine...) are
+ * updated field by field while a sample is read and compensated, so anything
+ * outside the acquisition path should use READING_get instead.
+ *
+ * The snapshot is kept in two copies behind a sequence counter (a latched
+ * seqlock). The writer bumps the counter to odd, updates copy 0, bumps it to even
+ * and updates copy 1, so there is always one copy that is not being written and
+ * the counter tells which one. A reader that interrupts the writer finishes on its
+ * first try, a reader that gets interrupted by the writer tries again. There is
+ * only one writer at a time, the main loop or the acquisition interrupt depending
+ * on the acquisition mode.
+ */
+
+#ifndef READING_H_
+#define READING_H_
+
+#include <stdint.h>
+
+typedef struct
+{
+    uint32_t count;             //readings published so far, 0 means none yet (set by READING_publish)
+    int32_t  temperature;       //0.01 degC
+    int32_t  temperatureF;      //0.01 degF
+    uint16_t humidity;          //0.01 %rH
+    uint32_t adcT;
+    uint16_t adcH;
+    int32_t  tFine;
+    uint64_t conversionUs;      //conversion start time
+    uint64_t readUs;            //I2C read completion time
+} READING_Data;
+
+void     READING_publish(const READING_Data *data);
+uint8_t  READING_get(READING_Data *data);
+uint32_t READING_count(void);
+
+#endif /* READING_H_ */
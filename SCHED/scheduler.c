@@ -0,0 +1,207 @@
+/*
+ * scheduler.c
+ *
+ * Run-to-completion active object scheduler, see scheduler.h. schedReady holds
+ * one bit per priority that has events waiting.
+ */
+
+#include "scheduler.h"
+#include "TIMER\timer_wheel.h"
+
+SCHED_Stats schedStats;
+
+static ActiveObject         *schedObjects[SCHED_MAX_PRIORITY + 1];
+static volatile uint32_t    schedReady;
+static void                 (*schedIdle)(void);
+
+/**************************************************************************************
+ * Ready Set Functions
+ * Atomic set/clear of a priority bit with LDREX/STREX, so a post from an interrupt
+ * that lands in the middle is never lost
+ ***************************************************************************************
+*/
+static void SCHED_setReady(uint8_t priority){
+    uint32_t ready;
+    do {
+        ready = __LDREXW(&schedReady) | (1U << priority);
+    } while(__STREXW(ready, &schedReady));
+}
+
+static void SCHED_clearReady(uint8_t priority){
+    uint32_t ready;
+    do {
+        ready = __LDREXW(&schedReady) & ~(1U << priority);
+    } while(__STREXW(ready, &schedReady));
+}
+
+/**************************************************************************************
+ * Default Idle Function
+ * Sleeps until the next interrupt. Called with interrupts disabled, WFI still wakes
+ * up on a pending interrupt which then runs as soon as they are enabled again.
+ ***************************************************************************************
+*/
+static void SCHED_defaultIdle(void){
+    __WFI();
+}
+
+/**************************************************************************************
+ * Active Object Start Function
+ * Sets up the event queue of an active object and registers it at the given
+ * priority. length must be a power of two, every priority can only be used once.
+ ***************************************************************************************
+*/
+void AO_start(ActiveObject *me, const char *name, uint8_t priority, AO_Handler handler,
+              AO_Slot *slots, uint32_t length){
+    uint32_t i;
+
+    me->name = name;
+    me->handler = handler;
+    me->priority = priority;
+    me->slots = slots;
+    me->mask = length - 1;
+    me->head = 0;
+    me->tail = 0;
+    me->dispatched = 0;
+    me->overflows = 0;
+    me->highWater = 0;
+    me->maxCycles = 0;
+    for(i = 0; i < length; i++){
+        slots[i].seq = 0;
+    }
+    if(priority > 0 && priority <= SCHED_MAX_PRIORITY){
+        schedObjects[priority] = me;
+    }
+}
+
+/**************************************************************************************
+ * Active Object Post Function
+ * Claims the next slot by moving head forward with LDREX/STREX, fills it in and then
+ * publishes it by writing its sequence number. Safe from any interrupt. Returns 0 if
+ * the queue is full, the event is dropped and counted.
+ ***************************************************************************************
+*/
+uint8_t AO_post(ActiveObject *me, uint16_t sig, uint16_t param){
+    AO_Slot *slot;
+    uint32_t head;
+
+    do {
+        head = __LDREXW(&me->head);
+        if(head - me->tail > me->mask){
+            __CLREX();
+            me->overflows++;
+            return 0;
+        }
+    } while(__STREXW(head + 1, &me->head));
+
+    slot = &me->slots[head & me->mask];
+    slot->event.sig = sig;
+    slot->event.param = param;
+    __DMB();
+    slot->seq = head + 1;
+    SCHED_setReady(me->priority);
+    return 1;
+}
+
+/**************************************************************************************
+ * Active Object Get Function
+ * Takes the oldest event out of the queue. A slot claimed by a post that has not
+ * finished yet is not taken, the post sets the ready bit again once it completes.
+ ***************************************************************************************
+*/
+static uint8_t AO_get(ActiveObject *me, AO_Event *e){
+    AO_Slot *slot = &me->slots[me->tail & me->mask];
+
+    if(slot->seq != me->tail + 1){
+        return 0;
+    }
+    __DMB();
+    *e = slot->event;
+    __DMB();
+    me->tail++;
+    return 1;
+}
+
+void SCHED_init(void (*onIdle)(void)){
+    schedIdle = (onIdle != 0) ? onIdle : SCHED_defaultIdle;
+}
+
+/**************************************************************************************
+ * Scheduler Run Function
+ * Never returns. Each pass runs the due software timers, then dispatches a single
+ * event of the highest priority ready object. If nothing is ready the idle callback
+ * runs with interrupts disabled, so an event posted just before cannot be missed.
+ ***************************************************************************************
+*/
+void SCHED_run(void){
+    ActiveObject *me;
+    AO_Event e;
+    uint32_t depth;
+    uint32_t start;
+    uint64_t idleStart;
+    uint8_t priority;
+
+    while(1){
+        TW_process();
+
+        if(schedReady != 0){
+            priority = 31 - __CLZ(schedReady);
+            me = schedObjects[priority];
+            SCHED_clearReady(priority);
+            if(me == 0){
+                continue;
+            }
+
+            depth = me->head - me->tail;
+            if(depth > me->highWater){
+                me->highWater = depth;
+            }
+            if(AO_get(me, &e)){
+                if(me->head != me->tail){
+                    SCHED_setReady(priority);
+                }
+                start = BSP_CYCLES();
+                me->handler(me, &e);
+                start = BSP_CYCLES() - start;
+                if(start > me->maxCycles){
+                    me->maxCycles = start;
+                }
+                me->dispatched++;
+            }
+        } else {
+            __disable_irq();
+            if(schedReady == 0){
+                idleStart = BSP_timestampUs();
+                schedIdle();
+                schedStats.idleUs += (uint32_t)(BSP_timestampUs() - idleStart);
+                schedStats.idleEntries++;
+            }
+            __enable_irq();
+        }
+    }
+}
+
+/**************************************************************************************
+ * Scheduler Object Access Functions
+ * Used to report per object statistics, index 0 is the lowest priority in use
+ ***************************************************************************************
+*/
+uint8_t SCHED_numObjects(void){
+    uint8_t count = 0;
+    uint8_t i;
+    for(i = 1; i <= SCHED_MAX_PRIORITY; i++){
+        if(schedObjects[i] != 0){
+            count++;
+        }
+    }
+    return count;
+}
+
+ActiveObject *SCHED_getObject(uint8_t index){
+    uint8_t i;
+    for(i = 1; i <= SCHED_MAX_PRIORITY; i++){
+        if(schedObjects[i] != 0 && index-- == 0){
+            return schedObjects[i];
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,71 @@
+/*
+ * scheduler.h
+ *
+ * Priority based run-to-completion scheduler for active objects. Every active
+ * object owns an event queue and a handler. The scheduler always dispatches one
+ * event of the highest priority ready object, each handler call runs to the end
+ * before the next one starts, so objects never preempt each other and need no
+ * locking between them. Long jobs are split into steps by posting to self.
+ *
+ * AO_post can be called from interrupts and from the main loop. Slots are
+ * claimed with LDREX/STREX and every slot carries a sequence number, so posting
+ * never disables interrupts and a post interrupted by another post is safe.
+ * When nothing is ready the idle callback runs, by default it sleeps in WFI.
+ */
+
+#ifndef SCHEDULER_H_
+#define SCHEDULER_H_
+
+#include <stdint.h>
+#include "BSP\bsp.h"
+
+#define SCHED_MAX_PRIORITY      8       //priorities 1..SCHED_MAX_PRIORITY, higher runs first
+
+typedef struct
+{
+    uint16_t sig;
+    uint16_t param;
+} AO_Event;
+
+typedef struct
+{
+    volatile uint32_t   seq;            //index+1 of the event stored here once it is complete
+    AO_Event            event;
+} AO_Slot;
+
+typedef struct ActiveObject ActiveObject;
+typedef void (*AO_Handler)(ActiveObject *me, const AO_Event *e);
+
+struct ActiveObject
+{
+    const char          *name;
+    AO_Handler          handler;
+    uint8_t             priority;
+    AO_Slot             *slots;
+    uint32_t            mask;           //queue length - 1, length is a power of two
+    volatile uint32_t   head;           //next slot to claim, written by posters
+    volatile uint32_t   tail;           //next slot to dispatch, written by the scheduler
+
+    uint32_t            dispatched;
+    uint32_t            overflows;      //posts lost because the queue was full
+    uint32_t            highWater;      //deepest the queue has been at dispatch time
+    uint32_t            maxCycles;      //longest single handler run in CPU cycles
+};
+
+typedef struct
+{
+    uint32_t idleUs;                    //microseconds asleep in the idle callback (WTIMER0, not CYCCNT)
+    uint32_t idleEntries;
+} SCHED_Stats;
+
+extern SCHED_Stats schedStats;
+
+void            AO_start(ActiveObject *me, const char *name, uint8_t priority, AO_Handler handler,
+                         AO_Slot *slots, uint32_t length);
+uint8_t         AO_post(ActiveObject *me, uint16_t sig, uint16_t param);
+void            SCHED_init(void (*onIdle)(void));
+void            SCHED_run(void);
+uint8_t         SCHED_numObjects(void);
+ActiveObject   *SCHED_getObject(uint8_t index);
+
+#endif /* SCHEDULER_H_ */
@@ -0,0 +1,165 @@
+/*
+ * ssi.c
+ *
+ * Polled SPI master on SSI0 to SSI3, see ssi.h
+ */
+
+#include "ssi.h"
+
+//Bits of the control (CR0/CR1) and status (SR) registers
+#define SSI_CR0_SPO         (1U<<6)
+#define SSI_CR0_SPH         (1U<<7)
+#define SSI_CR0_DSS_8       0x7U
+#define SSI_CR1_SSE         (1U<<1)
+#define SSI_SR_TFE          (1U<<0)
+#define SSI_SR_TNF          (1U<<1)
+#define SSI_SR_RNE          (1U<<2)
+#define SSI_SR_BSY          (1U<<4)
+
+#define SSI_CPSDVSR         2U
+
+//Pins and clock of one SSI module
+typedef struct
+{
+    SSI0_Type           *ssi;
+    GPIOA_Type          *gpio;
+    uint8_t             gpioPort;       //bit in RCGCGPIO
+    uint8_t             clkPin;
+    uint8_t             fssPin;         //driven as GPIO chip select
+    uint8_t             rxPin;
+    uint8_t             txPin;
+    uint8_t             pctl;           //pin function in GPIOPCTL
+    uint8_t             enabled;
+    uint32_t            hz;
+} SSI_Bus;
+
+/*
+ * Pin mapping of the launchpad. SSI1 is taken from PD0-PD3 rather than PF0-PF3,
+ * which carry the switches and the RGB LED, and shares those pins with SSI3.
+ */
+static SSI_Bus ssiBuses[SSI_NUM_BUSES] =
+{
+    {.ssi = SSI0, .gpio = GPIOA, .gpioPort = 0, .clkPin = 2, .fssPin = 3, .rxPin = 4, .txPin = 5, .pctl = 2},  //PA2-PA5
+    {.ssi = SSI1, .gpio = GPIOD, .gpioPort = 3, .clkPin = 0, .fssPin = 1, .rxPin = 2, .txPin = 3, .pctl = 2},  //PD0-PD3
+    {.ssi = SSI2, .gpio = GPIOB, .gpioPort = 1, .clkPin = 4, .fssPin = 5, .rxPin = 6, .txPin = 7, .pctl = 2},  //PB4-PB7
+    {.ssi = SSI3, .gpio = GPIOD, .gpioPort = 3, .clkPin = 0, .fssPin = 1, .rxPin = 2, .txPin = 3, .pctl = 1}   //PD0-PD3
+};
+
+//The modules are 4 KB apart from SSI0 on
+static SSI_Bus *getSSIBus(SSI0_Type *ssi){
+    return &ssiBuses[(((uint32_t)(uintptr_t)ssi - SSI0_BASE) >> 12) & (SSI_NUM_BUSES - 1)];
+}
+
+/**************************************************************************************
+ * SSI initialization Function
+ * Sets up an SSI module as an 8-bit SPI master in the given mode at the fastest
+ * clock not above hz: SCR = ceil(System Clock / (CPSDVSR * hz)) - 1. The FSS pin is
+ * made a GPIO output, high (deselected). Calling it again changes the clock and mode.
+ ***************************************************************************************
+*/
+void SSI_init(SSI0_Type *ssi, uint32_t hz, uint8_t mode){
+    SSI_Bus *bus = getSSIBus(ssi);
+    uint8_t pins = (1 << bus->clkPin) | (1 << bus->rxPin) | (1 << bus->txPin);
+    uint8_t fss = 1 << bus->fssPin;
+    uint32_t scr;
+
+    if(hz == 0 || hz > SSI_MAX_HZ){
+        hz = SSI_MAX_HZ;
+    }
+    scr = (SYS_CLOCK_HZ + SSI_CPSDVSR * hz - 1U) / (SSI_CPSDVSR * hz) - 1U;
+    if(scr > 255U){
+        scr = 255U;
+    }
+
+    SYSCTL->RCGCSSI |= (1U << (bus - ssiBuses));
+    SYSCTL->RCGCGPIO |= (1U << bus->gpioPort);
+    while((SYSCTL->PRSSI & (1U << (bus - ssiBuses))) == 0);
+
+    bus->gpio->DATA_Bits[fss] = fss;
+    bus->gpio->DIR |= fss;
+    bus->gpio->AFSEL = (bus->gpio->AFSEL & ~fss) | pins;
+    bus->gpio->PCTL = (bus->gpio->PCTL & ~((0xFU << (bus->clkPin * 4)) | (0xFU << (bus->fssPin * 4)) |
+                                           (0xFU << (bus->rxPin * 4)) | (0xFU << (bus->txPin * 4)))) |
+                      (bus->pctl << (bus->clkPin * 4)) | (bus->pctl << (bus->rxPin * 4)) | (bus->pctl << (bus->txPin * 4));
+    bus->gpio->DEN |= pins | fss;
+    //The clock idles high in modes 2 and 3, keep it there while the module is off
+    if(mode >= SSI_MODE_2){
+        bus->gpio->PUR |= 1 << bus->clkPin;
+    }
+
+    ssi->CR1 = 0;
+    ssi->CC = 0;
+    ssi->CPSR = SSI_CPSDVSR;
+    ssi->CR0 = (scr << 8) | ((mode & 1) ? SSI_CR0_SPH : 0) | ((mode & 2) ? SSI_CR0_SPO : 0) | SSI_CR0_DSS_8;
+    ssi->CR1 = SSI_CR1_SSE;
+
+    bus->hz = SYS_CLOCK_HZ / (SSI_CPSDVSR * (scr + 1U));
+    bus->enabled = 1;
+}
+
+uint8_t SSI_enabled(SSI0_Type *ssi){
+    return getSSIBus(ssi)->enabled;
+}
+
+//0 to 3 for SSI0 to SSI3
+uint8_t SSI_busNumber(SSI0_Type *ssi){
+    return (uint8_t)(getSSIBus(ssi) - ssiBuses);
+}
+
+//Clock SSI_init ended up with
+uint32_t SSI_clockHz(SSI0_Type *ssi){
+    return getSSIBus(ssi)->hz;
+}
+
+/**************************************************************************************
+ * SSI Select Function
+ * Drives the chip select (FSS pin) low to select the device, high to release it.
+ * Waits for the last byte to be clocked out before releasing.
+ ***************************************************************************************
+*/
+void SSI_select(SSI0_Type *ssi, uint8_t selected){
+    SSI_Bus *bus = getSSIBus(ssi);
+    uint8_t fss = 1 << bus->fssPin;
+
+    if(!selected){
+        SSI_waitIdle(ssi);
+    }
+    bus->gpio->DATA_Bits[fss] = selected ? 0 : fss;
+}
+
+//Waits until the transmit FIFO is empty and the last frame is out
+void SSI_waitIdle(SSI0_Type *ssi){
+    while((ssi->SR & (SSI_SR_TFE | SSI_SR_BSY)) != SSI_SR_TFE);
+}
+
+/**************************************************************************************
+ * SSI Transfer Function
+ * Clocks length bytes out of txData and stores the bytes clocked in at the same time
+ * into rxData. Either may be 0: 0xFF is sent when there is nothing to send, and what
+ * comes in is thrown away when there is nowhere to put it. No more than the FIFO
+ * depth is ever in flight, so the receive FIFO cannot overflow.
+ ***************************************************************************************
+*/
+void SSI_transfer(SSI0_Type *ssi, const uint8_t *txData, uint8_t *rxData, uint16_t length){
+    uint16_t sent = 0;
+    uint16_t received = 0;
+    uint8_t data;
+
+    //Left over bytes of an earlier write-only transfer
+    while(ssi->SR & SSI_SR_RNE){
+        (void)ssi->DR;
+    }
+    while(received < length){
+        if(sent < length && (sent - received) < SSI_FIFO_DEPTH && (ssi->SR & SSI_SR_TNF)){
+            ssi->DR = (txData != 0) ? txData[sent] : 0xFF;
+            sent++;
+        }
+        if(ssi->SR & SSI_SR_RNE){
+            data = (uint8_t)ssi->DR;
+            if(rxData != 0){
+                rxData[received] = data;
+            }
+            received++;
+        }
+    }
+}
@@ -0,0 +1,43 @@
+/*
+ * ssi.h
+ *
+ * SPI master on the SSI modules. Like the I2C functions, every function takes the
+ * module (SSI0 to SSI3) as its bus handle. The FSS pin of the module is driven as a
+ * plain GPIO chip select (SSI_select), so a device stays selected over a whole
+ * multi-byte transfer, one device per module. Transfers are polled, at 8 MHz a byte
+ * takes 1 us, less than an interrupt would cost.
+ */
+
+#ifndef SSI_H_
+#define SSI_H_
+
+#include <stdint.h>
+#include "BSP\TM4C123GH6PM.h"
+#include "BSP\bsp.h"
+
+#define SSI_NUM_BUSES           4
+
+/*
+ * SSI clock = System Clock / (CPSDVSR * (1 + SCR)), CPSDVSR at its minimum of 2 gives
+ * at most 8 MHz from the 16 MHz clock
+ */
+#define SSI_MAX_HZ              (SYS_CLOCK_HZ / 2U)
+
+//Clock polarity and phase, mode 0 and 3 sample on the rising edge
+#define SSI_MODE_0              0
+#define SSI_MODE_1              1
+#define SSI_MODE_2              2
+#define SSI_MODE_3              3
+
+//Depth of the transmit and receive FIFOs
+#define SSI_FIFO_DEPTH          8
+
+void        SSI_init(SSI0_Type *ssi, uint32_t hz, uint8_t mode);
+uint8_t     SSI_enabled(SSI0_Type *ssi);
+uint8_t     SSI_busNumber(SSI0_Type *ssi);
+uint32_t    SSI_clockHz(SSI0_Type *ssi);
+void        SSI_select(SSI0_Type *ssi, uint8_t selected);
+void        SSI_transfer(SSI0_Type *ssi, const uint8_t *txData, uint8_t *rxData, uint16_t length);
+void        SSI_waitIdle(SSI0_Type *ssi);
+
+#endif /* SSI_H_ */
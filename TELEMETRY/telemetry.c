@@ -0,0 +1,100 @@
+/*
+ * telemetry.c
+ *
+ * Builds binary telemetry frames and writes them to a UART. Frames are assembled
+ * in telemPayload, CRC'd, COBS encoded into telemFrame and then sent followed by
+ * the 0x00 delimiter.
+ */
+
+#include "telemetry.h"
+#include "UART\uart.h"
+
+uint8_t         telemetryMode = TELEM_MODE_ASCII;
+TELEM_Stats     telemStats;
+
+static uint16_t telemSequence;
+static uint8_t  telemPayload[TELEM_MAX_PAYLOAD + TELEM_CRC_SIZE];
+static uint8_t  telemFrame[TELEM_MAX_FRAME];
+
+/**************************************************************************************
+ * Telemetry Set Mode Function
+ * Switches UART0 output between ASCII text and binary frames
+ ***************************************************************************************
+*/
+void TELEM_setMode(uint8_t mode){
+    telemetryMode = (mode == TELEM_MODE_BINARY) ? TELEM_MODE_BINARY : TELEM_MODE_ASCII;
+}
+
+/**************************************************************************************
+ * Telemetry Send Frame Function
+ * Adds the CRC to a payload already in telemPayload, COBS encodes it and writes it
+ * out with the delimiter
+ ***************************************************************************************
+*/
+static void TELEM_sendFrame(UART0_Type *UARTtemp, uint16_t length){
+    uint16_t crc = TELEM_crc16(telemPayload, length);
+    uint16_t frameLength;
+
+    telemPayload[length++] = crc & 0xFF;
+    telemPayload[length++] = crc >> 8;
+    frameLength = TELEM_cobsEncode(telemPayload, length, telemFrame);
+    telemFrame[frameLength++] = TELEM_DELIMITER;
+
+    printBytesToUart(telemFrame, frameLength, UARTtemp);
+    telemStats.frames++;
+    telemStats.bytes += frameLength;
+}
+
+static uint16_t TELEM_startFrame(uint8_t type, uint32_t timestamp){
+    TELEM_Header header;
+    header.version = TELEM_VERSION;
+    header.type = type;
+    header.sequence = telemSequence++;
+    header.timestamp = timestamp;
+    return TELEM_packHeader(telemPayload, &header);
+}
+
+/**************************************************************************************
+ * Telemetry Send Sample Function
+ * Sends one reading as a TELEM_TYPE_SAMPLE frame
+ ***************************************************************************************
+*/
+void TELEM_sendSample(UART0_Type *UARTtemp, uint32_t timestamp, const TELEM_Sample *sample){
+    uint16_t length = TELEM_startFrame(TELEM_TYPE_SAMPLE, timestamp);
+    length += TELEM_packSample(&telemPayload[length], sample);
+    TELEM_sendFrame(UARTtemp, length);
+}
+
+/**************************************************************************************
+ * Telemetry Send Text Function
+ * Sends a text message as a TELEM_TYPE_TEXT frame so it can share UART0 with binary
+ * frames without breaking the framing on the PC side
+ ***************************************************************************************
+*/
+void TELEM_sendText(UART0_Type *UARTtemp, uint32_t timestamp, const char *text){
+    uint16_t length = TELEM_startFrame(TELEM_TYPE_TEXT, timestamp);
+
+    while(*text && length < TELEM_MAX_PAYLOAD){
+        telemPayload[length++] = (uint8_t)*(text++);
+    }
+    TELEM_sendFrame(UARTtemp, length);
+}
+
+/**************************************************************************************
+ * Telemetry Send Log Block Function
+ * Sends one compressed block of the sample log as a TELEM_TYPE_LOG_BLOCK frame. The
+ * PC decodes it with the same time-series codec used on the device.
+ ***************************************************************************************
+*/
+void TELEM_sendLogBlock(UART0_Type *UARTtemp, uint32_t timestamp, const uint8_t *block, uint16_t length){
+    uint16_t payloadLength = TELEM_startFrame(TELEM_TYPE_LOG_BLOCK, timestamp);
+    uint16_t i;
+
+    if(length > TELEM_MAX_PAYLOAD - TELEM_HEADER_SIZE){
+        length = TELEM_MAX_PAYLOAD - TELEM_HEADER_SIZE;
+    }
+    for(i = 0; i < length; i++){
+        telemPayload[payloadLength++] = block[i];
+    }
+    TELEM_sendFrame(UARTtemp, payloadLength);
+}
@@ -0,0 +1,37 @@
+/*
+ * telemetry.h
+ *
+ * Sends readings to the PC over UART0 either as the original ASCII text or as
+ * COBS framed binary frames (see telemetry_protocol.h). The mode can be changed
+ * at runtime.
+ *
+ * Throughput at 115200 baud (8N1, 11520 bytes/s):
+ *  ASCII line      48 bytes    4.2 ms per reading
+ *  Binary frame    37 bytes    3.2 ms per reading (35 byte payload+CRC, 1 COBS, 1 delimiter)
+ */
+
+#ifndef TELEMETRY_H_
+#define TELEMETRY_H_
+
+#include <stdint.h>
+#include "BSP\bsp.h"
+#include "TELEMETRY\telemetry_protocol.h"
+
+#define TELEM_MODE_ASCII        0
+#define TELEM_MODE_BINARY       1
+
+typedef struct
+{
+    uint32_t frames;        //binary frames sent
+    uint32_t bytes;         //bytes written to the UART in binary mode, delimiters included
+} TELEM_Stats;
+
+extern uint8_t      telemetryMode;
+extern TELEM_Stats  telemStats;
+
+void    TELEM_setMode(uint8_t mode);
+void    TELEM_sendSample(UART0_Type *UARTtemp, uint32_t timestamp, const TELEM_Sample *sample);
+void    TELEM_sendLogBlock(UART0_Type *UARTtemp, uint32_t timestamp, const uint8_t *block, uint16_t length);
+void    TELEM_sendText(UART0_Type *UARTtemp, uint32_t timestamp, const char *text);
+
+#endif /* TELEMETRY_H_ */
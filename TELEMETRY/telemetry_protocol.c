@@ -0,0 +1,152 @@
+/*
+ * telemetry_protocol.c
+ *
+ * CRC, COBS framing and field packing for the binary telemetry frames. Used on
+ * the device to build frames and on the PC side (host/) to decode them.
+ */
+
+#include "telemetry_protocol.h"
+
+static void TELEM_put16(uint8_t *dst, uint16_t value){
+    dst[0] = value & 0xFF;
+    dst[1] = value >> 8;
+}
+
+static void TELEM_put32(uint8_t *dst, uint32_t value){
+    dst[0] = value & 0xFF;
+    dst[1] = (value >> 8) & 0xFF;
+    dst[2] = (value >> 16) & 0xFF;
+    dst[3] = value >> 24;
+}
+
+static uint16_t TELEM_get16(const uint8_t *src){
+    return (uint16_t)(src[0] | (src[1] << 8));
+}
+
+static uint32_t TELEM_get32(const uint8_t *src){
+    return (uint32_t)src[0] | ((uint32_t)src[1] << 8) | ((uint32_t)src[2] << 16) | ((uint32_t)src[3] << 24);
+}
+
+/**************************************************************************************
+ * CRC-16 Function
+ * CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF). Uses a 16 entry table and handles
+ * a nibble per step, which is a good trade between flash use and speed.
+ ***************************************************************************************
+*/
+uint16_t TELEM_crc16(const uint8_t *data, uint16_t length){
+    static const uint16_t crcTable[16] = {
+        0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+        0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF
+    };
+    uint16_t crc = 0xFFFF;
+
+    while(length--){
+        crc = (crc << 4) ^ crcTable[(crc >> 12) ^ (*data >> 4)];
+        crc = (crc << 4) ^ crcTable[(crc >> 12) ^ (*data & 0x0F)];
+        data++;
+    }
+    return crc;
+}
+
+/**************************************************************************************
+ * COBS Encode Function
+ * Consistent Overhead Byte Stuffing removes every 0x00 from the data so 0x00 can be
+ * used as the frame delimiter. Each code byte holds the distance to the next zero.
+ * dst needs TELEM_COBS_MAX(length) bytes. Returns the encoded length, the delimiter
+ * is not added here.
+ ***************************************************************************************
+*/
+uint16_t TELEM_cobsEncode(const uint8_t *src, uint16_t length, uint8_t *dst){
+    uint16_t codeIndex = 0;
+    uint16_t out = 1;
+    uint8_t code = 1;
+
+    while(length--){
+        if(*src == 0){
+            dst[codeIndex] = code;
+            codeIndex = out++;
+            code = 1;
+        } else {
+            dst[out++] = *src;
+            code++;
+            if(code == 0xFF){
+                dst[codeIndex] = code;
+                codeIndex = out++;
+                code = 1;
+            }
+        }
+        src++;
+    }
+    dst[codeIndex] = code;
+    return out;
+}
+
+/**************************************************************************************
+ * COBS Decode Function
+ * Reverse of TELEM_cobsEncode, src must not contain the delimiter. Returns the
+ * decoded length, or 0 if the data is not valid COBS.
+ ***************************************************************************************
+*/
+uint16_t TELEM_cobsDecode(const uint8_t *src, uint16_t length, uint8_t *dst){
+    uint16_t in = 0;
+    uint16_t out = 0;
+
+    while(in < length){
+        uint8_t code = src[in++];
+        uint8_t i;
+
+        if(code == 0 || in + code - 1 > length){
+            return 0;
+        }
+        for(i = 1; i < code; i++){
+            dst[out++] = src[in++];
+        }
+        if(code != 0xFF && in < length){
+            dst[out++] = 0;
+        }
+    }
+    return out;
+}
+
+/**************************************************************************************
+ * Pack/Unpack Functions
+ * Convert between the structs and the little-endian layout described in
+ * telemetry_protocol.h. Pack functions return the number of bytes written.
+ ***************************************************************************************
+*/
+uint16_t TELEM_packHeader(uint8_t *dst, const TELEM_Header *header){
+    dst[0] = header->version;
+    dst[1] = header->type;
+    TELEM_put16(&dst[2], header->sequence);
+    TELEM_put32(&dst[4], header->timestamp);
+    return TELEM_HEADER_SIZE;
+}
+
+uint16_t TELEM_packSample(uint8_t *dst, const TELEM_Sample *sample){
+    TELEM_put32(&dst[0], sample->adcT);
+    TELEM_put16(&dst[4], sample->adcH);
+    TELEM_put32(&dst[6], (uint32_t)sample->temperature);
+    TELEM_put16(&dst[10], sample->humidity);
+    dst[12] = sample->status;
+    TELEM_put32(&dst[13], (uint32_t)sample->conversionUs);
+    TELEM_put32(&dst[17], (uint32_t)(sample->conversionUs >> 32));
+    TELEM_put32(&dst[21], (uint32_t)(sample->readUs - sample->conversionUs));
+    return TELEM_SAMPLE_SIZE - TELEM_HEADER_SIZE;
+}
+
+void TELEM_unpackHeader(const uint8_t *src, TELEM_Header *header){
+    header->version = src[0];
+    header->type = src[1];
+    header->sequence = TELEM_get16(&src[2]);
+    header->timestamp = TELEM_get32(&src[4]);
+}
+
+void TELEM_unpackSample(const uint8_t *src, TELEM_Sample *sample){
+    sample->adcT = TELEM_get32(&src[0]);
+    sample->adcH = TELEM_get16(&src[4]);
+    sample->temperature = (int32_t)TELEM_get32(&src[6]);
+    sample->humidity = TELEM_get16(&src[10]);
+    sample->status = src[12];
+    sample->conversionUs = TELEM_get32(&src[13]) | ((uint64_t)TELEM_get32(&src[17]) << 32);
+    sample->readUs = sample->conversionUs + TELEM_get32(&src[21]);
+}
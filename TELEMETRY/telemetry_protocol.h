@@ -0,0 +1,86 @@
+/*
+ * telemetry_protocol.h
+ *
+ * Binary telemetry frame layout shared by the firmware and the host decoder.
+ * This file must not depend on any hardware headers.
+ *
+ * Every frame is: payload | CRC-16 (LSB first), COBS encoded and terminated
+ * by a 0x00 delimiter. All multi-byte fields are little-endian.
+ *
+ * Payload header (all frame types):
+ *  [0]     version             TELEM_VERSION
+ *  [1]     type                TELEM_TYPE_*
+ *  [2..3]  sequence number     incremented for every frame sent
+ *  [4..7]  timestamp           milliseconds since reset
+ *
+ * TELEM_TYPE_SAMPLE body:
+ *  [8..11]  adc_T              raw 20 bit temperature reading
+ *  [12..13] adc_H              raw 16 bit humidity reading
+ *  [14..17] temperature        0.01 degC, signed
+ *  [18..19] humidity           0.01 %rH
+ *  [20]     status             TELEM_STATUS_* flags
+ *  [21..28] conversion start   microseconds since reset, when the BME280 conversion
+ *                              of this reading was triggered
+ *  [29..32] read delay         microseconds from the conversion start until the
+ *                              I2C read of the result completed
+ *
+ * TELEM_TYPE_LOG_BLOCK body:
+ *  [8..]    one block of the time-series codec (see CODEC/ts_codec.h)
+ *
+ * TELEM_TYPE_TEXT body:
+ *  [8..]    ASCII text, e.g. replies to commands received on UART0
+ */
+
+#ifndef TELEMETRY_PROTOCOL_H_
+#define TELEMETRY_PROTOCOL_H_
+
+#include <stdint.h>
+
+#define TELEM_VERSION               0x02
+#define TELEM_DELIMITER             0x00
+
+#define TELEM_TYPE_SAMPLE           0x01
+#define TELEM_TYPE_LOG_BLOCK        0x02
+#define TELEM_TYPE_TEXT             0x03
+
+#define TELEM_HEADER_SIZE           8
+#define TELEM_SAMPLE_SIZE           (TELEM_HEADER_SIZE + 25)
+#define TELEM_CRC_SIZE              2
+#define TELEM_MAX_PAYLOAD           (TELEM_HEADER_SIZE + 256)
+
+//COBS adds one byte per 254 bytes of data plus one, then the delimiter is appended
+#define TELEM_COBS_MAX(n)           ((n) + ((n) / 254) + 2)
+#define TELEM_MAX_FRAME             TELEM_COBS_MAX(TELEM_MAX_PAYLOAD + TELEM_CRC_SIZE)
+
+//Status flags of a sample
+#define TELEM_STATUS_HUMID_CLAMPED  (1<<0)
+#define TELEM_STATUS_FIRST_SAMPLE   (1<<1)
+
+typedef struct
+{
+    uint8_t  version;
+    uint8_t  type;
+    uint16_t sequence;
+    uint32_t timestamp;
+} TELEM_Header;
+
+typedef struct
+{
+    uint32_t adcT;
+    uint16_t adcH;
+    int32_t  temperature;
+    uint16_t humidity;
+    uint8_t  status;
+    uint64_t conversionUs;      //conversion start time
+    uint64_t readUs;            //I2C read completion time
+} TELEM_Sample;
+
+uint16_t    TELEM_crc16(const uint8_t *data, uint16_t length);
+uint16_t    TELEM_cobsEncode(const uint8_t *src, uint16_t length, uint8_t *dst);
+uint16_t    TELEM_cobsDecode(const uint8_t *src, uint16_t length, uint8_t *dst);
+uint16_t    TELEM_packHeader(uint8_t *dst, const TELEM_Header *header);
+uint16_t    TELEM_packSample(uint8_t *dst, const TELEM_Sample *sample);
+void        TELEM_unpackHeader(const uint8_t *src, TELEM_Header *header);
+void        TELEM_unpackSample(const uint8_t *src, TELEM_Sample *sample);
+
+#endif /* TELEMETRY_PROTOCOL_H_ */
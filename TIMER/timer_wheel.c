@@ -0,0 +1,142 @@
+/*
+ * timer_wheel.c
+ *
+ * Hashed timer wheel, see timer_wheel.h. Each slot is a circular doubly linked
+ * list with the slot itself as sentinel, so a timer can be unlinked from
+ * wherever it is without knowing which list it is in.
+ */
+
+#include "timer_wheel.h"
+#include "BSP\bsp.h"
+
+TW_Stats twStats;
+
+static TW_Link  twSlots[TW_NUM_SLOTS];
+static uint32_t twNow;
+
+static void TW_listInit(TW_Link *list){
+    list->next = list;
+    list->prev = list;
+}
+
+static void TW_unlink(TW_Link *link){
+    link->prev->next = link->next;
+    link->next->prev = link->prev;
+    TW_listInit(link);
+}
+
+static void TW_append(TW_Link *list, TW_Link *link){
+    link->prev = list->prev;
+    link->next = list;
+    list->prev->next = link;
+    list->prev = link;
+}
+
+/**************************************************************************************
+ * Timer Wheel Insert Function
+ * Hashes the timer into the slot of its expiry tick. A timer is visited every time
+ * the wheel passes its slot, so it has to skip (delay-1)/TW_NUM_SLOTS visits first.
+ ***************************************************************************************
+*/
+static void TW_insert(TW_Timer *timer, uint32_t delayTicks){
+    if(delayTicks == 0){
+        delayTicks = 1;
+    }
+    timer->expiry = twNow + delayTicks;
+    timer->rounds = (delayTicks - 1) / TW_NUM_SLOTS;
+    timer->active = 1;
+    TW_append(&twSlots[timer->expiry & TW_SLOT_MASK], &timer->link);
+}
+
+/**************************************************************************************
+ * Timer Wheel Initialize Function
+ * Empties every slot and lines the wheel up with the current SysTick count
+ ***************************************************************************************
+*/
+void TW_init(void){
+    uint16_t i;
+    for(i = 0; i < TW_NUM_SLOTS; i++){
+        TW_listInit(&twSlots[i]);
+    }
+    twNow = systemTicks;
+}
+
+/**************************************************************************************
+ * Timer Start Function
+ * Starts (or restarts) a timer that fires delayTicks from now. With a periodTicks of
+ * 0 it fires once, otherwise it keeps firing every periodTicks measured from the
+ * previous expiry so it does not drift.
+ ***************************************************************************************
+*/
+void TW_start(TW_Timer *timer, uint32_t delayTicks, uint32_t periodTicks, TW_Callback callback, void *arg){
+    if(timer->active){
+        TW_unlink(&timer->link);
+    }
+    timer->period = periodTicks;
+    timer->callback = callback;
+    timer->arg = arg;
+    TW_insert(timer, delayTicks);
+}
+
+/**************************************************************************************
+ * Timer Stop Function
+ * Stops a timer, safe to call on a timer that is not running or from a callback
+ ***************************************************************************************
+*/
+void TW_stop(TW_Timer *timer){
+    if(timer->active){
+        TW_unlink(&timer->link);
+        timer->active = 0;
+    }
+}
+
+/**************************************************************************************
+ * Timer Wheel Process Function
+ * Advances the wheel one tick at a time up to the current SysTick count. For each
+ * tick the slot is moved onto a local list first, then every timer is either put
+ * back with one round less or fired. Callbacks can start and stop any timer,
+ * including ones still waiting on the local list.
+ ***************************************************************************************
+*/
+void TW_process(void){
+    TW_Link pending;
+    TW_Link *slot;
+    TW_Timer *timer;
+    uint32_t late;
+
+    while(twNow != systemTicks){
+        twNow++;
+        slot = &twSlots[twNow & TW_SLOT_MASK];
+        if(slot->next == slot){
+            continue;
+        }
+
+        //Move the whole slot onto the pending list
+        pending.next = slot->next;
+        pending.prev = slot->prev;
+        pending.next->prev = &pending;
+        pending.prev->next = &pending;
+        TW_listInit(slot);
+
+        while(pending.next != &pending){
+            timer = (TW_Timer *)pending.next;
+            TW_unlink(&timer->link);
+            if(timer->rounds > 0){
+                timer->rounds--;
+                TW_append(slot, &timer->link);
+                continue;
+            }
+
+            late = systemTicks - timer->expiry;
+            if(late > twStats.maxLateTicks){
+                twStats.maxLateTicks = late;
+            }
+            timer->active = 0;
+            if(timer->period != 0){
+                TW_insert(timer, timer->period);
+            }
+            twStats.fired++;
+            timer->callback(timer->arg);
+        }
+    }
+}
@@ -0,0 +1,53 @@
+/*
+ * timer_wheel.h
+ *
+ * Hashed timer wheel for software timers driven by the SysTick count. Timers
+ * are hashed into TW_NUM_SLOTS lists by their expiry tick, so starting,
+ * stopping and expiring a timer are O(1). Timers further away than one turn of
+ * the wheel carry a number of rounds left to wait.
+ *
+ * TW_process is called from the main loop and runs the callbacks of every
+ * timer due since the last call, so callbacks never run in interrupt context.
+ */
+
+#ifndef TIMER_WHEEL_H_
+#define TIMER_WHEEL_H_
+
+#include <stdint.h>
+
+#define TW_NUM_SLOTS        64      //must be a power of two
+#define TW_SLOT_MASK        (TW_NUM_SLOTS - 1)
+
+typedef void (*TW_Callback)(void *arg);
+
+typedef struct TW_Link
+{
+    struct TW_Link *next;
+    struct TW_Link *prev;
+} TW_Link;
+
+typedef struct
+{
+    TW_Link     link;           //must stay first, the lists are made of links
+    uint32_t    expiry;         //tick the timer fires on
+    uint32_t    period;         //0 for a one-shot timer
+    uint32_t    rounds;         //turns of the wheel left before expiry
+    TW_Callback callback;
+    void        *arg;
+    uint8_t     active;
+} TW_Timer;
+
+typedef struct
+{
+    uint32_t fired;             //callbacks run since boot
+    uint32_t maxLateTicks;      //largest delay between expiry and processing
+} TW_Stats;
+
+extern TW_Stats twStats;
+
+void    TW_init(void);
+void    TW_start(TW_Timer *timer, uint32_t delayTicks, uint32_t periodTicks, TW_Callback callback, void *arg);
+void    TW_stop(TW_Timer *timer);
+void    TW_process(void);
+
+#endif /* TIMER_WHEEL_H_ */
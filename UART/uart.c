@@ -6,10 +6,88 @@
  */
 
 #include "uart.h"
+#include "QUEUE\spsc_queue.h"
+#include "DMA\udma.h"
 #include <stdbool.h>
 #include <string.h>
 char txChar;
 
+//Ring buffer sizes, must be powers of two
+#define UART0_TX_SIZE   512
+#define UART0_RX_SIZE   128
+#define UART3_TX_SIZE   256
+#define UART3_RX_SIZE   64
+
+//Size of each of the two uDMA ping-pong buffers
+#define UART_DMA_BUFFER_SIZE    256
+
+//Bits of the UART interrupt mask (IM), flag (FR) and line control (LCRH) registers
+#define UART_IM_RXIM    (1<<4)
+#define UART_IM_TXIM    (1<<5)
+#define UART_IM_RTIM    (1<<6)
+#define UART_FR_RXFE    (1<<4)
+#define UART_FR_TXFF    (1<<5)
+#define UART_LCRH_FEN   (1<<4)
+#define UART_DMACTL_TXDMAE  (1<<1)
+
+/*
+ * uDMA transmit state of a UART. While streaming, everything written to the UART
+ * goes into one of the two buffers instead of the TX queue. A full buffer is handed
+ * to the uDMA (buffer 0 on the primary, buffer 1 on the alternate descriptor of the
+ * ping-pong pair) and the writer carries on with the other one.
+ */
+typedef struct
+{
+    uint8_t             channel;
+    uint8_t             encoding;
+    volatile uint8_t    streaming;
+    uint8_t             fill;           //buffer being filled
+    uint16_t            length;         //bytes in it
+    uint8_t             buffer[2][UART_DMA_BUFFER_SIZE];
+    UART_DmaStats       stats;
+    uint64_t            startUs;
+} UART_Dma;
+
+/*
+ * State of an interrupt driven UART. The TX queue is filled by printCharToUart and
+ * drained into the hardware FIFO by the UART interrupt, the RX queue the other way
+ * round. uartTxKick also drains the TX queue, it disables the UART interrupt in the
+ * NVIC while doing so, which keeps uartService out whatever source it would run for.
+ */
+typedef struct
+{
+    UART0_Type          *uart;
+    IRQn_Type           irq;
+    uint32_t            baud;
+    SPSC_Queue          tx;
+    SPSC_Queue          rx;
+    UART_Stats          stats;
+    void                (*rxCallback)(void);
+    UART_Dma            *dma;
+} UART_Port;
+
+static uint8_t uart0TxBuf[UART0_TX_SIZE];
+static uint8_t uart0RxBuf[UART0_RX_SIZE];
+static uint8_t uart3TxBuf[UART3_TX_SIZE];
+static uint8_t uart3RxBuf[UART3_RX_SIZE];
+
+static UART_Dma uart0Dma = {UDMA_CH_UART0_TX, UDMA_ENC_UART0_TX, 0, 0, 0, {{0}}, {0}, 0};
+static UART_Dma uart3Dma = {UDMA_CH_UART3_TX, UDMA_ENC_UART3_TX, 0, 0, 0, {{0}}, {0}, 0};
+
+static UART_Port uart0Port = {0, UART0_IRQn, 115200, {uart0TxBuf, 1, UART0_TX_SIZE - 1, 0, 0},
+                              {uart0RxBuf, 1, UART0_RX_SIZE - 1, 0, 0}, {0}, 0, &uart0Dma};
+static UART_Port uart3Port = {0, UART3_IRQn, 9600, {uart3TxBuf, 1, UART3_TX_SIZE - 1, 0, 0},
+                              {uart3RxBuf, 1, UART3_RX_SIZE - 1, 0, 0}, {0}, 0, &uart3Dma};
+
+static UART_Port *getUartPort(UART0_Type *UARTtemp){
+    if(UARTtemp == UART0){
+        return &uart0Port;
+    } else if(UARTtemp == UART3){
+        return &uart3Port;
+    }
+    return 0;
+}
+
 /**************************************************************************************
  * UART0 initialization Function
  * This function initializes UART0 which is used to communicate with the PC
@@ -41,12 +119,18 @@ void UART0_Init(void){
     UART0->IBRD = 8;//8
     UART0->FBRD = 44;//44
 
-    //Setting word length to 8 bits
-    UART0->LCRH = (0x3<<5);
+    //Setting word length to 8 bits and enabling the FIFOs
+    UART0->LCRH = (0x3<<5)|UART_LCRH_FEN;
 
     //Setting UART clock source to system clock
     UART0->CC = 0x0;
 
+    //Interrupt on RX FIFO half full and on receive timeout, TX is enabled when needed
+    uart0Port.uart = UART0;
+    UART0->ICR = 0x7FF;
+    UART0->IM = UART_IM_RXIM|UART_IM_RTIM;
+    NVIC_EnableIRQ(UART0_IRQn);
+
     //Enable UART module and enable it for Transmit and Recieve
     UART0->CTL = (1<<0)|(1<<8)|(1<<9);
 }
@@ -82,27 +166,354 @@ void UART3_Init(void){
     UART3->IBRD = 104;
     UART3->FBRD = 11;
 
-    //Setting word length to 8 bits
-    UART3->LCRH = (0x3<<5);
+    //Setting word length to 8 bits and enabling the FIFOs
+    UART3->LCRH = (0x3<<5)|UART_LCRH_FEN;
 
     //Setting UART3 clock source to system clock
     UART3->CC = 0x0;
 
-    //Enabling UART Module and Enabling it to Transmit
-    UART3->CTL = (1<<0)|(1<<8);
+    uart3Port.uart = UART3;
+    UART3->ICR = 0x7FF;
+    NVIC_EnableIRQ(UART3_IRQn);
+
+    //Interrupt on RX FIFO half full and on receive timeout, used for HM-10 AT replies
+    UART3->IM = UART_IM_RXIM|UART_IM_RTIM;
+
+    //Enabling UART Module and Enabling it to Transmit and Receive
+    UART3->CTL = (1<<0)|(1<<8)|(1<<9);
+}
+
+/**************************************************************************************
+ * Set UART Baud Rate Function
+ * Waits for everything queued to be sent, then changes the baud rate. The divisor is
+ * SysClk/(16*baud), IBRD holds the integer part and FBRD the fraction in 1/64ths, so
+ * 64*divisor = 4*SysClk/baud (rounded). LCRH has to be written after the divisors for
+ * them to be latched.
+ ***************************************************************************************
+*/
+void setUartBaud(UART0_Type *UARTtemp, uint32_t baud){
+    uint32_t divisor = (SYS_CLOCK_HZ * 4U + baud / 2U) / baud;
+    uint32_t ctl;
+
+    flushUart(UARTtemp);
+    ctl = UARTtemp->CTL;
+    UARTtemp->CTL &= ~(1<<0);
+    UARTtemp->IBRD = divisor >> 6;
+    UARTtemp->FBRD = divisor & 0x3F;
+    UARTtemp->LCRH = UARTtemp->LCRH;
+    UARTtemp->CTL = ctl;
+
+    if(getUartPort(UARTtemp) != 0){
+        getUartPort(UARTtemp)->baud = baud;
+    }
+}
+
+/**************************************************************************************
+ * Get UART Baud Rate Function
+ * Returns the nominal baud rate the UART was last set to
+ ***************************************************************************************
+*/
+uint32_t getUartBaud(UART0_Type *UARTtemp){
+    UART_Port *port = getUartPort(UARTtemp);
+    return (port != 0) ? port->baud : 0;
+}
+
+
+/**************************************************************************************
+ * UART TX Kick Function
+ * Moves as many bytes as fit from the TX ring into the hardware FIFO. The interrupt of
+ * the UART is disabled in the NVIC while doing so: uartService pops the same ring on
+ * RX and receive timeout interrupts too, not only on TX, so masking TXIM alone would
+ * leave two consumers. The TX interrupt is unmasked again if bytes are left in the
+ * ring. Works with interrupts disabled, printCharToUart relies on that.
+ ***************************************************************************************
+*/
+static void uartTxKick(UART_Port *port){
+    uint8_t byte;
+
+    NVIC_DisableIRQ(port->irq);
+    while(!(port->uart->FR & UART_FR_TXFF) && SPSC_popByte(&port->tx, &byte)){
+        port->uart->DR = byte;
+        port->stats.txBytes++;
+    }
+    if(SPSC_count(&port->tx) != 0){
+        port->uart->IM |= UART_IM_TXIM;
+    }
+    NVIC_EnableIRQ(port->irq);
 }
 
+/**************************************************************************************
+ * UART Interrupt Service Function
+ * Shared by the UART interrupt handlers. Empties the RX FIFO into the RX ring and
+ * refills the TX FIFO from the TX ring. When the TX ring is empty the TX interrupt is
+ * masked until printCharToUart queues more data.
+ ***************************************************************************************
+*/
+static void uartService(UART_Port *port){
+    UART0_Type *uart = port->uart;
+    uint32_t received = port->stats.rxBytes;
+    uint32_t data;
+    uint8_t byte;
+
+    uart->ICR = UART_IM_RXIM|UART_IM_RTIM|UART_IM_TXIM;
+
+    //uDMA completions are signalled on the interrupt of the UART
+    if(UDMA->CHIS & (1U << port->dma->channel)){
+        UDMA->CHIS = (1U << port->dma->channel);
+    }
+
+    while(!(uart->FR & UART_FR_RXFE)){
+        data = uart->DR;
+        if(data & 0xF00){
+            //Framing, parity, break or overrun error
+            port->stats.rxErrors++;
+        }
+        if(SPSC_pushByte(&port->rx, data & 0xFF)){
+            port->stats.rxBytes++;
+        } else {
+            port->stats.rxDropped++;
+        }
+    }
+
+    if(port->stats.rxBytes != received && port->rxCallback != 0){
+        port->rxCallback();
+    }
+
+    while(!(uart->FR & UART_FR_TXFF) && SPSC_popByte(&port->tx, &byte)){
+        uart->DR = byte;
+        port->stats.txBytes++;
+    }
+    if(SPSC_count(&port->tx) == 0){
+        uart->IM &= ~UART_IM_TXIM;
+    }
+}
+
+void UART0_IRQHandler(void){
+    uartService(&uart0Port);
+}
+
+void UART3_IRQHandler(void){
+    uartService(&uart3Port);
+}
+
+/**************************************************************************************
+ * UART uDMA Wait Function
+ * Sleeps until the given ping-pong buffer is no longer owned by the uDMA, i.e. the
+ * mode of its descriptor went back to stop. Any interrupt (uDMA done, SysTick) wakes
+ * the CPU up to check again. The time asleep is counted for the CPU load figure, on
+ * WTIMER0: the cycle counter stops while the core sleeps.
+ ***************************************************************************************
+*/
+static UDMA_Descriptor *uartDmaDescriptor(UART_Dma *dma, uint8_t index){
+    return (index == 0) ? UDMA_primary(dma->channel) : UDMA_alternate(dma->channel);
+}
+
+static void uartDmaWait(UART_Dma *dma, uint8_t index){
+    UDMA_Descriptor *descriptor = uartDmaDescriptor(dma, index);
+    uint64_t start;
+
+    while((descriptor->control & UDMA_MODE_MASK) != UDMA_MODE_STOP){
+        start = BSP_timestampUs();
+        __disable_irq();
+        if((descriptor->control & UDMA_MODE_MASK) != UDMA_MODE_STOP){
+            __WFI();
+        }
+        __enable_irq();
+        dma->stats.sleepUs += (uint32_t)(BSP_timestampUs() - start);
+    }
+}
+
+/**************************************************************************************
+ * UART uDMA Submit Function
+ * Hands the buffer being filled to the uDMA and switches to the other one. If the
+ * channel already stopped (it ran out of armed buffers) it is restarted on this
+ * buffer's descriptor, otherwise the controller moves on to it by itself.
+ ***************************************************************************************
+*/
+static void uartDmaSubmit(UART_Port *port){
+    UART_Dma *dma = port->dma;
+    UDMA_Descriptor *descriptor = uartDmaDescriptor(dma, dma->fill);
+
+    if(dma->length == 0){
+        return;
+    }
+    descriptor->srcEnd = &dma->buffer[dma->fill][dma->length - 1];
+    descriptor->dstEnd = &port->uart->DR;
+    descriptor->control = UDMA_DSTINC_NONE | UDMA_DSTSIZE_8 | UDMA_SRCINC_8 | UDMA_SRCSIZE_8 |
+                          UDMA_ARBSIZE_4 | UDMA_XFERSIZE(dma->length) | UDMA_MODE_PINGPONG;
+    __DSB();
+    if(!UDMA_enabled(dma->channel)){
+        UDMA_enable(dma->channel, dma->fill);
+    }
+    dma->stats.bytes += dma->length;
+    dma->stats.buffers++;
+
+    dma->fill ^= 1;
+    dma->length = 0;
+    uartDmaWait(dma, dma->fill);
+}
+
+static void uartDmaPut(UART_Port *port, uint8_t byte){
+    UART_Dma *dma = port->dma;
+
+    dma->buffer[dma->fill][dma->length++] = byte;
+    if(dma->length == UART_DMA_BUFFER_SIZE){
+        uartDmaSubmit(port);
+    }
+}
+
+/**************************************************************************************
+ * UART uDMA Functions
+ * UART_dmaInit assigns the uDMA channels of UART0 TX (channel 9) and UART3 TX
+ * (channel 17). Between UART_dmaBegin and UART_dmaEnd everything written to the UART
+ * from the main loop is sent by the uDMA from two ping-pong buffers, so a bulk dump
+ * leaves the CPU asleep most of the time. UART_dmaEnd waits for the last byte and
+ * returns the byte count, duration and time asleep of the stream.
+ ***************************************************************************************
+*/
+void UART_dmaInit(void){
+    UDMA_init();
+    UDMA_assign(uart0Dma.channel, uart0Dma.encoding);
+    UDMA_assign(uart3Dma.channel, uart3Dma.encoding);
+}
+
+uint8_t UART_dmaBegin(UART0_Type *UARTtemp){
+    UART_Port *port = getUartPort(UARTtemp);
+    UART_Dma *dma;
+
+    if(port == 0 || port->uart == 0 || port->dma->streaming){
+        return 0;
+    }
+    dma = port->dma;
+    flushUart(UARTtemp);
+    dma->fill = 0;
+    dma->length = 0;
+    dma->stats.bytes = 0;
+    dma->stats.buffers = 0;
+    dma->stats.sleepUs = 0;
+    dma->startUs = BSP_timestampUs();
+    UARTtemp->DMACTL |= UART_DMACTL_TXDMAE;
+    dma->streaming = 1;
+    return 1;
+}
+
+void UART_dmaEnd(UART0_Type *UARTtemp, UART_DmaStats *stats){
+    UART_Port *port = getUartPort(UARTtemp);
+    UART_Dma *dma;
+
+    if(port == 0 || !port->dma->streaming){
+        return;
+    }
+    dma = port->dma;
+    uartDmaSubmit(port);
+    uartDmaWait(dma, 0);
+    uartDmaWait(dma, 1);
+    dma->streaming = 0;
+    //BUSY bit stays set until the last stop bit is out
+    while(UARTtemp->FR & (1<<3));
+    UARTtemp->DMACTL &= ~UART_DMACTL_TXDMAE;
+    UDMA->ENACLR = (1U << dma->channel);
+    dma->stats.us = (uint32_t)(BSP_timestampUs() - dma->startUs);
+    if(stats != 0){
+        *stats = dma->stats;
+    }
+}
 
 /**************************************************************************************
  * Print a char to UART function. This is used for writing data to the UART
- * Before printing char it polls the UART flag register's(UART->FR) 5th bit to determine
- * if the UART transmit FIFO is full or not. Once empty, it fills it with the next
- * char
+ * The char is queued in the TX ring of the UART and sent by the UART interrupt, so the
+ * caller does not wait for the byte to go out. Only if the ring is full it waits,
+ * kicking the FIFO itself so this also works with interrupts disabled.
  ***************************************************************************************
 */
 void printCharToUart(char c, UART0_Type *UARTtemp){
-    while((UARTtemp->FR & (1<<5)));
-    UARTtemp->DR = c;
+    UART_Port *port = getUartPort(UARTtemp);
+
+    if(port == 0 || port->uart == 0){
+        while((UARTtemp->FR & UART_FR_TXFF));
+        UARTtemp->DR = c;
+        return;
+    }
+    if(port->dma->streaming){
+        uartDmaPut(port, (uint8_t)c);
+        return;
+    }
+
+    if(!SPSC_pushByte(&port->tx, (uint8_t)c)){
+        port->stats.txWaits++;
+        do {
+            uartTxKick(port);
+        } while(!SPSC_pushByte(&port->tx, (uint8_t)c));
+    }
+    uartTxKick(port);
+}
+
+/**************************************************************************************
+ * Read a char from UART function. Takes the oldest received byte out of the RX ring.
+ * Returns 1 if a byte was available, 0 if nothing has been received.
+ ***************************************************************************************
+*/
+uint8_t readCharFromUart(char *c, UART0_Type *UARTtemp){
+    UART_Port *port = getUartPort(UARTtemp);
+
+    if(port == 0){
+        return 0;
+    }
+    return SPSC_popByte(&port->rx, (uint8_t *)c);
+}
+
+/**************************************************************************************
+ * UART TX Free Function
+ * Number of bytes that can be queued with printCharToUart without waiting
+ ***************************************************************************************
+*/
+uint16_t getUartTxFree(UART0_Type *UARTtemp){
+    UART_Port *port = getUartPort(UARTtemp);
+
+    if(port == 0){
+        return 0;
+    }
+    return SPSC_free(&port->tx);
+}
+
+/**************************************************************************************
+ * UART TX Flush Function
+ * Waits until everything queued for the UART has been sent, including the FIFO
+ ***************************************************************************************
+*/
+void flushUart(UART0_Type *UARTtemp){
+    UART_Port *port = getUartPort(UARTtemp);
+
+    if(port != 0){
+        while(SPSC_count(&port->tx) != 0){
+            uartTxKick(port);
+        }
+    }
+    //BUSY bit stays set until the last stop bit is out
+    while(UARTtemp->FR & (1<<3));
+}
+
+/**************************************************************************************
+ * UART RX Callback Function
+ * Registers a function the UART interrupt calls whenever new bytes were stored in
+ * the RX ring. It runs in interrupt context and should only signal the main loop.
+ ***************************************************************************************
+*/
+void setUartRxCallback(UART0_Type *UARTtemp, void (*callback)(void)){
+    UART_Port *port = getUartPort(UARTtemp);
+    if(port != 0){
+        port->rxCallback = callback;
+    }
+}
+
+/**************************************************************************************
+ * UART Statistics Function
+ * Returns the byte and error counters of an interrupt driven UART
+ ***************************************************************************************
+*/
+const UART_Stats *getUartStats(UART0_Type *UARTtemp){
+    UART_Port *port = getUartPort(UARTtemp);
+    return (port != 0) ? &port->stats : 0;
 }
 
 
@@ -117,3 +528,16 @@ void printStringToUart(char * string, UART0_Type *UARTtemp){
         printCharToUart(*(string++), UARTtemp);
     }
 }
+
+
+/**************************************************************************************
+ * Print bytes to UART function. Same as printStringToUart but for binary data, which
+ * can contain 0x00 so the number of bytes to send is given instead.
+ *
+ ***************************************************************************************
+*/
+void printBytesToUart(const uint8_t *data, uint16_t length, UART0_Type *UARTtemp){
+    while(length--){
+        printCharToUart((char)*(data++), UARTtemp);
+    }
+}
@@ -9,9 +9,38 @@
 #define UART_H_
 #include "BSP\bsp.h"
 
+typedef struct
+{
+    uint32_t txBytes;       //bytes moved into the TX FIFO
+    uint32_t txWaits;       //times a writer had to wait for room in the TX ring
+    uint32_t rxBytes;       //bytes stored in the RX ring
+    uint32_t rxDropped;     //bytes lost because the RX ring was full
+    uint32_t rxErrors;      //framing, parity, break and overrun errors
+} UART_Stats;
+
+//Result of a uDMA stream, see UART_dmaBegin
+typedef struct
+{
+    uint32_t bytes;         //bytes sent by the uDMA
+    uint32_t buffers;       //buffers handed to the uDMA
+    uint32_t us;            //length of the stream
+    uint32_t sleepUs;       //time spent asleep waiting for the uDMA
+} UART_DmaStats;
+
 void UART0_Init(void);
 void UART2_Init(void);
 void UART3_Init(void);
+void setUartBaud(UART0_Type *UARTtemp, uint32_t baud);
+uint32_t getUartBaud(UART0_Type *UARTtemp);
 void printCharToUart(char c, UART0_Type *UARTtemp);
 void printStringToUart(char * string, UART0_Type *UARTtemp);
+void printBytesToUart(const uint8_t *data, uint16_t length, UART0_Type *UARTtemp);
+uint8_t readCharFromUart(char *c, UART0_Type *UARTtemp);
+uint16_t getUartTxFree(UART0_Type *UARTtemp);
+void flushUart(UART0_Type *UARTtemp);
+const UART_Stats *getUartStats(UART0_Type *UARTtemp);
+void setUartRxCallback(UART0_Type *UARTtemp, void (*callback)(void));
+void UART_dmaInit(void);
+uint8_t UART_dmaBegin(UART0_Type *UARTtemp);
+void UART_dmaEnd(UART0_Type *UARTtemp, UART_DmaStats *stats);
 #endif /* UART_H_ */
@@ -0,0 +1,309 @@
+/*
+ * ui.c
+ *
+ * Pages of the OLED, see ui.h
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "ui.h"
+#include "BUTTON\buttons.h"
+#include "COMMAND\command.h"
+#include "I2C\i2c.h"
+#include "OLED\SSD1306_I2C_TivaC.h"
+#include "SCHED\scheduler.h"
+#include "TIMER\timer_wheel.h"
+
+//Column the values of each page start at, right of the longest label
+#define UI_LIVE_COLUMN          35
+#define UI_MINMAX_COLUMN        49
+#define UI_SYSTEM_COLUMN        63
+#define UI_SAMPLES_COLUMN       63
+
+//Label of a chrome line
+typedef struct
+{
+    uint8_t     page;
+    uint8_t     x;
+    const char  *text;
+} UI_Label;
+
+UI_Stats uiStats;
+UI_MinMax uiMinMax;
+SSD_Graph uiGraph;
+
+static SSD_Page     uiChrome[UI_NUM_PAGES][SSD_MAX_PAGE_NUMBER + 1];
+static char         uiLive[3][OUT_VALUE_SIZE];      //Celsius, Fahrenheit, humidity of the last reading
+static uint8_t      uiGraphSource = 0xFF;
+static TW_Timer     uiTimer;
+static uint64_t     uiLastUs;
+static uint32_t     uiLastIdleUs;
+static void         (*uiRefreshCallback)(void);
+
+static const UI_Label uiLiveLabels[] =
+{
+    {0, 0, "Temperature"}, {1, 0, "(C): "}, {2, 0, "(F): "}, {3, 0, "Humidity"}, {4, 0, "%rH: "}, {0, 0, 0}
+};
+
+static const UI_Label uiMinMaxLabels[] =
+{
+    {0, 0, "Min/Max C, %rH"}, {2, 0, "T min:"}, {3, 0, "T max:"}, {5, 0, "H min:"}, {6, 0, "H max:"},
+    {7, 0, "Samples:"}, {0, 0, 0}
+};
+
+static const UI_Label uiGraphLabels[] =
+{
+    {0, 0, "Trend"}, {0, 0, 0}
+};
+
+static const UI_Label uiSystemLabels[] =
+{
+    {0, 0, "System"}, {2, 0, "Uptime:"}, {3, 0, "Bus err:"}, {4, 0, "CPU:"}, {5, 0, "Display:"}, {0, 0, 0}
+};
+
+static const UI_Label *const uiLabels[UI_NUM_PAGES] = {uiLiveLabels, uiMinMaxLabels, uiGraphLabels, uiSystemLabels};
+
+/**************************************************************************************
+ * UI Render Chrome Function
+ * Renders the labels of every page into its RAM copy of the display and underlines
+ * the title (page 0) with the bottom row of its pixels
+ ***************************************************************************************
+*/
+static void UI_renderChrome(void){
+    const UI_Label *label;
+    uint8_t page;
+    uint8_t i;
+
+    memset(uiChrome, 0, sizeof(uiChrome));
+    for(page = 0; page < UI_NUM_PAGES; page++){
+        for(i = 0; i <= SSD_MAX_PAGE_NUMBER; i++){
+            uiChrome[page][i].control = 0x40;
+        }
+        for(label = uiLabels[page]; label->text != 0; label++){
+            SSD_renderText_6x8(&uiChrome[page][label->page], label->x, label->text);
+        }
+        if(page != UI_PAGE_LIVE){
+            for(i = 0; i < SSD_LCDWIDTH; i++){
+                uiChrome[page][0].columns[i] |= 0x80;
+            }
+        }
+    }
+}
+
+/**************************************************************************************
+ * UI Graph Source Function
+ * Starts a new graph when the graph command picked the other value, hidden unless
+ * the graph page is up
+ ***************************************************************************************
+*/
+static void UI_fitGraphSource(void){
+    if(runtimeConfig.graphSource == uiGraphSource){
+        return;
+    }
+    uiGraphSource = runtimeConfig.graphSource;
+    if(uiGraphSource == CMD_GRAPH_HUMIDITY){
+        SSD_graphInit(&uiGraph, UI_GRAPH_FIRST_PAGE, UI_GRAPH_PAGES, SSD_GRAPH_MAX_WIDTH,
+                      UI_GRAPH_MIN_SPAN_HUMIDITY, "%rH");
+    } else {
+        SSD_graphInit(&uiGraph, UI_GRAPH_FIRST_PAGE, UI_GRAPH_PAGES, SSD_GRAPH_MAX_WIDTH,
+                      UI_GRAPH_MIN_SPAN_TEMPERATURE, "C");
+    }
+    SSD_graphShow(&uiGraph, runtimeConfig.displayPage == UI_PAGE_GRAPH);
+}
+
+/**************************************************************************************
+ * UI Timer Callback
+ * Works out the CPU load from the time the scheduler spent idle since the last call,
+ * and has the system page redrawn when it is up. Both are timestamp microseconds,
+ * the cycle counter stops while the core sleeps in WFI.
+ ***************************************************************************************
+*/
+static void UI_timerCallback(void *arg){
+    uint64_t now = BSP_timestampUs();
+    uint32_t idleUs = schedStats.idleUs;
+    uint32_t elapsed = (uint32_t)(now - uiLastUs);
+    uint32_t idle = idleUs - uiLastIdleUs;
+
+    if(elapsed != 0){
+        uiStats.cpuLoad = (idle >= elapsed) ? 0 : (uint8_t)(((uint64_t)(elapsed - idle) * 100U) / elapsed);
+    }
+    uiLastUs = now;
+    uiLastIdleUs = idleUs;
+    if(runtimeConfig.displayPage == UI_PAGE_SYSTEM && uiPower.state != UI_POWER_OFF && uiRefreshCallback != 0){
+        uiRefreshCallback();
+    }
+}
+
+/**************************************************************************************
+ * UI Initialize Function
+ * Renders the chrome of all pages, shows runtimeConfig.displayPage and starts the
+ * refresh timer. refreshCallback is called from the main loop when the system page
+ * needs redrawing, it should get UI_refresh called by the display object.
+ ***************************************************************************************
+*/
+void UI_init(void (*refreshCallback)(void)){
+    uiRefreshCallback = refreshCallback;
+    UI_renderChrome();
+    UI_fitGraphSource();
+    uiLastUs = BSP_timestampUs();
+    uiLastIdleUs = schedStats.idleUs;
+    TW_start(&uiTimer, BSP_MS_TO_TICKS(UI_REFRESH_MS), BSP_MS_TO_TICKS(UI_REFRESH_MS), UI_timerCallback, 0);
+    UI_powerInit();
+    UI_show(runtimeConfig.displayPage);
+}
+
+/**************************************************************************************
+ * UI Show Function
+ * Switches to a page: the graph is hidden so it stops drawing, the chrome of the
+ * page goes out in one write of all 8 pages, then the values of the page are drawn
+ * from the last reading. While the display is off only the page is changed, it is
+ * drawn when the display wakes up.
+ ***************************************************************************************
+*/
+void UI_show(uint8_t page){
+    uint32_t start = BSP_CYCLES();
+    uint16_t step;
+
+    if(page >= UI_NUM_PAGES){
+        return;
+    }
+    runtimeConfig.displayPage = page;
+    if(uiPower.state == UI_POWER_OFF){
+        return;
+    }
+    SSD_graphShow(&uiGraph, 0);
+    SSD_writePages(0, SSD_MAX_PAGE_NUMBER + 1, uiChrome[page]);
+    for(step = 0; !UI_drawStep(step); step++);
+    if(page == UI_PAGE_GRAPH){
+        SSD_graphShow(&uiGraph, 1);
+    } else if(page == UI_PAGE_SYSTEM){
+        UI_refresh();
+    }
+    uiStats.switches++;
+    uiStats.switchUs = (BSP_CYCLES() - start) / (SYS_CLOCK_HZ / 1000000U);
+}
+
+//SW1 moves to the next page, SW2 to the previous one. A press that wakes the display only does that.
+void UI_button(uint8_t button){
+    uint8_t page = runtimeConfig.displayPage;
+
+    if(UI_wake(UI_WAKE_BUTTON)){
+        UI_show(page);
+    } else if(button == BTN_SW1){
+        UI_show((page + 1 < UI_NUM_PAGES) ? page + 1 : 0);
+    } else {
+        UI_show((page > 0) ? page - 1 : UI_NUM_PAGES - 1);
+    }
+}
+
+/**************************************************************************************
+ * UI Track Function
+ * Takes in a new reading whatever page is up: the live values, the minimum and
+ * maximum, and the graph, which only draws itself on the graph page. A big enough
+ * change wakes the display.
+ ***************************************************************************************
+*/
+void UI_track(const OUT_Message *message){
+    const TELEM_Sample *sample = &message->sample;
+
+    strcpy(uiLive[0], message->tempC);
+    strcpy(uiLive[1], message->tempF);
+    strcpy(uiLive[2], message->humidity);
+
+    if(uiMinMax.samples == 0 || sample->temperature < uiMinMax.minTemperature){
+        uiMinMax.minTemperature = sample->temperature;
+    }
+    if(uiMinMax.samples == 0 || sample->temperature > uiMinMax.maxTemperature){
+        uiMinMax.maxTemperature = sample->temperature;
+    }
+    if(uiMinMax.samples == 0 || sample->humidity < uiMinMax.minHumidity){
+        uiMinMax.minHumidity = sample->humidity;
+    }
+    if(uiMinMax.samples == 0 || sample->humidity > uiMinMax.maxHumidity){
+        uiMinMax.maxHumidity = sample->humidity;
+    }
+    uiMinMax.samples++;
+
+    UI_fitGraphSource();
+    SSD_graphAdd(&uiGraph, (uiGraphSource == CMD_GRAPH_HUMIDITY) ? (int32_t)sample->humidity : sample->temperature);
+    UI_powerReading(sample);
+}
+
+/**************************************************************************************
+ * UI Draw Step Function
+ * Draws one value of the page that is up, step counts from 0 for each reading.
+ * Returns 1 once the page has all its values. The graph draws itself as readings
+ * come in and the system page on the refresh timer, they have nothing to do here,
+ * and neither has a display that is off.
+ ***************************************************************************************
+*/
+uint8_t UI_drawStep(uint16_t step){
+    char value[OUT_VALUE_SIZE + 4];
+
+    if(uiPower.state == UI_POWER_OFF){
+        return 1;
+    }
+
+    if(runtimeConfig.displayPage == UI_PAGE_LIVE){
+        if(uiLive[0][0] != '\0'){
+            SSD_printText_6x8(UI_LIVE_COLUMN, (step == 2) ? 4 : step + 1, uiLive[step]);
+        }
+        return step >= 2;
+    }
+    if(runtimeConfig.displayPage != UI_PAGE_MINMAX || uiMinMax.samples == 0){
+        return 1;
+    }
+    switch(step){
+    case 0:
+        OUT_formatValue(value, uiMinMax.minTemperature);
+        SSD_printText_6x8(UI_MINMAX_COLUMN, 2, value);
+        return 0;
+    case 1:
+        OUT_formatValue(value, uiMinMax.maxTemperature);
+        SSD_printText_6x8(UI_MINMAX_COLUMN, 3, value);
+        return 0;
+    case 2:
+        OUT_formatValue(value, uiMinMax.minHumidity);
+        SSD_printText_6x8(UI_MINMAX_COLUMN, 5, value);
+        return 0;
+    case 3:
+        OUT_formatValue(value, uiMinMax.maxHumidity);
+        SSD_printText_6x8(UI_MINMAX_COLUMN, 6, value);
+        return 0;
+    default:
+        snprintf(value, sizeof(value), "%lu", (unsigned long)uiMinMax.samples);
+        SSD_printText_6x8(UI_SAMPLES_COLUMN, 7, value);
+        return 1;
+    }
+}
+
+/**************************************************************************************
+ * UI Refresh Function
+ * Redraws the values of the system page: uptime, the errors of all I2C buses, the
+ * CPU load over the last UI_REFRESH_MS and the bus the display is on
+ ***************************************************************************************
+*/
+void UI_refresh(void){
+    static I2C0_Type *const i2cBuses[I2C_NUM_BUSES] = {I2C0, I2C1, I2C2, I2C3};
+    char value[12];
+    uint32_t seconds = (uint32_t)(BSP_uptimeTicks() / SYS_TICKS_PER_SEC);
+    uint32_t errors = 0;
+    uint8_t i;
+
+    if(runtimeConfig.displayPage != UI_PAGE_SYSTEM || uiPower.state == UI_POWER_OFF){
+        return;
+    }
+    for(i = 0; i < I2C_NUM_BUSES; i++){
+        if(I2C_enabled(i2cBuses[i])){
+            errors += I2C_getStats(i2cBuses[i])->errors;
+        }
+    }
+    snprintf(value, sizeof(value), "%3lu:%02lu:%02lu", (unsigned long)(seconds / 3600U),
+             (unsigned long)(seconds / 60U % 60U), (unsigned long)(seconds % 60U));
+    SSD_printText_6x8(UI_SYSTEM_COLUMN - 7, 2, value);
+    snprintf(value, sizeof(value), "%-8lu", (unsigned long)errors);
+    SSD_printText_6x8(UI_SYSTEM_COLUMN, 3, value);
+    snprintf(value, sizeof(value), "%3u%%", uiStats.cpuLoad);
+    SSD_printText_6x8(UI_SYSTEM_COLUMN, 4, value);
+    SSD_printText_6x8(UI_SYSTEM_COLUMN, 5, (char *)ssdTransport->name);
+}
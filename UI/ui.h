@@ -0,0 +1,99 @@
+/*
+ * ui.h
+ *
+ * Pages of the OLED: live values, minimum and maximum since reset, the graph and
+ * system information. SW1 goes to the next page, SW2 to the previous one, the page
+ * command jumps to one. The labels, titles and lines of every page (its chrome) are
+ * rendered into RAM once by UI_init, so a page switch is a single write of all 8
+ * pages followed by the values of the new page, instead of printing every label
+ * again. The values are drawn one per display event by the OLED sink (UI_drawStep),
+ * the system page is redrawn every UI_REFRESH_MS.
+ *
+ * The display also dims after runtimeConfig.dimSeconds without activity and turns
+ * off after runtimeConfig.offSeconds (ui_power.c). A button press, a command that
+ * shows a page or a reading that moved more than runtimeConfig.wakeDelta from the
+ * last one that woke it turns it back on. While it is off nothing is drawn, the
+ * readings are still taken in and the page is redrawn when it wakes.
+ *
+ * Everything but the refresh callback runs in the display active object or the
+ * main loop.
+ */
+
+#ifndef UI_H_
+#define UI_H_
+
+#include <stdint.h>
+#include "OUTPUT\output.h"
+#include "OLED\SSD1306_graph.h"
+
+#define UI_PAGE_LIVE            0
+#define UI_PAGE_MINMAX          1
+#define UI_PAGE_GRAPH           2
+#define UI_PAGE_SYSTEM          3
+#define UI_NUM_PAGES            4
+
+//Graph of the graph page, under its title
+#define UI_GRAPH_FIRST_PAGE             2
+#define UI_GRAPH_PAGES                  6
+#define UI_GRAPH_MIN_SPAN_TEMPERATURE   100         //1 C
+#define UI_GRAPH_MIN_SPAN_HUMIDITY      200         //2 %rH
+
+#define UI_REFRESH_MS           1000U
+
+//Display power states
+#define UI_POWER_ON             0
+#define UI_POWER_DIM            1
+#define UI_POWER_OFF            2
+
+//What woke the display up
+#define UI_WAKE_BUTTON          0
+#define UI_WAKE_CHANGE          1
+#define UI_WAKE_COMMAND         2
+
+//Dimming fades the contrast down in steps instead of one jump
+#define UI_CONTRAST_ON          SSD_CONTRAST_DEFAULT
+#define UI_CONTRAST_DIM         0x00
+#define UI_DIM_STEPS            8
+#define UI_DIM_STEP_MS          60U
+
+typedef struct
+{
+    uint32_t samples;
+    int32_t  minTemperature;    //0.01 C
+    int32_t  maxTemperature;
+    uint16_t minHumidity;       //0.01 %rH
+    uint16_t maxHumidity;
+} UI_MinMax;
+
+typedef struct
+{
+    uint32_t switches;          //page changes
+    uint32_t switchUs;          //chrome and values of the last page change
+    uint8_t  cpuLoad;           //percent of the last UI_REFRESH_MS not spent idle
+} UI_Stats;
+
+typedef struct
+{
+    uint8_t  state;
+    uint8_t  contrast;
+    uint32_t dims;
+    uint32_t sleeps;
+    uint32_t wakes[3];          //by UI_WAKE_x
+} UI_Power;
+
+extern UI_Stats uiStats;
+extern UI_Power uiPower;
+extern UI_MinMax uiMinMax;
+extern SSD_Graph uiGraph;
+
+void    UI_init(void (*refreshCallback)(void));
+void    UI_show(uint8_t page);
+void    UI_button(uint8_t button);
+void    UI_track(const OUT_Message *message);
+uint8_t UI_drawStep(uint16_t step);
+void    UI_refresh(void);
+void    UI_powerInit(void);
+uint8_t UI_wake(uint8_t reason);
+void    UI_powerReading(const TELEM_Sample *sample);
+
+#endif /* UI_H_ */
@@ -0,0 +1,146 @@
+/*
+ * ui_power.c
+ *
+ * Dimming and sleep of the display, see ui.h
+ */
+
+#include "ui.h"
+#include "COMMAND\command.h"
+#include "OLED\SSD1306_I2C_TivaC.h"
+#include "TIMER\timer_wheel.h"
+
+UI_Power uiPower;
+
+static TW_Timer uiPowerTimer;
+static TW_Timer uiDimTimer;
+static int32_t  uiWakeTemperature;      //reading the change wake compares with
+static uint16_t uiWakeHumidity;
+static uint8_t  uiWakeValid;
+
+static void UI_powerTimerCallback(void *arg);
+
+static void UI_setContrast(uint8_t contrast){
+    if(contrast != uiPower.contrast){
+        SSD_setContrast(contrast);
+        uiPower.contrast = contrast;
+    }
+}
+
+/**************************************************************************************
+ * UI Power Schedule Function
+ * Sets the timer for the next step down from the current state. Both times count
+ * from the last activity, a dim time of 0 or not before the off time skips dimming,
+ * an off time of 0 keeps the display on. They go to ticks without passing through
+ * milliseconds, BSP_MS_TO_TICKS overflows above 4294 s.
+ ***************************************************************************************
+*/
+static uint8_t UI_dims(void){
+    return runtimeConfig.dimSeconds != 0 &&
+           (runtimeConfig.offSeconds == 0 || runtimeConfig.dimSeconds < runtimeConfig.offSeconds);
+}
+
+static void UI_powerSchedule(void){
+    uint32_t dimTicks = (uint32_t)runtimeConfig.dimSeconds * SYS_TICKS_PER_SEC;
+    uint32_t offTicks = (uint32_t)runtimeConfig.offSeconds * SYS_TICKS_PER_SEC;
+    uint8_t dims = UI_dims();
+
+    TW_stop(&uiPowerTimer);
+    if(uiPower.state == UI_POWER_ON && dims){
+        TW_start(&uiPowerTimer, dimTicks, 0, UI_powerTimerCallback, 0);
+    } else if(uiPower.state != UI_POWER_OFF && offTicks != 0){
+        TW_start(&uiPowerTimer, dims ? offTicks - dimTicks : offTicks, 0, UI_powerTimerCallback, 0);
+    }
+}
+
+/**************************************************************************************
+ * UI Power Timer Callbacks
+ * The power timer moves on to dimmed, which starts the fade, or to off. The fade
+ * takes the contrast down a step per UI_DIM_STEP_MS until it is at UI_CONTRAST_DIM.
+ * Turning off hides the graph so it stops drawing, from then on the display gets
+ * no traffic at all until it is woken up.
+ ***************************************************************************************
+*/
+static void UI_dimTimerCallback(void *arg){
+    uint8_t step = (UI_CONTRAST_ON - UI_CONTRAST_DIM + UI_DIM_STEPS - 1) / UI_DIM_STEPS;
+
+    if(uiPower.contrast <= UI_CONTRAST_DIM + step){
+        UI_setContrast(UI_CONTRAST_DIM);
+        TW_stop(&uiDimTimer);
+    } else {
+        UI_setContrast(uiPower.contrast - step);
+    }
+}
+
+static void UI_powerTimerCallback(void *arg){
+    if(uiPower.state == UI_POWER_ON && UI_dims()){
+        uiPower.state = UI_POWER_DIM;
+        uiPower.dims++;
+        TW_start(&uiDimTimer, BSP_MS_TO_TICKS(UI_DIM_STEP_MS), BSP_MS_TO_TICKS(UI_DIM_STEP_MS), UI_dimTimerCallback, 0);
+        UI_powerSchedule();
+    } else if(uiPower.state != UI_POWER_OFF){
+        TW_stop(&uiDimTimer);
+        SSD_graphShow(&uiGraph, 0);
+        SSD_setDisplayOn(0);
+        uiPower.state = UI_POWER_OFF;
+        uiPower.sleeps++;
+    }
+}
+
+/**************************************************************************************
+ * UI Power Initialize Function
+ * The display is on at full contrast after SSD_start, starts counting inactivity
+ ***************************************************************************************
+*/
+void UI_powerInit(void){
+    uiPower.state = UI_POWER_ON;
+    uiPower.contrast = UI_CONTRAST_ON;
+    uiWakeValid = 0;
+    UI_powerSchedule();
+}
+
+/**************************************************************************************
+ * UI Wake Function
+ * Called on every activity: turns the display back on at full contrast and starts
+ * counting inactivity again, also with changed settings. Returns 1 if it was off,
+ * the caller then has to redraw the page (UI_show), nothing was drawn meanwhile.
+ ***************************************************************************************
+*/
+uint8_t UI_wake(uint8_t reason){
+    uint8_t wasOff = (uiPower.state == UI_POWER_OFF);
+
+    TW_stop(&uiDimTimer);
+    if(wasOff){
+        SSD_setDisplayOn(1);
+        uiPower.wakes[reason]++;
+    }
+    uiPower.state = UI_POWER_ON;
+    UI_setContrast(UI_CONTRAST_ON);
+    UI_powerSchedule();
+    return wasOff;
+}
+
+/**************************************************************************************
+ * UI Power Reading Function
+ * Wakes the display when the temperature (0.01 C) or humidity (0.01 %rH) moved more
+ * than runtimeConfig.wakeDelta from the reading that last did so, 0 turns this off.
+ * A slow drift wakes it once it adds up to the delta.
+ ***************************************************************************************
+*/
+void UI_powerReading(const TELEM_Sample *sample){
+    int32_t temperatureChange = sample->temperature - uiWakeTemperature;
+    int32_t humidityChange = (int32_t)sample->humidity - uiWakeHumidity;
+
+    if(uiWakeValid && runtimeConfig.wakeDelta != 0 &&
+       (temperatureChange > runtimeConfig.wakeDelta || -temperatureChange > runtimeConfig.wakeDelta ||
+        humidityChange > runtimeConfig.wakeDelta || -humidityChange > runtimeConfig.wakeDelta)){
+        uiWakeValid = 0;
+        if(UI_wake(UI_WAKE_CHANGE)){
+            UI_show(runtimeConfig.displayPage);
+        }
+    }
+    if(!uiWakeValid){
+        uiWakeTemperature = sample->temperature;
+        uiWakeHumidity = sample->humidity;
+        uiWakeValid = 1;
+    }
+}
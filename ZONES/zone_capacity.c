@@ -0,0 +1,36 @@
+/*
+ * zone_capacity.c
+ *
+ * Bus time and capacity of the zone sampling, see zone_capacity.h
+ */
+
+#include "zone_capacity.h"
+
+/**************************************************************************************
+ * Zone Capacity Functions
+ * ZONE_slotUsAt is the time one slot keeps the bus at busHz. ZONE_maxSensorsAt is
+ * how many sensors the bus can sample at rateMilliHz each: as many slots as fit in
+ * the period, or none if the period does not leave a conversion between the end of
+ * a slot (the trigger) and the same slot one period later (the read).
+ ***************************************************************************************
+*/
+uint32_t ZONE_slotUsAt(uint32_t busHz){
+    if(busHz == 0){
+        return 0;
+    }
+    return (ZONE_SLOT_CLOCKS * 1000000U + busHz - 1U) / busHz + ZONE_SLOT_OVERHEAD_US;
+}
+
+uint32_t ZONE_maxSensorsAt(uint32_t rateMilliHz, uint32_t busHz){
+    uint32_t periodUs;
+    uint32_t slotUs = ZONE_slotUsAt(busHz);
+
+    if(rateMilliHz == 0 || slotUs == 0){
+        return 0;
+    }
+    periodUs = 1000000000U / rateMilliHz;
+    if(periodUs < ZONE_CONVERSION_US + slotUs){
+        return 0;
+    }
+    return periodUs / slotUs;
+}
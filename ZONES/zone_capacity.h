@@ -0,0 +1,35 @@
+/*
+ * zone_capacity.h
+ *
+ * Bus time of the zone sampling slots (zones.h) and how many sensors fit on a bus,
+ * at a bus speed in Hz. Plain arithmetic with no hardware behind it, so the host
+ * model of the slot schedule (host/zone_schedule.c) can check it.
+ */
+
+#ifndef ZONE_CAPACITY_H_
+#define ZONE_CAPACITY_H_
+
+#include <stdint.h>
+
+//Forced conversion at x1 temperature, pressure and humidity, datasheet section 9.1
+#define ZONE_CONVERSION_US      9300U
+
+/*
+ * Bus clocks of one slot at 9 per byte: the mux select (address and channel mask,
+ * start and stop), the burst read (address, register, address, 5 bytes, start,
+ * repeated start and stop) and the trigger (address, register, value, start and
+ * stop)
+ */
+#define ZONE_SLOT_CLOCKS        ((2U * 9U + 2U) + (8U * 9U + 3U) + (3U * 9U + 2U))
+
+/*
+ * Time the bus waits besides the clocks: the interrupt between the 13 bytes of a
+ * slot, about 4 us each, and the bus free time before each of the 3 starts (4.7 us
+ * at 100 kHz)
+ */
+#define ZONE_SLOT_OVERHEAD_US   70U
+
+uint32_t    ZONE_slotUsAt(uint32_t busHz);
+uint32_t    ZONE_maxSensorsAt(uint32_t rateMilliHz, uint32_t busHz);
+
+#endif /* ZONE_CAPACITY_H_ */
@@ -0,0 +1,205 @@
+/*
+ * zones.c
+ *
+ * Round-robin sampling of the BME280 sensors behind the multiplexer, see zones.h
+ */
+
+#include "zones.h"
+#include "BSP\bsp.h"
+#include "TIMER\timer_wheel.h"
+
+//ctrl_meas of the zone sensors: x1 temperature and pressure, sleep or forced
+#define ZONE_CTRL_MEAS(mode)    ((BME280_OSRS_X1 << 5) | (BME280_OSRS_X1 << 2) | (mode))
+
+ZONE_Stats zoneStats;
+
+static ZONE_Sensor      zones[ZONE_MAX_SENSORS];
+static uint8_t          zoneCount;
+static uint8_t          zoneNext;
+static uint32_t         zonePeriodMs;
+static TW_Timer         zoneTimer;
+
+static const uint8_t    zoneDataRegister = BME280_REGISTER_TEMPDATA;
+static const uint8_t    zoneTrigger[2] = {BME280_REGISTER_CONTROL, ZONE_CTRL_MEAS(BME280_MODE_FORCED)};
+
+/**************************************************************************************
+ * Zone Add Function
+ * Checks the chip ID of the sensor at device on a bus, reads its calibration and
+ * sets its oversampling, then adds it to the round. Returns the I2C status,
+ * I2C_STATUS_ERROR if the chip is no BME280/BMP280 or all zones are taken. Sensors
+ * can only be added while sampling is stopped.
+ ***************************************************************************************
+*/
+uint8_t ZONE_add(I2C0_Type *bus, uint16_t device){
+    ZONE_Sensor *zone;
+    uint8_t config[4] = {BME280_REGISTER_CONTROLHUMID, BME280_OSRS_X1,
+                         BME280_REGISTER_CONTROL, ZONE_CTRL_MEAS(BME280_MODE_SLEEP)};
+    uint8_t status;
+
+    if(zoneCount >= ZONE_MAX_SENSORS || zonePeriodMs != 0){
+        return I2C_STATUS_ERROR;
+    }
+    zone = &zones[zoneCount];
+    zone->bus = bus;
+    zone->device = device;
+
+    status = I2C_Read8(bus, device, BME280_REGISTER_CHIPID, &zone->chipId);
+    if(status != I2C_STATUS_DONE){
+        return status;
+    }
+    if(zone->chipId != BME280_CHIP_ID && zone->chipId != BMP280_CHIP_ID){
+        return I2C_STATUS_ERROR;
+    }
+    status = BME280_readCalibration(bus, device, zone->chipId, &zone->cal);
+    if(status == I2C_STATUS_DONE){
+        status = I2C_Write(bus, device, config, sizeof(config));
+    }
+    if(status != I2C_STATUS_DONE){
+        return status;
+    }
+
+    zone->triggered = 0;
+    zone->samples = 0;
+    zone->errors = 0;
+    zone->overruns = 0;
+    zone->read.status = I2C_STATUS_IDLE;
+    zone->trigger.status = I2C_STATUS_IDLE;
+    zoneCount++;
+    return I2C_STATUS_DONE;
+}
+
+uint8_t ZONE_count(void){
+    return zoneCount;
+}
+
+const ZONE_Sensor *ZONE_get(uint8_t index){
+    return (index < zoneCount) ? &zones[index] : 0;
+}
+
+uint32_t ZONE_periodMs(void){
+    return zonePeriodMs;
+}
+
+/**************************************************************************************
+ * Zone Transaction Callbacks
+ * Called from the I2C interrupt. A good read is compensated with the coefficients of
+ * its own sensor, a failed trigger means the next read would return an old
+ * conversion, so that read is skipped.
+ ***************************************************************************************
+*/
+static void ZONE_readDone(I2C_Transaction *transaction){
+    ZONE_Sensor *zone = (ZONE_Sensor *)transaction->arg;
+    BME280_Result result;
+
+    if(transaction->status != I2C_STATUS_DONE){
+        zone->errors++;
+        return;
+    }
+    BME280_compensateWith(&zone->cal, zone->burst, &result);
+    zone->temperature = result.temperature;
+    zone->humidity = result.humidity;
+    zone->samples++;
+}
+
+static void ZONE_triggerDone(I2C_Transaction *transaction){
+    ZONE_Sensor *zone = (ZONE_Sensor *)transaction->arg;
+
+    if(transaction->status != I2C_STATUS_DONE){
+        zone->errors++;
+        zone->triggered = 0;
+    }
+}
+
+/**************************************************************************************
+ * Zone Slot Function
+ * Timer wheel callback, one per sensor and period. Queues the read of the last
+ * conversion and the next trigger for the sensor whose turn it is, and sets the
+ * timer for the next slot. The slots are spread over the period so their lengths
+ * add up to it exactly, however it divides.
+ ***************************************************************************************
+*/
+static void ZONE_slot(void *arg){
+    uint32_t periodTicks = BSP_MS_TO_TICKS(zonePeriodMs);
+    ZONE_Sensor *zone = &zones[zoneNext];
+    uint8_t next = zoneNext + 1;
+
+    TW_start(&zoneTimer, (next * periodTicks) / zoneCount - (zoneNext * periodTicks) / zoneCount, 0, ZONE_slot, 0);
+    zoneNext = (next < zoneCount) ? next : 0;
+    zoneStats.slots++;
+
+    if(zone->read.status == I2C_STATUS_PENDING || zone->trigger.status == I2C_STATUS_PENDING){
+        zone->overruns++;
+        zoneStats.overruns++;
+        I2C_checkTimeout(zone->bus);
+        return;
+    }
+
+    if(zone->triggered){
+        zone->read.address = zone->device;
+        zone->read.txData = &zoneDataRegister;
+        zone->read.txLength = 1;
+        zone->read.rxData = zone->burst;
+        zone->read.rxLength = BME280_BURST_LENGTH;
+        zone->read.callback = ZONE_readDone;
+        zone->read.arg = zone;
+        I2C_submit(zone->bus, &zone->read);
+    }
+    zone->triggered = 1;
+    zone->trigger.address = zone->device;
+    zone->trigger.txData = zoneTrigger;
+    zone->trigger.txLength = sizeof(zoneTrigger);
+    zone->trigger.rxData = 0;
+    zone->trigger.rxLength = 0;
+    zone->trigger.callback = ZONE_triggerDone;
+    zone->trigger.arg = zone;
+    I2C_submit(zone->bus, &zone->trigger);
+}
+
+/**************************************************************************************
+ * Zone Start and Stop Functions
+ * Samples every sensor once per periodMs. The period has to leave a conversion time
+ * after a slot and fit one slot per sensor at the bus speed of the slowest sensor,
+ * otherwise nothing is started and 0 is returned.
+ ***************************************************************************************
+*/
+uint8_t ZONE_start(uint32_t periodMs){
+    uint32_t slotUs = 0;
+    uint8_t i;
+
+    for(i = 0; i < zoneCount; i++){
+        if(ZONE_slotUs(I2C_getSpeed(zones[i].bus, zones[i].device)) > slotUs){
+            slotUs = ZONE_slotUs(I2C_getSpeed(zones[i].bus, zones[i].device));
+        }
+    }
+    if(zoneCount == 0 || periodMs * 1000U < ZONE_CONVERSION_US + slotUs ||
+       periodMs * 1000U < slotUs * zoneCount || BSP_MS_TO_TICKS(periodMs) < zoneCount){
+        return 0;
+    }
+
+    zonePeriodMs = periodMs;
+    zoneNext = 0;
+    TW_start(&zoneTimer, BSP_MS_TO_TICKS(periodMs) / zoneCount, 0, ZONE_slot, 0);
+    return 1;
+}
+
+void ZONE_stop(void){
+    TW_stop(&zoneTimer);
+    zonePeriodMs = 0;
+}
+
+/**************************************************************************************
+ * Zone Capacity Functions
+ * ZONE_slotUs and ZONE_maxSensors at an I2C speed, see zone_capacity.c. The display
+ * and the main sensor share the bus, their traffic comes off this. The wiring
+ * allows ZONE_MAX_SENSORS per mux on top of it.
+ *  100 kHz: 1310 us a slot, 15 sensors at 50 Hz
+ *  400 kHz:  380 us a slot, 52 sensors at 50 Hz
+ ***************************************************************************************
+*/
+uint32_t ZONE_slotUs(uint8_t speed){
+    return ZONE_slotUsAt(I2C_speedHz(speed));
+}
+
+uint32_t ZONE_maxSensors(uint32_t rateMilliHz, uint8_t speed){
+    return ZONE_maxSensorsAt(rateMilliHz, I2C_speedHz(speed));
+}
@@ -0,0 +1,66 @@
+/*
+ * zones.h
+ *
+ * Extra BME280 sensors behind a TCA9548A multiplexer, one per zone. Each sensor is
+ * addressed as I2C_MUX_DEVICE(channel, address), so up to ZONE_MAX_SENSORS (two
+ * addresses on each of the eight channels) share one controller with the main
+ * sensor and the display.
+ *
+ * The sensors are sampled round-robin from the timer wheel. The period is split into
+ * one slot per sensor and each slot, on the channel of its sensor:
+ *
+ *  reads the conversion triggered one period earlier (5 byte burst)
+ *  triggers the next forced conversion
+ *
+ * Both are queued back to back, so the mux is selected once per slot. Every sensor
+ * is therefore read exactly once per period, and a conversion has a period less a
+ * slot to finish. The zone sensors run at x1 oversampling (ZONE_CONVERSION_US).
+ */
+
+#ifndef ZONES_H_
+#define ZONES_H_
+
+#include <stdint.h>
+#include "I2C\i2c.h"
+#include "BME280\BME280_I2C.h"
+#include "zone_capacity.h"
+
+#define ZONE_MAX_SENSORS        (I2C_MUX_CHANNELS * 2)
+
+typedef struct
+{
+    I2C0_Type           *bus;
+    uint16_t            device;         //I2C_MUX_DEVICE or a 7-bit address
+    uint8_t             chipId;
+    uint8_t             triggered;      //a conversion was started last period
+    struct BME280_Calibration_Data cal;
+
+    I2C_Transaction     read;
+    I2C_Transaction     trigger;
+    uint8_t             burst[BME280_BURST_LENGTH];
+
+    volatile int32_t    temperature;    //0.01 degC, last good sample
+    volatile uint16_t   humidity;       //0.01 %rH
+    volatile uint32_t   samples;
+    volatile uint32_t   errors;         //failed reads and triggers
+    uint32_t            overruns;       //slots skipped, the last one was still on the bus
+} ZONE_Sensor;
+
+typedef struct
+{
+    uint32_t slots;
+    uint32_t overruns;
+} ZONE_Stats;
+
+extern ZONE_Stats zoneStats;
+
+uint8_t     ZONE_add(I2C0_Type *bus, uint16_t device);
+uint8_t     ZONE_count(void);
+const ZONE_Sensor *ZONE_get(uint8_t index);
+uint8_t     ZONE_start(uint32_t periodMs);
+void        ZONE_stop(void);
+uint32_t    ZONE_periodMs(void);
+uint32_t    ZONE_slotUs(uint8_t speed);
+uint32_t    ZONE_maxSensors(uint32_t rateMilliHz, uint8_t speed);
+
+#endif /* ZONES_H_ */
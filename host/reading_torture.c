@@ -0,0 +1,125 @@
+/*
+ * reading_torture.c
+ *
+ * PC torture test of the seqlock in READING/reading.c: a writer thread publishes
+ * readings as fast as it can while reader threads take snapshots. Every field of
+ * a published reading is derived from one number, so a snapshot mixing two
+ * readings (a torn read) shows up as fields that do not agree. The readers also
+ * check that the count never goes backwards and matches the reading.
+ *
+ * Build from the repository root:
+ *   gcc -O2 -pthread -DHOST_TEST -I. host/reading_torture.c READING/reading.c -o reading_torture
+ *
+ * Exits with 0 if no reader saw a torn or stale snapshot.
+ */
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include "READING/reading.h"
+
+#define TORTURE_READINGS    3000000U
+#define TORTURE_READERS     3
+
+typedef struct
+{
+    uint32_t snapshots;
+    uint32_t torn;
+    uint32_t backwards;
+} TORTURE_Reader;
+
+static volatile uint8_t tortureDone;
+
+//Reading number n, count is filled in by READING_publish and is n + 1
+static void TORTURE_make(READING_Data *data, uint32_t n){
+    data->count = 0;
+    data->temperature = (int32_t)n;
+    data->temperatureF = -(int32_t)n;
+    data->humidity = (uint16_t)n;
+    data->adcT = n ^ 0xA5A5A5A5U;
+    data->adcH = (uint16_t)(n >> 16);
+    data->tFine = (int32_t)(n * 3U);
+    data->conversionUs = (uint64_t)n << 32 | n;
+    data->readUs = ~((uint64_t)n << 32 | n);
+}
+
+static int TORTURE_consistent(const READING_Data *data){
+    uint32_t n = (uint32_t)data->temperature;
+
+    return data->count == n + 1 && data->temperatureF == -(int32_t)n && data->humidity == (uint16_t)n &&
+           data->adcT == (n ^ 0xA5A5A5A5U) && data->adcH == (uint16_t)(n >> 16) &&
+           data->tFine == (int32_t)(n * 3U) && data->conversionUs == ((uint64_t)n << 32 | n) &&
+           data->readUs == ~((uint64_t)n << 32 | n);
+}
+
+/**************************************************************************************
+ * Writer and Reader Threads
+ * The writer yields now and then so the readers also get to run on a single core,
+ * half of the time in the middle of a publish
+ ***************************************************************************************
+*/
+static void *TORTURE_writer(void *arg){
+    READING_Data data;
+    uint32_t n;
+
+    for(n = 0; n < TORTURE_READINGS; n++){
+        TORTURE_make(&data, n);
+        READING_publish(&data);
+        if((n & 0x3FF) == 0){
+            sched_yield();
+        }
+    }
+    tortureDone = 1;
+    return 0;
+}
+
+static void *TORTURE_readerThread(void *arg){
+    TORTURE_Reader *reader = arg;
+    READING_Data data;
+    uint32_t last = 0;
+
+    while(!tortureDone){
+        if(!READING_get(&data)){
+            continue;
+        }
+        reader->snapshots++;
+        if(!TORTURE_consistent(&data)){
+            reader->torn++;
+        }
+        if(data.count < last){
+            reader->backwards++;
+        }
+        last = data.count;
+    }
+    return 0;
+}
+
+int main(void){
+    static TORTURE_Reader readers[TORTURE_READERS];
+    pthread_t readerThreads[TORTURE_READERS];
+    pthread_t writerThread;
+    READING_Data data;
+    uint32_t errors = 0;
+    uint8_t i;
+
+    //Nothing published yet
+    errors += READING_get(&data) != 0 || READING_count() != 0;
+
+    for(i = 0; i < TORTURE_READERS; i++){
+        pthread_create(&readerThreads[i], 0, TORTURE_readerThread, &readers[i]);
+    }
+    pthread_create(&writerThread, 0, TORTURE_writer, 0);
+    pthread_join(writerThread, 0);
+    for(i = 0; i < TORTURE_READERS; i++){
+        pthread_join(readerThreads[i], 0);
+        printf("reader %u: %u snapshots, %u torn, %u out of order\n", i, (unsigned)readers[i].snapshots,
+               (unsigned)readers[i].torn, (unsigned)readers[i].backwards);
+        errors += readers[i].torn + readers[i].backwards;
+    }
+
+    //The last reading is what a reader gets once the writer is done
+    errors += !READING_get(&data) || !TORTURE_consistent(&data) || data.count != TORTURE_READINGS ||
+              READING_count() != TORTURE_READINGS;
+    printf(errors ? "FAILED\n" : "passed\n");
+    return errors != 0;
+}
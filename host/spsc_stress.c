@@ -0,0 +1,211 @@
+/*
+ * spsc_stress.c
+ *
+ * PC stress test of QUEUE/spsc_queue.c: a producer and a consumer thread hand
+ * numbered elements through a small queue, so it runs full and empty all the time.
+ * The consumer checks that every element arrives once, in order and complete. Each
+ * round starts the free running indexes at a different point, one of them just
+ * before they wrap. The byte functions and reserve/commit, peek/release get the
+ * same treatment.
+ *
+ * Build from the repository root:
+ *   gcc -O2 -pthread -DHOST_TEST -I. host/spsc_stress.c QUEUE/spsc_queue.c -o spsc_stress
+ *
+ * Exits with 0 if every round passed.
+ */
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+#include "QUEUE/spsc_queue.h"
+
+#define STRESS_CAPACITY     16
+#define STRESS_ELEMENTS     2000000U
+
+typedef struct
+{
+    uint32_t number;
+    uint32_t check;             //~number, a torn element does not match
+    uint8_t  fill[24];          //number & 0xFF in every byte
+} STRESS_Element;
+
+typedef struct
+{
+    SPSC_Queue  queue;
+    uint8_t     inPlace;        //use reserve/commit and peek/release
+    uint32_t    errors;
+} STRESS_Test;
+
+static void STRESS_make(STRESS_Element *element, uint32_t number){
+    element->number = number;
+    element->check = ~number;
+    memset(element->fill, number & 0xFF, sizeof(element->fill));
+}
+
+static int STRESS_valid(const STRESS_Element *element, uint32_t number){
+    uint8_t i;
+
+    if(element->number != number || element->check != ~number){
+        return 0;
+    }
+    for(i = 0; i < sizeof(element->fill); i++){
+        if(element->fill[i] != (number & 0xFF)){
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**************************************************************************************
+ * Element Threads
+ * The producer spins while the queue is full, the consumer while it is empty
+ ***************************************************************************************
+*/
+static void *STRESS_producer(void *arg){
+    STRESS_Test *test = arg;
+    STRESS_Element element;
+    STRESS_Element *slot;
+    uint32_t number;
+
+    for(number = 0; number < STRESS_ELEMENTS; number++){
+        if(test->inPlace){
+            while((slot = SPSC_reserve(&test->queue)) == 0){
+                sched_yield();
+            }
+            STRESS_make(slot, number);
+            SPSC_commit(&test->queue);
+        } else {
+            STRESS_make(&element, number);
+            while(!SPSC_push(&test->queue, &element)){
+                sched_yield();
+            }
+        }
+    }
+    return 0;
+}
+
+static void *STRESS_consumer(void *arg){
+    STRESS_Test *test = arg;
+    STRESS_Element element;
+    const STRESS_Element *slot;
+    uint32_t number;
+
+    for(number = 0; number < STRESS_ELEMENTS; number++){
+        if(test->inPlace){
+            while((slot = SPSC_peek(&test->queue)) == 0){
+                sched_yield();
+            }
+            if(!STRESS_valid(slot, number)){
+                test->errors++;
+            }
+            SPSC_release(&test->queue);
+        } else {
+            while(!SPSC_pop(&test->queue, &element)){
+                sched_yield();
+            }
+            if(!STRESS_valid(&element, number)){
+                test->errors++;
+            }
+        }
+        if(SPSC_count(&test->queue) > STRESS_CAPACITY){
+            test->errors++;
+        }
+    }
+    if(SPSC_count(&test->queue) != 0){
+        test->errors++;
+    }
+    return 0;
+}
+
+/**************************************************************************************
+ * Byte Threads
+ * Same for the byte functions of the UART rings, the bytes count up and wrap
+ ***************************************************************************************
+*/
+static void *STRESS_byteProducer(void *arg){
+    STRESS_Test *test = arg;
+    uint32_t number;
+
+    for(number = 0; number < STRESS_ELEMENTS; number++){
+        while(!SPSC_pushByte(&test->queue, (uint8_t)number)){
+            sched_yield();
+        }
+    }
+    return 0;
+}
+
+static void *STRESS_byteConsumer(void *arg){
+    STRESS_Test *test = arg;
+    uint32_t number;
+    uint8_t byte;
+
+    for(number = 0; number < STRESS_ELEMENTS; number++){
+        while(!SPSC_popByte(&test->queue, &byte)){
+            sched_yield();
+        }
+        if(byte != (uint8_t)number){
+            test->errors++;
+        }
+    }
+    return 0;
+}
+
+/**************************************************************************************
+ * Round Function
+ * Runs one producer and one consumer to the end. start is where head and tail begin,
+ * a start close to 2^32 makes them wrap during the round.
+ ***************************************************************************************
+*/
+static uint32_t STRESS_round(const char *name, void *(*producer)(void *), void *(*consumer)(void *),
+                             uint16_t elementSize, uint8_t inPlace, uint32_t start){
+    static uint8_t buffer[STRESS_CAPACITY * sizeof(STRESS_Element)];
+    STRESS_Test test;
+    pthread_t producerThread;
+    pthread_t consumerThread;
+
+    memset(&test, 0, sizeof(test));
+    if(!SPSC_init(&test.queue, buffer, elementSize, STRESS_CAPACITY)){
+        printf("%-24s init failed\n", name);
+        return 1;
+    }
+    test.queue.head = start;
+    test.queue.tail = start;
+    test.inPlace = inPlace;
+
+    pthread_create(&consumerThread, 0, consumer, &test);
+    pthread_create(&producerThread, 0, producer, &test);
+    pthread_join(producerThread, 0);
+    pthread_join(consumerThread, 0);
+
+    printf("%-24s start 0x%08X: %u elements, %u errors\n", name, (unsigned)start,
+           (unsigned)STRESS_ELEMENTS, (unsigned)test.errors);
+    return test.errors;
+}
+
+int main(void){
+    static const uint32_t starts[] = {0, 0xFFFFFFFFU - STRESS_ELEMENTS / 2};
+    STRESS_Element element;
+    SPSC_Queue queue;
+    uint8_t buffer[4 * sizeof(STRESS_Element)];
+    uint32_t errors = 0;
+    uint8_t i;
+
+    //Sizes that are not a power of two are refused, a full queue takes nothing more
+    if(SPSC_init(&queue, buffer, sizeof(STRESS_Element), 3) || !SPSC_init(&queue, buffer, sizeof(STRESS_Element), 4)){
+        errors++;
+    }
+    STRESS_make(&element, 0);
+    for(i = 0; i < 4; i++){
+        errors += !SPSC_push(&queue, &element);
+    }
+    errors += SPSC_push(&queue, &element) || SPSC_reserve(&queue) != 0 || SPSC_free(&queue) != 0;
+
+    for(i = 0; i < sizeof(starts) / sizeof(starts[0]); i++){
+        errors += STRESS_round("push/pop", STRESS_producer, STRESS_consumer, sizeof(STRESS_Element), 0, starts[i]);
+        errors += STRESS_round("reserve/commit", STRESS_producer, STRESS_consumer, sizeof(STRESS_Element), 1, starts[i]);
+        errors += STRESS_round("pushByte/popByte", STRESS_byteProducer, STRESS_byteConsumer, 1, 0, starts[i]);
+    }
+    printf(errors ? "FAILED\n" : "passed\n");
+    return errors != 0;
+}
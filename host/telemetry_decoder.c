@@ -0,0 +1,91 @@
+/*
+ * telemetry_decoder.c
+ *
+ * PC side decoder for the binary telemetry stream, see telemetry_decoder.h
+ */
+
+#include "telemetry_decoder.h"
+
+void TD_init(TD_Decoder *dec){
+    dec->rawLength = 0;
+    dec->overflow = 0;
+    dec->haveSequence = 0;
+    dec->lastSequence = 0;
+    dec->frames = 0;
+    dec->crcErrors = 0;
+    dec->framingErrors = 0;
+    dec->lostFrames = 0;
+}
+
+/**************************************************************************************
+ * Decode Frame Function
+ * Called with the bytes between two delimiters. Returns 1 if they hold a valid frame.
+ ***************************************************************************************
+*/
+static int TD_decodeFrame(TD_Decoder *dec, TD_Frame *frame){
+    uint16_t length = TELEM_cobsDecode(dec->raw, dec->rawLength, dec->payload);
+    uint16_t crc;
+
+    if(length < TELEM_HEADER_SIZE + TELEM_CRC_SIZE){
+        dec->framingErrors++;
+        return 0;
+    }
+    length -= TELEM_CRC_SIZE;
+    crc = (uint16_t)(dec->payload[length] | (dec->payload[length + 1] << 8));
+    if(crc != TELEM_crc16(dec->payload, length)){
+        dec->crcErrors++;
+        return 0;
+    }
+
+    TELEM_unpackHeader(dec->payload, &frame->header);
+    if(frame->header.version != TELEM_VERSION){
+        dec->framingErrors++;
+        return 0;
+    }
+    frame->body = &dec->payload[TELEM_HEADER_SIZE];
+    frame->bodyLength = length - TELEM_HEADER_SIZE;
+    if(frame->header.type == TELEM_TYPE_SAMPLE){
+        if(length < TELEM_SAMPLE_SIZE){
+            dec->framingErrors++;
+            return 0;
+        }
+        TELEM_unpackSample(frame->body, &frame->sample);
+    }
+
+    if(dec->haveSequence){
+        dec->lostFrames += (uint16_t)(frame->header.sequence - dec->lastSequence - 1);
+    }
+    dec->lastSequence = frame->header.sequence;
+    dec->haveSequence = 1;
+    dec->frames++;
+    return 1;
+}
+
+/**************************************************************************************
+ * Feed Function
+ * Adds one received byte. Returns 1 when the byte completed a valid frame, which is
+ * then stored in frame. The frame body points into the decoder and stays valid until
+ * the next call.
+ ***************************************************************************************
+*/
+int TD_feed(TD_Decoder *dec, uint8_t byte, TD_Frame *frame){
+    int valid = 0;
+
+    if(byte != TELEM_DELIMITER){
+        if(dec->rawLength < sizeof(dec->raw)){
+            dec->raw[dec->rawLength++] = byte;
+        } else {
+            dec->overflow = 1;
+        }
+        return 0;
+    }
+
+    if(dec->overflow){
+        dec->framingErrors++;
+    } else if(dec->rawLength > 0){
+        valid = TD_decodeFrame(dec, frame);
+    }
+    dec->rawLength = 0;
+    dec->overflow = 0;
+    return valid;
+}
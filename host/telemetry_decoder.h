@@ -0,0 +1,46 @@
+/*
+ * telemetry_decoder.h
+ *
+ * PC side decoder for the binary telemetry stream sent on UART0. Feed it the
+ * bytes read from the serial port one at a time, it splits them on the 0x00
+ * delimiter, undoes the COBS encoding and checks the CRC before handing back a
+ * frame. Log block frames can be expanded with TSC_decoderInit/TSC_decodeSample
+ * from CODEC/ts_codec.h.
+ *
+ * Build together with TELEMETRY/telemetry_protocol.c (and CODEC/ts_codec.c for
+ * log blocks) using the repository root as include path.
+ */
+
+#ifndef TELEMETRY_DECODER_H_
+#define TELEMETRY_DECODER_H_
+
+#include <stdint.h>
+#include "TELEMETRY/telemetry_protocol.h"
+
+typedef struct
+{
+    TELEM_Header    header;
+    TELEM_Sample    sample;         //valid for TELEM_TYPE_SAMPLE
+    const uint8_t   *body;          //frame body after the header
+    uint16_t        bodyLength;
+} TD_Frame;
+
+typedef struct
+{
+    uint8_t     raw[TELEM_MAX_FRAME];
+    uint8_t     payload[TELEM_MAX_FRAME];
+    uint16_t    rawLength;
+    uint8_t     overflow;
+    uint8_t     haveSequence;
+    uint16_t    lastSequence;
+
+    uint32_t    frames;             //valid frames decoded
+    uint32_t    crcErrors;
+    uint32_t    framingErrors;      //bad COBS, too long, too short or unknown version
+    uint32_t    lostFrames;         //gaps in the sequence number
+} TD_Decoder;
+
+void    TD_init(TD_Decoder *dec);
+int     TD_feed(TD_Decoder *dec, uint8_t byte, TD_Frame *frame);
+
+#endif /* TELEMETRY_DECODER_H_ */
@@ -0,0 +1,241 @@
+/*
+ * ts_codec_test.c
+ *
+ * PC round-trip test and benchmark of CODEC/ts_codec.c. Blocks of random walks
+ * like the sensor readings, of extreme deltas (values and timestamps jumping
+ * between the ends of their range) and of random values are encoded and decoded
+ * again, every sample has to come back as it went in. Each block is then cut
+ * short at every length and its sample count raised: the decoder has to refuse
+ * the block or stop early, without reading past the buffer. The buffers are
+ * allocated to their exact size, so with -fsanitize=address any read past the
+ * end stops the test.
+ *
+ * Build from the repository root:
+ *   gcc -O2 -fsanitize=address,undefined -DHOST_TEST -I. host/ts_codec_test.c CODEC/ts_codec.c -o ts_codec_test
+ *
+ * Exits with 0 if every check passed. Leave out the sanitizers for the benchmark
+ * figures.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "CODEC/ts_codec.h"
+#include "LOG/sample_log.h"
+
+#define TEST_BLOCK_SIZE     LOG_BLOCK_SIZE
+#define TEST_MAX_SAMPLES    4096
+#define TEST_BENCH_BLOCKS   20000
+
+#define TEST_WALK           0
+#define TEST_EXTREME        1
+#define TEST_RANDOM         2
+
+typedef struct
+{
+    uint32_t timestamp;
+    int32_t  values[TSC_MAX_CHANNELS];
+} TEST_Sample;
+
+static TEST_Sample  testSamples[TEST_MAX_SAMPLES];
+static uint32_t     testErrors;
+static uint32_t     testSeed = 0x2545F491U;
+
+//xorshift32, the same sequence on every run
+static uint32_t TEST_random(void){
+    testSeed ^= testSeed << 13;
+    testSeed ^= testSeed >> 17;
+    testSeed ^= testSeed << 5;
+    return testSeed;
+}
+
+static void TEST_check(int passed, const char *what, uint32_t detail){
+    if(!passed){
+        if(testErrors < 20){
+            printf("  failed: %s (%u)\n", what, (unsigned)detail);
+        }
+        testErrors++;
+    }
+}
+
+/**************************************************************************************
+ * Sample Generator Function
+ * Fills testSamples with count samples of the given kind. Walks step around a
+ * start value at a sample period with a little jitter, like temperature, pressure
+ * and humidity at 3.5 s.
+ ***************************************************************************************
+*/
+static void TEST_generate(uint8_t kind, uint16_t count, uint8_t channels){
+    static const int32_t extremes[] = {INT32_MIN, INT32_MAX, 0, -1, 1, INT32_MIN + 1, INT32_MAX - 1};
+    uint32_t timestamp = TEST_random();
+    uint16_t i;
+    uint8_t c;
+
+    for(c = 0; c < channels; c++){
+        testSamples[0].values[c] = (int32_t)(TEST_random() % 100000U);
+    }
+    for(i = 0; i < count; i++){
+        if(kind == TEST_EXTREME){
+            timestamp = (uint32_t)extremes[TEST_random() % 7];
+        } else if(kind == TEST_RANDOM){
+            timestamp = TEST_random();
+        } else {
+            timestamp += 3500U + TEST_random() % 5U - 2U;
+        }
+        testSamples[i].timestamp = timestamp;
+        for(c = 0; c < channels; c++){
+            if(kind == TEST_EXTREME){
+                testSamples[i].values[c] = extremes[TEST_random() % 7];
+            } else if(kind == TEST_RANDOM){
+                testSamples[i].values[c] = (int32_t)TEST_random();
+            } else if(i != 0){
+                testSamples[i].values[c] = testSamples[i - 1].values[c] + (int32_t)(TEST_random() % 7U) - 3;
+            }
+        }
+    }
+}
+
+/**************************************************************************************
+ * Encode Function
+ * Encodes samples from testSamples until the block is full or all count are in.
+ * Returns how many went in.
+ ***************************************************************************************
+*/
+static uint16_t TEST_encode(uint8_t *block, uint16_t size, uint16_t count, uint8_t channels){
+    TSC_Encoder encoder;
+    uint16_t i;
+
+    TSC_encoderInit(&encoder, block, size, channels);
+    for(i = 0; i < count; i++){
+        if(!TSC_encodeSample(&encoder, testSamples[i].timestamp, testSamples[i].values)){
+            break;
+        }
+    }
+    return i;
+}
+
+/**************************************************************************************
+ * Decode Function
+ * Decodes a block in a buffer of exactly length bytes and compares the samples with
+ * testSamples. Returns the number decoded, or -1 if the block was refused.
+ ***************************************************************************************
+*/
+static int32_t TEST_decode(const uint8_t *block, uint16_t length, const char *what){
+    uint8_t *exact = malloc(length ? length : 1);
+    TSC_Decoder decoder;
+    uint32_t timestamp;
+    int32_t values[TSC_MAX_CHANNELS];
+    int32_t decoded = 0;
+    uint8_t c;
+
+    memcpy(exact, block, length);
+    if(!TSC_decoderInit(&decoder, exact, length)){
+        free(exact);
+        return -1;
+    }
+    while(TSC_decodeSample(&decoder, &timestamp, values)){
+        TEST_check(timestamp == testSamples[decoded].timestamp, what, decoded);
+        for(c = 0; c < decoder.channels; c++){
+            TEST_check(values[c] == testSamples[decoded].values[c], what, decoded);
+        }
+        decoded++;
+    }
+    TEST_check(decoded == decoder.count || decoder.overrun, what, decoded);
+    free(exact);
+    return decoded;
+}
+
+/**************************************************************************************
+ * Round Trip Function
+ * Encodes a block, decodes it whole, cut short at every length and with a sample
+ * count in the header that the block cannot hold
+ ***************************************************************************************
+*/
+static void TEST_roundTrip(const char *what, uint8_t kind, uint8_t channels){
+    uint8_t block[TEST_BLOCK_SIZE];
+    uint8_t corrupt[TEST_BLOCK_SIZE];
+    TSC_Encoder sizing;
+    uint16_t count;
+    uint16_t length;
+    uint16_t cut;
+    int32_t decoded;
+
+    TEST_generate(kind, TEST_MAX_SAMPLES, channels);
+    count = TEST_encode(block, sizeof(block), TEST_MAX_SAMPLES, channels);
+    TEST_check(count > 0, what, count);
+
+    //The same samples again to know the length of the block
+    TSC_encoderInit(&sizing, corrupt, sizeof(corrupt), channels);
+    for(length = 0; length < count; length++){
+        TSC_encodeSample(&sizing, testSamples[length].timestamp, testSamples[length].values);
+    }
+    length = TSC_encodedBytes(&sizing);
+
+    decoded = TEST_decode(block, length, what);
+    TEST_check(decoded == count, what, (uint32_t)decoded);
+
+    for(cut = 0; cut < length; cut++){
+        decoded = TEST_decode(block, cut, what);
+        TEST_check(decoded < count, what, cut);
+    }
+
+    memcpy(corrupt, block, length);
+    corrupt[2] = 0xFF;
+    corrupt[3] = 0xFF;
+    decoded = TEST_decode(corrupt, length, what);
+    TEST_check(decoded == -1, what, (uint32_t)decoded);
+
+    printf("%-10s %u channels: %4u samples in %3u bytes, %5.2f bits per sample\n", what, channels,
+           count, length, length * 8.0 / count);
+}
+
+/**************************************************************************************
+ * Benchmark Function
+ * Encode and decode time of full blocks of random walk samples
+ ***************************************************************************************
+*/
+static void TEST_benchmark(uint8_t channels){
+    uint8_t block[TEST_BLOCK_SIZE];
+    TSC_Decoder decoder;
+    uint32_t timestamp;
+    int32_t values[TSC_MAX_CHANNELS];
+    uint32_t samples = 0;
+    uint16_t count = 0;
+    uint32_t i;
+    clock_t start;
+    double encodeNs;
+    double decodeNs;
+
+    TEST_generate(TEST_WALK, TEST_MAX_SAMPLES, channels);
+    start = clock();
+    for(i = 0; i < TEST_BENCH_BLOCKS; i++){
+        count = TEST_encode(block, sizeof(block), TEST_MAX_SAMPLES, channels);
+        samples += count;
+    }
+    encodeNs = (double)(clock() - start) * 1e9 / CLOCKS_PER_SEC / samples;
+
+    start = clock();
+    samples = 0;
+    for(i = 0; i < TEST_BENCH_BLOCKS; i++){
+        TSC_decoderInit(&decoder, block, sizeof(block));
+        while(TSC_decodeSample(&decoder, &timestamp, values)){
+            samples++;
+        }
+    }
+    decodeNs = (double)(clock() - start) * 1e9 / CLOCKS_PER_SEC / samples;
+    printf("benchmark  %u channels: encode %.1f ns, decode %.1f ns per sample\n", channels, encodeNs, decodeNs);
+}
+
+int main(void){
+    uint8_t channels;
+
+    for(channels = 1; channels <= TSC_MAX_CHANNELS; channels++){
+        TEST_roundTrip("walk", TEST_WALK, channels);
+        TEST_roundTrip("extreme", TEST_EXTREME, channels);
+        TEST_roundTrip("random", TEST_RANDOM, channels);
+    }
+    TEST_benchmark(3);
+    printf(testErrors ? "FAILED, %u errors\n" : "passed\n", (unsigned)testErrors);
+    return testErrors != 0;
+}
@@ -0,0 +1,171 @@
+/*
+ * zone_schedule.c
+ *
+ * PC model of the zone sampling schedule (ZONES/zones.c) on one I2C bus, to check
+ * ZONE_slotUsAt and ZONE_maxSensorsAt of ZONES/zone_capacity.c. The model lays the
+ * slots out like ZONE_slot does (on 1 ms timer wheel ticks, spread over the period)
+ * and runs the transactions of each slot through a first-come first-served bus:
+ *
+ *  mux select  START, address, channel mask, STOP
+ *  read        START, address, register, repeated START, address, 5 bytes, STOP
+ *  trigger     START, address, register, value, STOP
+ *
+ * Each byte takes 9 clocks and an interrupt latency, START and STOP a clock each,
+ * and every START after a STOP waits the bus free time. Besides the slot time, it
+ * checks at every combination of speed and rate that the number of sensors
+ * ZONE_maxSensorsAt allows runs for many periods with no sensor overrunning its slot
+ * (still on the bus when its next slot comes), no read before the conversion
+ * triggered a period earlier is done and no backlog building up. It also finds
+ * the most sensors the model itself fits, the formula must not promise more.
+ *
+ * Build from the repository root:
+ *   gcc -O2 -I. host/zone_schedule.c ZONES/zone_capacity.c -o zone_schedule
+ *
+ * Exits with 0 if every check passed.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "ZONES/zone_capacity.h"
+
+#define MODEL_PERIODS       40
+#define MODEL_IRQ_US        4.0         //interrupt latency per byte, measured on the launchpad
+#define MODEL_MAX_SENSORS   4096
+
+typedef struct
+{
+    uint32_t hz;
+    double   busFreeUs;                 //tBUF between a STOP and the next START
+} MODEL_Bus;
+
+typedef struct
+{
+    uint32_t overruns;
+    uint32_t earlyReads;
+    double   maxBacklogUs;              //longest a slot waited for the bus
+    double   slotUs;                    //longest slot on the bus
+} MODEL_Result;
+
+typedef struct
+{
+    uint8_t triggered;
+    double  doneUs;                     //last transaction off the bus
+    double  conversionUs;               //conversion started by the last trigger is done
+} MODEL_Sensor;
+
+static MODEL_Sensor modelSensors[MODEL_MAX_SENSORS];
+
+/**************************************************************************************
+ * Transaction Function
+ * Puts a transaction of bytes bytes and conditions START/STOP clocks on the bus at
+ * the earliest at atUs. Returns the time it started, busUs is moved to its end.
+ ***************************************************************************************
+*/
+static double MODEL_transaction(const MODEL_Bus *bus, double *busUs, double atUs, uint8_t bytes, uint8_t conditions){
+    double start = (atUs > *busUs) ? atUs : *busUs;
+
+    start += bus->busFreeUs;
+    *busUs = start + (9.0 * bytes + conditions) * 1e6 / bus->hz + bytes * MODEL_IRQ_US;
+    return start;
+}
+
+/**************************************************************************************
+ * Run Function
+ * count sensors sampled every periodMs, slots on the ticks ZONE_slot would use
+ ***************************************************************************************
+*/
+static MODEL_Result MODEL_run(const MODEL_Bus *bus, uint32_t periodMs, uint32_t count){
+    MODEL_Result result = {0, 0, 0.0, 0.0};
+    MODEL_Sensor *sensor;
+    double busUs = 0.0;
+    double slotStartUs;
+    double readUs;
+    double firstUs;
+    uint32_t period;
+    uint32_t i;
+
+    for(i = 0; i < count; i++){
+        modelSensors[i].triggered = 0;
+        modelSensors[i].doneUs = 0.0;
+    }
+    for(period = 0; period < MODEL_PERIODS; period++){
+        for(i = 0; i < count; i++){
+            sensor = &modelSensors[i];
+            slotStartUs = 1000.0 * ((uint64_t)period * periodMs + ((uint64_t)i * periodMs) / count);
+            if(sensor->doneUs > slotStartUs){
+                result.overruns++;
+                continue;
+            }
+            if(busUs - slotStartUs > result.maxBacklogUs){
+                result.maxBacklogUs = busUs - slotStartUs;
+            }
+
+            firstUs = MODEL_transaction(bus, &busUs, slotStartUs, 2, 2);
+            if(sensor->triggered){
+                readUs = MODEL_transaction(bus, &busUs, slotStartUs, 8, 3);
+                if(readUs < sensor->conversionUs){
+                    result.earlyReads++;
+                }
+            }
+            MODEL_transaction(bus, &busUs, slotStartUs, 3, 2);
+            sensor->triggered = 1;
+            sensor->doneUs = busUs;
+            sensor->conversionUs = busUs + ZONE_CONVERSION_US;
+            if(period > 0 && busUs - firstUs + bus->busFreeUs > result.slotUs){
+                result.slotUs = busUs - firstUs + bus->busFreeUs;
+            }
+        }
+    }
+    return result;
+}
+
+static int MODEL_passed(const MODEL_Result *result, uint32_t periodMs){
+    return result->overruns == 0 && result->earlyReads == 0 && result->maxBacklogUs < periodMs * 1000.0;
+}
+
+int main(void){
+    static const MODEL_Bus buses[] = {{100000U, 4.7}, {400000U, 1.3}};
+    static const uint32_t periodsMs[] = {1000, 500, 200, 100, 50, 40, 20, 12, 11, 10, 5};
+    MODEL_Result result;
+    uint32_t errors = 0;
+    uint32_t rateMilliHz;
+    uint32_t maxSensors;
+    uint32_t modelMax;
+    uint8_t b;
+    uint8_t p;
+
+    for(b = 0; b < sizeof(buses) / sizeof(buses[0]); b++){
+        result = MODEL_run(&buses[b], 1000, 1);
+        printf("%3u kHz: slot %.0f us in the model, %u us by ZONE_slotUsAt\n", (unsigned)(buses[b].hz / 1000U),
+               result.slotUs, (unsigned)ZONE_slotUsAt(buses[b].hz));
+        errors += result.slotUs > ZONE_slotUsAt(buses[b].hz);
+
+        for(p = 0; p < sizeof(periodsMs) / sizeof(periodsMs[0]); p++){
+            rateMilliHz = 1000000U / periodsMs[p];
+            maxSensors = ZONE_maxSensorsAt(rateMilliHz, buses[b].hz);
+            for(modelMax = 0; modelMax < MODEL_MAX_SENSORS; modelMax++){
+                result = MODEL_run(&buses[b], periodsMs[p], modelMax + 1);
+                if(!MODEL_passed(&result, periodsMs[p])){
+                    break;
+                }
+            }
+            printf("  %4u ms: %4u sensors allowed, %4u fit the model", (unsigned)periodsMs[p],
+                   (unsigned)maxSensors, (unsigned)modelMax);
+            if(maxSensors > 0){
+                result = MODEL_run(&buses[b], periodsMs[p], maxSensors);
+                printf(", backlog %.0f us", result.maxBacklogUs);
+                if(!MODEL_passed(&result, periodsMs[p])){
+                    printf(", %u overruns, %u early reads", (unsigned)result.overruns, (unsigned)result.earlyReads);
+                    errors++;
+                }
+            }
+            if(maxSensors > modelMax){
+                printf(", more than fit");
+                errors++;
+            }
+            printf("\n");
+        }
+    }
+    printf(errors ? "FAILED\n" : "passed\n");
+    return errors != 0;
+}
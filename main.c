@@ -3,7 +3,13 @@
  * Reads data from the BME280 Sensor via I2C and displays the data on an OLED screen
  * via I2C. Also displays data through Bluetooth using the HM-10 module via UART3
  * and to the PC via UART0 when the launchpad is connected through USB. All data is
- * refreshed on displays every 5 seconds based on the SysTick counter.
+ * refreshed on displays every sample period (3.5 seconds by default) by a software
+ * timer running off the 1 kHz SysTick. The work is split over active objects run by
+ * a run-to-completion scheduler (see APP\active_objects.h). By default the BME280 is
+ * read by a timer and I2C interrupt driven sequence (see ACQ\acquisition.h), so
+ * readings come at an exact rate whatever the rest is doing. The period and other
+ * settings can be changed through commands sent to UART0, type help in a terminal
+ * for the list.
  *
  * All code is based around CMSIS framework for the TM4C123GH6PM
  * Created on: Nov 21, 2019
@@ -18,159 +24,252 @@
 #include "I2C\i2c.h"
 #include "BME280\BME280_I2C.h"
 #include "UART\uart.h"
+#include "LOG\sample_log.h"
+#include "TELEMETRY\telemetry.h"
+#include "COMMAND\command.h"
+#include "HM10\hm10.h"
+#include "OUTPUT\output.h"
+#include "TIMER\timer_wheel.h"
+#include "SCHED\scheduler.h"
+#include "APP\active_objects.h"
+#include "ZONES\zones.h"
 
-void init_Peripherals(void);
-void set_OLED_Screen(void);
-void print_Info_On_OLED(int hasBeenPrinted);
-void parse_Celsius(void);
-void parse_Fahrenheit(void);
-void parse_Humidity(void);
+/*
+ * I2C controllers of the sensor and the display. Both share I2C1 (PA6/PA7) on this
+ * board. Moving the display to its own controller, e.g. I2C0 on PB2/PB3, lets frame
+ * flushes and sensor reads run at the same time.
+ */
+#define SENSOR_I2C      I2C1
+#define DISPLAY_I2C     I2C1
+
+//SSI module tried for the BME280 when none answers on I2C, SSI0 is PA2-PA5
+#define SENSOR_SSI      SSI0
 
-volatile int intpart;
-volatile double decpart;
-volatile double tempTemp;
-char tempPrint[5];
+/*
+ * SSI module driven for the display when none answers on I2C, SSI2 is PB4 (SCK),
+ * PB5 (CS) and PB7 (MOSI) with D/C on PB1 and RES on PB0, its pages are sent by uDMA
+ */
+#define DISPLAY_SSI     SSI2
+
+//Set by detect_I2C_Devices for the devices it found and started
+static uint8_t sensorFound;
+static uint8_t displayFound;
+
+void init_Peripherals(void);
+void detect_I2C_Devices(void);
+void detect_Zones(void);
+void probe_I2C_Speeds(void);
 
 int main() {
-    int printInfoOnce = 0;
     init_Peripherals();
-    SysTick_Handler();
-    BME280_I2C_readTemperature();
-    BME280_I2C_readTemperature();
-    set_OLED_Screen();
-    while(1){
-        if(systemCtr == 5){
-            print_Info_On_OLED(printInfoOnce);
-            printInfoOnce = 1;
-        } else {
-            printInfoOnce = 0;
-        }
-    }
+    //Hand over to the active objects, the scheduler sleeps in WFI when there is nothing to do
+    APP_start();
+    SCHED_run();
   return 0;
 }
 
 /**************************************************************************************
- * Temperature Celsius Parse Function
- * This function breaks the Temperature(Celsius) value up into an array with 2 decimals. This is to
- * feed the array in functions such as SSD_printText_6x8 and printStringToUart
+ * Peripheral Initialize Function
+ * This function contains all peripherals I will be need to set-up for use in the Main
+ * function. This is used to reduce code in Main()
  ***************************************************************************************
 */
-void parse_Celsius(void){
-    tempTemp = (double)(temperature)/100;
-    intpart = (int)tempTemp;
-    decpart = tempTemp - intpart;
-    tempPrint[1] = (intpart%10)+ '0';
-    intpart = intpart - (intpart%10);
-    tempPrint[0] = (intpart / 10) + '0';
-    tempPrint[2] = '.';
-    tempPrint[4] = (char)((int)(decpart*100)%10)+ '0';
-    tempPrint[3] = (((int)(decpart*100)-((int)(decpart*100)%10))/10)+ '0';
+void init_Peripherals(void){
+    SysTick_Init();
+    BSP_cycleCounterInit();
+    BSP_timestampInit();
+    TW_init();
+    SCHED_init(0);
+    __enable_irq();
+    I2C_init(SENSOR_I2C);
+    I2C_init(DISPLAY_I2C);
+    UART0_Init();
+    UART3_Init();
+    UART_dmaInit();
+    HM10_negotiateBaud(HM10_TARGET_BAUD);
+    HM10_report();
+    detect_I2C_Devices();
+    detect_Zones();
+    probe_I2C_Speeds();
+    LOG_init();
+    CMD_init();
+    OUT_init();
+    OUT_registerDefaultSinks();
 }
 
 /**************************************************************************************
- * Temperature Fahrenheit Function
- * This function breaks the Temperature(Fahrenheit) value up into an array with 2 decimals. This is to
- * feed the array in functions such as SSD_printText_6x8 and printStringToUart
+ * I2C Device Detection Function
+ * Scans the sensor and display buses (see I2C_scan) and starts the drivers for what
+ * is found: a BME280 or BMP280 at 0x76/0x77 going by its chip ID, an SSD1306 at
+ * 0x3C/0x3D that accepts a command, and a TCA9548A at 0x70 to 0x77 on the sensor bus
+ * that reads back the channel mask written to it. Every address that answered is
+ * listed on UART0 with the time the scans took, about 15 ms per bus at 100 kHz.
+ * Without a sensor on I2C, a BME280 is looked for on SPI (SENSOR_SSI). Without a
+ * display on I2C, the display is driven on SPI (DISPLAY_SSI), where it cannot be
+ * detected.
  ***************************************************************************************
 */
-void parse_Fahrenheit(void){
-    tempTemp = (double)temperatureF;
-    intpart = (int)tempTemp;
-    decpart = tempTemp - intpart;
-    tempPrint[1] = (intpart%10)+ '0';
-    intpart = intpart - (intpart%10);
-    tempPrint[0] = (intpart / 10) + '0';
-    tempPrint[2] = '.';
-    tempPrint[4] = (char)((int)(decpart*100)%10)+ '0';
-    tempPrint[3] = (((int)(decpart*100)-((int)(decpart*100)%10))/10)+ '0';
-}
+void detect_I2C_Devices(void){
+    static I2C0_Type *const buses[2] = {SENSOR_I2C, DISPLAY_I2C};
+    static const uint8_t oledNop[2] = {0x80, SSD_NOP};
+    static const uint8_t muxNone = 0;
+    uint8_t muxMask = 0xFF;
+    uint8_t found[16];
+    char line[64];
+    const char *name;
+    uint32_t scanCycles = 0;
+    uint32_t start;
+    uint8_t devices = 0;
+    uint8_t count, address, b, i;
 
-/**************************************************************************************
- * Humidity Parse Function
- * This function breaks the humidity value up into an array with 2 decimals. This is to
- * feed the array in functions such as SSD_printText_6x8 and printStringToUart
- ***************************************************************************************
-*/
-void parse_Humidity(void){
-    tempTemp = (double)humidity;
-    intpart = (int)tempTemp;
-    decpart = tempTemp - intpart;
-    tempPrint[1] = (intpart%10)+ '0';
-    intpart = intpart - (intpart%10);
-    tempPrint[0] = (intpart / 10) + '0';
-    tempPrint[2] = '.';
-    tempPrint[4] = (char)((int)(decpart*100)%10)+ '0';
-    tempPrint[3] = (((int)(decpart*100)-((int)(decpart*100)%10))/10)+ '0';
-}
+    for(b = 0; b < 2; b++){
+        //Both on the same controller, scan it once
+        if(b == 1 && buses[1] == buses[0]){
+            break;
+        }
+        start = BSP_CYCLES();
+        count = I2C_scan(buses[b], found, sizeof(found));
+        scanCycles += BSP_CYCLES() - start;
+        devices += count;
 
-/**************************************************************************************
- * Print Values On OLED Function
- * This function parses each data(Temperature and Humidity) into an array that
- * can then be fed into the SSD_printText function. The purpose of this function
- * is to take the data and display it on all the different displays.
- * 1)OLED display through SSD_printText_6x8
- * 2)Bluetooth via UART3
- * 3)PC via UART0 (When the launchpad is connected via USB to the PC)
- ***************************************************************************************
-*/
-void print_Info_On_OLED(int hasBeenPrinted){
-    if(!hasBeenPrinted){
-        BME280_I2C_readHumidity();
-        BME280_I2C_readTemperature();
-        //Parse out Celcius temperature and print
-        parse_Celsius();
-        SSD_printText_6x8(35,1, tempPrint);
-        printStringToUart("Temp: ", UART3 );
-        printStringToUart(tempPrint, UART3);
-        printStringToUart("(C) -> ", UART3 );
-        printStringToUart("Temperature(C): " , UART0);
-        printStringToUart(tempPrint, UART0);
-        printStringToUart("     Temperature(F): ", UART0);
-
-        //Parse out Fahrenheit temperature and print
-        parse_Fahrenheit();
-        SSD_printText_6x8(35,2, tempPrint);
-        printStringToUart(tempPrint, UART3);
-        printStringToUart("(F)         Humidity: ", UART3);
-        printStringToUart(tempPrint, UART0);
-        printStringToUart("\n", UART0);
-
-        //Parse out Fahrenheit temperature and print
-        parse_Humidity();
-        SSD_printText_6x8(35,4, tempPrint);
-        printStringToUart(tempPrint, UART3);
-        printStringToUart(" %rH\n", UART3);
+        for(i = 0; i < count && i < sizeof(found); i++){
+            address = found[i];
+            name = "unknown";
+            if(!sensorFound && buses[b] == SENSOR_I2C &&
+               (address == BME280_ADDRESS || address == BME280_ADDRESS_ALT) &&
+               BME280_Init(buses[b], address) == I2C_STATUS_DONE){
+                sensorFound = 1;
+                name = (bme280ChipId == BMP280_CHIP_ID) ? "BMP280 (no humidity)" : "BME280";
+            } else if(!displayFound && buses[b] == DISPLAY_I2C &&
+                      (address == SSD_ADDRESS || address == SSD_ADDRESS_ALT) &&
+                      I2C_transfer(buses[b], address, oledNop, 2, 0, 0) == I2C_STATUS_DONE){
+                SSD_init(buses[b], address);
+                displayFound = 1;
+                name = "SSD1306";
+            } else if(I2C_getMux(buses[b]) == 0 && buses[b] == SENSOR_I2C &&
+                      address >= I2C_MUX_FIRST_ADDRESS && address <= I2C_MUX_LAST_ADDRESS &&
+                      I2C_transfer(buses[b], address, &muxNone, 1, &muxMask, 1) == I2C_STATUS_DONE &&
+                      muxMask == 0){
+                I2C_setMux(buses[b], address);
+                name = "TCA9548A";
+            }
+            snprintf(line, sizeof(line), "I2C%u 0x%02X: %s\n", I2C_busNumber(buses[b]), address, name);
+            printStringToUart(line, UART0);
+        }
+    }
+
+    snprintf(line, sizeof(line), "I2C scan: %u devices in %lu us\n", devices,
+             (unsigned long)(scanCycles / (SYS_CLOCK_HZ / 1000000U)));
+    printStringToUart(line, UART0);
+    if(!sensorFound && BME280_InitSsi(SENSOR_SSI) == I2C_STATUS_DONE){
+        sensorFound = 1;
+        snprintf(line, sizeof(line), "SSI%u: %s at %lu kHz\n", SSI_busNumber(SENSOR_SSI),
+                 (bme280ChipId == BMP280_CHIP_ID) ? "BMP280 (no humidity)" : "BME280",
+                 (unsigned long)(SSI_clockHz(SENSOR_SSI) / 1000U));
+        printStringToUart(line, UART0);
+    }
+    if(!sensorFound){
+        printStringToUart("No BME280 found\n", UART0);
+    }
+    if(!displayFound){
+        SSD_initSsi(DISPLAY_SSI, 1);
+        displayFound = 1;
+        snprintf(line, sizeof(line), "No SSD1306 on I2C, driving SSI%u at %lu kHz\n", SSI_busNumber(DISPLAY_SSI),
+                 (unsigned long)(SSI_clockHz(DISPLAY_SSI) / 1000U));
+        printStringToUart(line, UART0);
     }
 }
 
 /**************************************************************************************
- * OLED Screen Print Set-up
- * This function lays a quick template on the OLED screen that is then later filled
- * with values every 5 seconds
+ * Zone Detection Function
+ * Looks for a BME280 at both addresses on every channel of the mux found on the
+ * sensor bus, except the address of the main sensor, adds the ones that answer as
+ * zones (see ZONES\zones.h) and starts sampling them at the sample period. Each
+ * empty address costs a select and an address byte, the whole search takes about
+ * 5 ms at 100 kHz.
  ***************************************************************************************
 */
-void set_OLED_Screen(void){
-    SSD_printText_6x8(0,0, "Temperature");
-    SSD_printText_6x8(0,1, "(C): ");
-    SSD_printText_6x8(0,2, "(F): ");
-    SSD_printText_6x8(0,3, "Humidity");
-    SSD_printText_6x8(0,4, "%rH: ");
+void detect_Zones(void){
+    static const uint8_t addresses[2] = {BME280_ADDRESS, BME280_ADDRESS_ALT};
+    char line[64];
+    uint32_t periodMs = runtimeConfig.samplePeriodMs;
+    uint16_t device;
+    uint8_t channel, i;
+
+    if(I2C_getMux(SENSOR_I2C) == 0){
+        return;
+    }
+    for(channel = 0; channel < I2C_MUX_CHANNELS; channel++){
+        for(i = 0; i < 2; i++){
+            //The main sensor would answer on every channel
+            if(sensorFound && bme280Transport->queued && bme280Bus == SENSOR_I2C && bme280Address == addresses[i]){
+                continue;
+            }
+            device = I2C_MUX_DEVICE(channel, addresses[i]);
+            if(ZONE_add(SENSOR_I2C, device) == I2C_STATUS_DONE){
+                snprintf(line, sizeof(line), "I2C%u mux %u 0x%02X: zone %u\n", I2C_busNumber(SENSOR_I2C),
+                         channel, addresses[i], ZONE_count() - 1);
+                printStringToUart(line, UART0);
+            }
+        }
+    }
+    if(ZONE_count() != 0 && !ZONE_start(periodMs)){
+        printStringToUart("Zones do not fit in the sample period\n", UART0);
+    }
 }
 
 /**************************************************************************************
- * Peripheral Initialize Function
- * This function contains all peripherals I will be need to set-up for use in the Main
- * function. This is used to reduce code in Main()
+ * I2C Speed Probe Function
+ * Finds the fastest speed each device on the bus answers reliably at (see
+ * I2C_probeSpeed) and keeps it, the transaction engine switches the bus speed between
+ * transactions to suit the device addressed. Also times a full OLED frame flush at each
+ * speed the display passed (polled and by uDMA on SPI) and a sensor sample over its
+ * transport, and reports it all to UART0
  ***************************************************************************************
 */
-void init_Peripherals(void){
-    SysTick_Init();
-    __enable_irq();
-    I2C_init();
-    UART0_Init();
-    UART3_Init();
-    BME280_Init();
-    SSD_init();
-}
+void probe_I2C_Speeds(void){
+    static const uint8_t chipIdRegister = BME280_REGISTER_CHIPID;
+    static const uint8_t oledNop[2] = {0x80, SSD_NOP};
+    char line[64];
+    uint8_t bmeSpeed = I2C_SPEED_STANDARD;
+    uint8_t oledSpeed = I2C_SPEED_STANDARD;
+    uint8_t oledOnI2C = displayFound && ssdTransport == &ssdI2CTransport;
+    uint8_t speed;
 
+    if(sensorFound && bme280Transport->queued){
+        bmeSpeed = I2C_probeSpeed(bme280Bus, bme280Address, &chipIdRegister, 1, 1, &bme280ChipId);
+    }
+    if(oledOnI2C){
+        oledSpeed = I2C_probeSpeed(ssdBus, ssdAddress, oledNop, 2, 0, 0);
+    }
+    snprintf(line, sizeof(line), "I2C: BME280 %lu kHz, OLED %lu kHz\n",
+             (unsigned long)(I2C_speedHz(bmeSpeed) / 1000U),
+             (unsigned long)(I2C_speedHz(oledSpeed) / 1000U));
+    printStringToUart(line, UART0);
 
+    for(speed = 0; speed <= oledSpeed && oledOnI2C; speed++){
+        I2C_setSpeed(ssdBus, ssdAddress, speed);
+        snprintf(line, sizeof(line), "OLED flush at %lu kHz: %lu us\n",
+                 (unsigned long)(I2C_speedHz(speed) / 1000U),
+                 (unsigned long)SSD_flushTimeUs());
+        printStringToUart(line, UART0);
+    }
+    if(displayFound && !oledOnI2C){
+        //Polled first, then by uDMA if the module has it, which is what is kept
+        speed = ssdDma;
+        ssdDma = 0;
+        snprintf(line, sizeof(line), "OLED flush over SPI at %lu kHz: %lu us\n",
+                 (unsigned long)(SSI_clockHz(ssdSsi) / 1000U), (unsigned long)SSD_flushTimeUs());
+        printStringToUart(line, UART0);
+        ssdDma = speed;
+        if(ssdDma){
+            snprintf(line, sizeof(line), "OLED flush over SPI by uDMA: %lu us\n", (unsigned long)SSD_flushTimeUs());
+            printStringToUart(line, UART0);
+        }
+    }
+    if(sensorFound){
+        snprintf(line, sizeof(line), "BME280 sample over %s: %lu us\n", bme280Transport->name,
+                 (unsigned long)BME280_measureSampleUs());
+        printStringToUart(line, UART0);
+    }
+}